@@ -0,0 +1,156 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/**
+    Bytes copied and time spent per TTL event on the processing thread, for
+    large binary payloads (4 KB by default, like a behavioral-state vector),
+    through each way an event can reach the writer:
+
+      staged    copied into a fresh vector, which is then queued: what
+                handing events to the writer by value would cost
+      packed    queued straight from the event's metadata, as
+                RiverOutput::handleTTLEvent() does for a single packed value
+      gathered  one metadata value per schema field, gathered straight into
+                the queue's slab memory (see TtlSampleLayout)
+
+    The queue and sink only ever see slab memory, which a NullSink discards,
+    so what's copied is the staging copy (if any) plus every byte written,
+    each of which was copied into a slab exactly once. River's own
+    serialization of the batch, which happens either way, isn't counted.
+
+    Usage: event_payload_benchmark [num_events] [payload_bytes] [max_batch_size]
+*/
+
+#include "RiverWriterQueue.h"
+#include "TtlPayload.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    double ns_per_event;
+    double bytes_copied_per_event;
+};
+
+/** Queues num_events events with enqueue_event(queue, i), which returns how many bytes it copied outside the queue */
+template <typename F>
+Result run(int64_t num_events, int payload_bytes, int max_batch_size, F enqueue_event) {
+    NullSink sink;
+    RiverWriterOptions options;
+    options.max_latency_ms = 5;
+    options.max_batch_size = max_batch_size;
+    options.sample_size = payload_bytes;
+    options.capacity_bytes = (size_t) 16 * max_batch_size * payload_bytes;
+    options.overflow_policy = OverflowPolicy::BLOCK;
+    options.block_timeout_ms = 10000;
+    RiverWriterQueue queue(&sink, options);
+    RiverWriterPool pool({&queue}, 1);
+    pool.start();
+
+    int64_t staged_bytes = 0;
+    auto start = Clock::now();
+    for (int64_t i = 0; i < num_events; i++) {
+        staged_bytes += enqueue_event(queue, i);
+        if (i % max_batch_size == 0) {
+            queue.publishIfDue();
+        }
+    }
+    auto enqueued = Clock::now();
+    queue.publish();
+    pool.stop();
+
+    Result result;
+    result.ns_per_event = std::chrono::duration<double, std::nano>(enqueued - start).count() / num_events;
+    result.bytes_copied_per_event = (double) (staged_bytes + sink.numBytes()) / num_events;
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    int64_t num_events = argc > 1 ? atoll(argv[1]) : 1000000;
+    int payload_bytes = argc > 2 ? atoi(argv[2]) : 4096;
+    int max_batch_size = argc > 3 ? atoi(argv[3]) : 64;
+    if (num_events <= 0 || payload_bytes < 16 || max_batch_size <= 0) {
+        fprintf(stderr, "Invalid arguments; see the usage at the top of EventPayloadBenchmark.cpp\n");
+        return 1;
+    }
+
+    // Stands in for the event's metadata, which the GUI deserializes once per event either way.
+    std::vector<char> payload(payload_bytes, 0x5A);
+
+    // The same bytes as four fields: a trial number, a timestamp and two halves of the state vector.
+    const int state_bytes = (payload_bytes - 16) / 2;
+    const int rest_bytes = payload_bytes - 16 - state_bytes;
+    river::StreamSchema schema({
+            river::FieldDefinition("trial", river::FieldDefinition::INT64, 8),
+            river::FieldDefinition("timestamp", river::FieldDefinition::DOUBLE, 8),
+            river::FieldDefinition("state_a", river::FieldDefinition::FIXED_WIDTH_BYTES, state_bytes),
+            river::FieldDefinition("state_b", river::FieldDefinition::FIXED_WIDTH_BYTES, rest_bytes),
+    });
+    TtlSampleLayout layout;
+    if (layout.plan(schema, {{TtlMetadataType::INT64, 1},
+                             {TtlMetadataType::DOUBLE, 1},
+                             {TtlMetadataType::UINT8, state_bytes},
+                             {TtlMetadataType::UINT8, rest_bytes}}) != TtlPayloadStatus::VALID) {
+        fprintf(stderr, "Couldn't plan the gathered layout\n");
+        return 1;
+    }
+    const char *fields[] = {payload.data(), payload.data() + 8, payload.data() + 16, payload.data() + 16 + state_bytes};
+
+    Result staged = run(num_events, payload_bytes, max_batch_size, [&](RiverWriterQueue &queue, int64_t) {
+        std::vector<char> copy(payload.begin(), payload.end());
+        queue.enqueue(copy.data(), copy.size(), 1);
+        return (int64_t) copy.size();
+    });
+    Result packed = run(num_events, payload_bytes, max_batch_size, [&](RiverWriterQueue &queue, int64_t) {
+        queue.enqueue(payload.data(), payload.size(), 1);
+        return (int64_t) 0;
+    });
+    Result gathered = run(num_events, payload_bytes, max_batch_size, [&](RiverWriterQueue &queue, int64_t) {
+        char *dst = queue.reserve(layout.eventBytes(), 1);
+        if (dst) {
+            layout.gather([&fields](int i) { return fields[i]; }, dst);
+            queue.commit();
+        }
+        return (int64_t) 0;
+    });
+
+    printf("%lld events of %d bytes, batches of %d, null sink\n",
+           (long long) num_events, payload_bytes, max_batch_size);
+    printf("%-10s %12s %16s\n", "path", "ns/event", "copied/event");
+    for (const auto &[name, result]: {std::pair<std::string, Result>{"staged", staged},
+                                      {"packed", packed},
+                                      {"gathered", gathered}}) {
+        printf("%-10s %12.1f %14.0f B\n", name.c_str(), result.ns_per_event, result.bytes_copied_per_event);
+    }
+    return 0;
+}
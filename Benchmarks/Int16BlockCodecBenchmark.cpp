@@ -0,0 +1,103 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/**
+    Compression ratio and encode/decode time of the compressed continuous
+    encoding, on blocks shaped like a Neuropixels probe: a slow oscillation
+    plus Gaussian noise of a given amplitude, quantized at ~0.195 uV/bit.
+    Run it with a noise level close to your recordings' to decide whether
+    compression pays off for a deployment.
+
+    Usage: int16_block_codec_benchmark [num_channels] [block_size] [noise_uv] [num_blocks]
+*/
+
+#include "Int16BlockCodec.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+template <typename F>
+double nsPerBlock(F f, int num_blocks) {
+    auto start = Clock::now();
+    for (int i = 0; i < num_blocks; i++) {
+        f();
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / num_blocks;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    int num_channels = argc > 1 ? atoi(argv[1]) : 384;
+    int block_size = argc > 2 ? atoi(argv[2]) : 1024;
+    double noise_uv = argc > 3 ? atof(argv[3]) : 10.0;
+    int num_blocks = argc > 4 ? atoi(argv[4]) : 500;
+
+    const double bit_volts = 0.195;
+    const double pi = 3.14159265358979323846;
+    std::mt19937 rng(1234);
+    std::normal_distribution<double> noise(0.0, noise_uv);
+    std::vector<int16_t> frames((size_t) num_channels * block_size);
+    for (int t = 0; t < block_size; t++) {
+        for (int c = 0; c < num_channels; c++) {
+            double uv = 100.0 * std::sin(2 * pi * 8.0 * t / 30000.0 + c) + noise(rng);
+            frames[(size_t) t * num_channels + c] = (int16_t) std::lround(uv / bit_volts);
+        }
+    }
+
+    std::vector<char> encoded(maxEncodedInt16BlockSize(num_channels, block_size));
+    size_t num_bytes = encodeInt16Block(frames.data(), num_channels, block_size, 0, 1, encoded.data());
+
+    Int16BlockHeader header;
+    std::vector<int16_t> decoded;
+    if (!decodeInt16Block(encoded.data(), num_bytes, &header, &decoded) || decoded != frames) {
+        printf("MISMATCH after decoding!\n");
+        return 1;
+    }
+
+    double encode_ns = nsPerBlock([&]() {
+        encodeInt16Block(frames.data(), num_channels, block_size, 0, 1, encoded.data());
+    }, num_blocks);
+    double decode_ns = nsPerBlock([&]() {
+        decodeInt16Block(encoded.data(), num_bytes, &header, &decoded);
+    }, num_blocks);
+
+    // What the same block takes as int16 frames, each with its int64 sample number.
+    double raw_bytes = (double) block_size * (num_channels * sizeof(int16_t) + sizeof(int64_t));
+    double values = (double) num_channels * block_size;
+    printf("%d channels x %d samples, %.1f uV noise\n", num_channels, block_size, noise_uv);
+    printf("%zu bytes/block encoded, %.0f raw (%.2fx), %.2f bits/value\n",
+           num_bytes, raw_bytes, raw_bytes / num_bytes, 8.0 * num_bytes / values);
+    printf("%-8s %10.1f us/block  %6.2f ns/value\n", "encode", encode_ns / 1e3, encode_ns / values);
+    printf("%-8s %10.1f us/block  %6.2f ns/value\n", "decode", decode_ns / 1e3, decode_ns / values);
+    return 0;
+}
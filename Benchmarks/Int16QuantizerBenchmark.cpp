@@ -0,0 +1,129 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/**
+    Compares the vectorized planar float -> interleaved int16 kernel against
+    the naive per-value loop, on blocks shaped like a Neuropixels probe.
+
+    Usage: int16_quantizer_benchmark [num_channels] [block_size] [num_blocks]
+*/
+
+#include "Int16Quantizer.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/** What the continuous writer would do without the kernel. */
+int64_t naiveQuantize(const float *const *channels,
+                      const float *scales,
+                      int num_channels,
+                      int num_samples,
+                      char *out,
+                      size_t frame_stride) {
+    int64_t saturated = 0;
+    for (int t = 0; t < num_samples; t++) {
+        auto *frame = reinterpret_cast<int16_t *>(out + frame_stride * t);
+        for (int c = 0; c < num_channels; c++) {
+            long v = lrintf(channels[c][t] * scales[c]);
+            if (v > 32767) {
+                v = 32767;
+                saturated++;
+            } else if (v < -32768) {
+                v = -32768;
+                saturated++;
+            }
+            frame[c] = (int16_t) v;
+        }
+    }
+    return saturated;
+}
+
+template <typename F>
+double nsPerBlock(F f, int num_blocks) {
+    auto start = Clock::now();
+    for (int i = 0; i < num_blocks; i++) {
+        f();
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / num_blocks;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    int num_channels = argc > 1 ? atoi(argv[1]) : 384;
+    int block_size = argc > 2 ? atoi(argv[2]) : 1024;
+    int num_blocks = argc > 3 ? atoi(argv[3]) : 2000;
+
+    // Roughly realistic: ~0.195 uV/bit and a few hundred uV of signal, with the occasional clipped value.
+    std::mt19937 rng(1234);
+    std::normal_distribution<float> noise(0.0f, 300.0f);
+    std::vector<std::vector<float>> planes(num_channels, std::vector<float>(block_size));
+    std::vector<const float *> channels(num_channels);
+    std::vector<float> scales(num_channels, 1.0f / 0.195f);
+    for (int c = 0; c < num_channels; c++) {
+        for (auto &v : planes[c]) {
+            v = noise(rng);
+        }
+        planes[c][c % block_size] = 1e6f;
+        channels[c] = planes[c].data();
+    }
+
+    // Frames are laid out like the continuous schema: int16 per channel, then an int64 sample number.
+    size_t frame_stride = num_channels * sizeof(int16_t) + sizeof(int64_t);
+    std::vector<char> expected(frame_stride * block_size);
+    std::vector<char> actual(frame_stride * block_size);
+
+    int64_t expected_saturated = quantizeToInterleavedInt16Scalar(
+            channels.data(), scales.data(), num_channels, block_size, expected.data(), frame_stride);
+    int64_t actual_saturated = quantizeToInterleavedInt16(
+            channels.data(), scales.data(), num_channels, block_size, actual.data(), frame_stride);
+    if (expected != actual || expected_saturated != actual_saturated) {
+        printf("MISMATCH between %s kernel and scalar reference!\n", int16QuantizerKernelName());
+        return 1;
+    }
+
+    double naive_ns = nsPerBlock([&]() {
+        naiveQuantize(channels.data(), scales.data(), num_channels, block_size, actual.data(), frame_stride);
+    }, num_blocks);
+    double kernel_ns = nsPerBlock([&]() {
+        quantizeToInterleavedInt16(channels.data(), scales.data(), num_channels, block_size, actual.data(), frame_stride);
+    }, num_blocks);
+
+    double values = (double) num_channels * block_size;
+    printf("%d channels x %d samples, %lld saturated per block\n",
+           num_channels, block_size, (long long) actual_saturated);
+    printf("%-8s %10.1f us/block  %6.2f ns/value\n", "naive", naive_ns / 1e3, naive_ns / values);
+    printf("%-8s %10.1f us/block  %6.2f ns/value  (%.1fx)\n",
+           int16QuantizerKernelName(), kernel_ns / 1e3, kernel_ns / values, naive_ns / kernel_ns);
+    return 0;
+}
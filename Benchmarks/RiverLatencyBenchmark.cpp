@@ -0,0 +1,262 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/**
+    End-to-end latency benchmark: how long a spike takes from handleSpike()
+    to a river::StreamReader on the other side of Redis.
+
+    A producer thread stands in for the processing thread, emitting synthetic
+    spikes in one burst per process() block at a fixed rate into a
+    RiverWriterQueue, and calling publishIfDue() once per block like
+    RiverOutput::process(). A RiverWriterPool thread writes them to River,
+    and a reader thread reads them back and timestamps each one on arrival.
+
+    Needs a Redis server, e.g. a local `redis-server` with default settings.
+
+    Usage: river_latency_benchmark [rates_hz] [seconds_per_rate] [max_latency_ms] [max_batch_size] [block_ms]
+                                   [redis_host] [redis_port]
+    where rates_hz is a comma-separated list, e.g. 1000,10000,100000.
+*/
+
+#include "RiverSpike.h"
+#include "RiverWriterQueue.h"
+
+#include <river/river.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::vector<int> rates_hz;
+    int seconds_per_rate;
+    int max_latency_ms;
+    int max_batch_size;
+    int block_ms;
+    std::string redis_host;
+    int redis_port;
+};
+
+int64_t nanosSince(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+/** Power-of-two buckets of microseconds, skipping empty ones at either end */
+void printHistogram(const std::vector<int64_t> &sorted_latencies_ns) {
+    std::vector<int64_t> counts(40, 0);
+    for (auto ns : sorted_latencies_ns) {
+        int64_t us = ns / 1000;
+        int bucket = 0;
+        while (bucket + 1 < (int) counts.size() && (int64_t{1} << bucket) <= us) {
+            bucket++;
+        }
+        counts[bucket]++;
+    }
+
+    int first = 0;
+    int last = (int) counts.size() - 1;
+    while (first < last && counts[first] == 0) {
+        first++;
+    }
+    while (last > first && counts[last] == 0) {
+        last--;
+    }
+
+    int64_t max_count = *std::max_element(counts.begin(), counts.end());
+    for (int b = first; b <= last; b++) {
+        int width = max_count > 0 ? (int) (50 * counts[b] / max_count) : 0;
+        printf("    < %9lld us %10lld %s\n",
+               (long long) (int64_t{1} << b),
+               (long long) counts[b],
+               std::string(width, '#').c_str());
+    }
+}
+
+void run(const Options &options, int rate_hz) {
+    const int64_t num_spikes = (int64_t) rate_hz * options.seconds_per_rate;
+    std::ostringstream name;
+    name << "river_latency_benchmark-" << rate_hz << "-"
+         << std::chrono::system_clock::now().time_since_epoch().count();
+    const std::string stream_name = name.str();
+
+    river::RedisConnection connection(options.redis_host, options.redis_port, "");
+    river::StreamSchema schema(riverSpikeFields());
+    river::StreamWriter writer(connection);
+    writer.Initialize(stream_name, schema);
+
+    river::StreamReader reader(connection);
+    reader.Initialize(stream_name, 5000);
+
+    // Indexed by sample_number; written before the spike is reserved, read once it comes back out of Redis.
+    std::unique_ptr<std::atomic<int64_t>[]> sent_ns(new std::atomic<int64_t>[num_spikes]);
+    std::vector<int64_t> latencies_ns;
+    latencies_ns.reserve(num_spikes);
+
+    const auto start = Clock::now();
+    Clock::time_point last_received = start;
+
+    std::thread reading([&]() {
+        std::vector<RiverSpike> buffer(options.max_batch_size);
+        while (true) {
+            int64_t n = reader.Read(buffer.data(), (int64_t) buffer.size(), 100);
+            if (n < 0) {
+                break;
+            }
+            int64_t now_ns = nanosSince(start);
+            for (int64_t i = 0; i < n; i++) {
+                int64_t sample_number = buffer[i].sample_number;
+                if (sample_number >= 0 && sample_number < num_spikes) {
+                    latencies_ns.push_back(now_ns - sent_ns[sample_number].load(std::memory_order_relaxed));
+                }
+            }
+            if (n > 0) {
+                last_received = Clock::now();
+            }
+        }
+    });
+
+    // RiverOutput's defaults, other than the latency and batch size under test.
+    RiverWriterOptions queue_options;
+    queue_options.max_latency_ms = options.max_latency_ms;
+    queue_options.max_batch_size = options.max_batch_size;
+    queue_options.sample_size = (int) sizeof(RiverSpike);
+    queue_options.capacity_bytes = (size_t) 1000000 * sizeof(RiverSpike);
+    queue_options.overflow_policy = OverflowPolicy::DROP_NEWEST;
+    queue_options.block_timeout_ms = 0;
+    RiverStreamSink sink(&writer);
+    RiverWriterQueue queue(&sink, queue_options);
+    RiverWriterPool pool({&queue}, 1);
+    pool.start();
+
+    // The processing thread: one burst of spikes per block, with everything that should have arrived by then.
+    int64_t emitted = 0;
+    auto next_block = start;
+    while (emitted < num_spikes) {
+        next_block += std::chrono::milliseconds(options.block_ms);
+        std::this_thread::sleep_until(next_block);
+
+        int64_t due = std::min(num_spikes, (int64_t) (rate_hz * std::chrono::duration<double>(Clock::now() - start).count()));
+        for (; emitted < due; emitted++) {
+            sent_ns[emitted].store(nanosSince(start), std::memory_order_relaxed);
+            char *dst = queue.reserve(sizeof(RiverSpike), 1);
+            if (!dst) {
+                continue;
+            }
+            packRiverSpike(dst, (int32_t) (emitted % 384), 0, emitted);
+            queue.commit();
+        }
+        queue.publishIfDue();
+    }
+    const double send_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    queue.publish();
+    pool.stop();
+    writer.Stop();
+    reading.join();
+    reader.Stop();
+
+    const double receive_seconds = std::chrono::duration<double>(last_received - start).count();
+    printf("%d Hz for %d s: sent %lld, dropped %lld, received %lld; sent at %.0f/s, received at %.0f/s\n",
+           rate_hz,
+           options.seconds_per_rate,
+           (long long) num_spikes,
+           (long long) queue.dropCounts().total(),
+           (long long) latencies_ns.size(),
+           (double) num_spikes / send_seconds,
+           receive_seconds > 0 ? (double) latencies_ns.size() / receive_seconds : 0.0);
+    if (latencies_ns.empty()) {
+        return;
+    }
+
+    std::sort(latencies_ns.begin(), latencies_ns.end());
+    auto percentile = [&](double p) {
+        return latencies_ns[std::min(latencies_ns.size() - 1, (size_t) (p * (double) latencies_ns.size()))] / 1000;
+    };
+    printf("  latency us: p50 %lld  p99 %lld  p99.9 %lld  max %lld\n",
+           (long long) percentile(0.5),
+           (long long) percentile(0.99),
+           (long long) percentile(0.999),
+           (long long) (latencies_ns.back() / 1000));
+    printHistogram(latencies_ns);
+}
+
+std::vector<int> parseRates(const char *arg) {
+    std::vector<int> rates;
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        int rate = atoi(item.c_str());
+        if (rate > 0) {
+            rates.push_back(rate);
+        }
+    }
+    return rates;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    options.rates_hz = parseRates(argc > 1 ? argv[1] : "1000,10000,100000");
+    options.seconds_per_rate = argc > 2 ? atoi(argv[2]) : 10;
+    options.max_latency_ms = argc > 3 ? atoi(argv[3]) : 5;
+    options.max_batch_size = argc > 4 ? atoi(argv[4]) : 1024;
+    options.block_ms = argc > 5 ? atoi(argv[5]) : 10;
+    options.redis_host = argc > 6 ? argv[6] : "127.0.0.1";
+    options.redis_port = argc > 7 ? atoi(argv[7]) : 6379;
+
+    if (options.rates_hz.empty() || options.seconds_per_rate <= 0 || options.max_batch_size <= 0
+        || options.block_ms <= 0) {
+        fprintf(stderr, "Invalid arguments; see the usage at the top of RiverLatencyBenchmark.cpp\n");
+        return 1;
+    }
+
+    printf("Redis at %s:%d; max_latency_ms %d, max_batch_size %d, one burst every %d ms\n",
+           options.redis_host.c_str(),
+           options.redis_port,
+           options.max_latency_ms,
+           options.max_batch_size,
+           options.block_ms);
+    for (int rate : options.rates_hz) {
+        try {
+            run(options, rate);
+        } catch (const std::exception &e) {
+            fprintf(stderr, "%d Hz failed: %s\n", rate, e.what());
+            return 1;
+        }
+    }
+    return 0;
+}
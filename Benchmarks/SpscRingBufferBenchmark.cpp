@@ -0,0 +1,165 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/**
+    Micro-benchmark of the cost of handing one spike-sized payload (by
+    pointer, like River Output's slabs) to a writer thread that is
+    concurrently draining the queue, comparing the previous std::mutex +
+    std::queue hand-off against SpscRingBuffer.
+
+    Usage: spsc_ring_buffer_benchmark [num_events] [burst_size]
+*/
+
+#include "SpscRingBuffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Payload {
+    char bytes[16];
+    int num_samples;
+};
+
+using Clock = std::chrono::steady_clock;
+
+/** The hand-off RiverWriterThread used before SpscRingBuffer. */
+class MutexQueue {
+public:
+    bool tryPush(const Payload* p) {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push(p);
+        return true;
+    }
+
+    bool tryPop(const Payload*& out) {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.empty()) {
+            return false;
+        }
+        out = queue_.front();
+        queue_.pop();
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    std::queue<const Payload*> queue_;
+};
+
+template <typename Queue>
+void run(const char *name, Queue &queue, int num_events, int burst_size) {
+    std::atomic<bool> done(false);
+    std::atomic<int64_t> consumed(0);
+
+    // Drain as aggressively as possible to maximize contention with the producer.
+    std::thread consumer([&]() {
+        const Payload *p;
+        int64_t n = 0;
+        while (!done.load(std::memory_order_acquire)) {
+            while (queue.tryPop(p)) {
+                n += p->num_samples;
+            }
+        }
+        while (queue.tryPop(p)) {
+            n += p->num_samples;
+        }
+        consumed.store(n);
+    });
+
+    std::vector<int64_t> durations_ns;
+    durations_ns.reserve(num_events);
+    int64_t dropped = 0;
+
+    Payload p;
+    memset(p.bytes, 0xAB, sizeof(p.bytes));
+    p.num_samples = 1;
+
+    auto start = Clock::now();
+    for (int i = 0; i < num_events; i++) {
+        auto t0 = Clock::now();
+        if (!queue.tryPush(&p)) {
+            dropped++;
+        }
+        auto t1 = Clock::now();
+        durations_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+
+        // Spikes arrive in bursts once per process() block; idle briefly between bursts.
+        if (burst_size > 0 && (i + 1) % burst_size == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+    auto elapsed = Clock::now() - start;
+    done.store(true, std::memory_order_release);
+    consumer.join();
+
+    std::sort(durations_ns.begin(), durations_ns.end());
+    auto percentile = [&](double p) {
+        return durations_ns[std::min(durations_ns.size() - 1, (size_t) (p * (double) durations_ns.size()))];
+    };
+    double mean = 0;
+    for (auto d : durations_ns) {
+        mean += (double) d;
+    }
+    mean /= (double) durations_ns.size();
+
+    printf("%-16s enqueue ns: mean %8.1f  p50 %6lld  p99 %6lld  p99.9 %8lld  max %10lld | "
+           "consumed %lld dropped %lld | wall %.1f ms\n",
+           name,
+           mean,
+           (long long) percentile(0.5),
+           (long long) percentile(0.99),
+           (long long) percentile(0.999),
+           (long long) durations_ns.back(),
+           (long long) consumed.load(),
+           (long long) dropped,
+           std::chrono::duration<double, std::milli>(elapsed).count());
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    int num_events = argc > 1 ? atoi(argv[1]) : 2000000;
+    int burst_size = argc > 2 ? atoi(argv[2]) : 4096;
+
+    printf("Enqueueing %d 16-byte events in bursts of %d\n", num_events, burst_size);
+    {
+        MutexQueue queue;
+        run("mutex+queue", queue, num_events, burst_size);
+    }
+    {
+        SpscRingBuffer<const Payload *> queue(1 << 16);
+        run("spsc ring", queue, num_events, burst_size);
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/**
+    Throughput of the writer pipeline: RiverWriterQueue batching on the
+    calling thread and a RiverWriterPool thread flushing batches to a sink.
+
+    Samples are enqueued as fast as possible under OverflowPolicy::BLOCK, so
+    nothing is dropped and the enqueue rate is bounded by how fast batches can
+    be flushed. Reports the cost of each enqueue and the sustained flush rate.
+
+    The sink is one of:
+      null    discards batches, measuring the pipeline's own overhead (default)
+      memory  copies every batch, as the tests do
+      file    appends batches to writer_queue_benchmark.bin
+      river   writes to River; needs a Redis server, e.g. a local `redis-server`
+
+    Usage: writer_queue_benchmark [num_samples] [sample_size] [max_batch_size] [sink] [redis_host] [redis_port]
+*/
+
+#include "RiverWriterQueue.h"
+
+#include <river/river.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char **argv) {
+    int64_t num_samples = argc > 1 ? atoll(argv[1]) : 10000000;
+    int sample_size = argc > 2 ? atoi(argv[2]) : 16;
+    int max_batch_size = argc > 3 ? atoi(argv[3]) : 1024;
+    std::string sink_name = argc > 4 ? argv[4] : "null";
+    std::string redis_host = argc > 5 ? argv[5] : "127.0.0.1";
+    int redis_port = argc > 6 ? atoi(argv[6]) : 6379;
+    if (num_samples <= 0 || sample_size <= 0 || max_batch_size <= 0) {
+        fprintf(stderr, "Invalid arguments; see the usage at the top of WriterQueueBenchmark.cpp\n");
+        return 1;
+    }
+
+    std::unique_ptr<river::StreamWriter> writer;
+    std::unique_ptr<BatchSink> sink;
+    if (sink_name == "null") {
+        sink = std::make_unique<NullSink>();
+    } else if (sink_name == "memory") {
+        sink = std::make_unique<MemorySink>();
+    } else if (sink_name == "file") {
+        sink = std::make_unique<FileSink>("writer_queue_benchmark.bin");
+    } else if (sink_name == "river") {
+        std::ostringstream name;
+        name << "writer_queue_benchmark-" << std::chrono::system_clock::now().time_since_epoch().count();
+        river::RedisConnection connection(redis_host, redis_port, "");
+        writer = std::make_unique<river::StreamWriter>(connection);
+        writer->Initialize(name.str(), river::StreamSchema(
+                {river::FieldDefinition("payload", river::FieldDefinition::FIXED_WIDTH_BYTES, sample_size)}));
+        sink = std::make_unique<RiverStreamSink>(writer.get());
+    } else {
+        fprintf(stderr, "Unknown sink %s\n", sink_name.c_str());
+        return 1;
+    }
+
+    RiverWriterOptions options;
+    options.max_latency_ms = 5;
+    options.max_batch_size = max_batch_size;
+    options.sample_size = sample_size;
+    options.capacity_bytes = (size_t) 1000000 * sample_size;
+    options.overflow_policy = OverflowPolicy::BLOCK;
+    options.block_timeout_ms = 10000;
+    RiverWriterQueue queue(sink.get(), options);
+    RiverWriterPool pool({&queue}, 1);
+    pool.start();
+
+    std::vector<char> sample(sample_size, 0x5A);
+    // Timing every enqueue would cost as much as the enqueue itself, so sample one in 64.
+    std::vector<int64_t> enqueue_ns;
+    enqueue_ns.reserve(num_samples / 64 + 1);
+
+    auto start = Clock::now();
+    for (int64_t i = 0; i < num_samples; i++) {
+        if (i % 64 == 0) {
+            auto t0 = Clock::now();
+            queue.enqueue(sample.data(), sample_size, 1);
+            enqueue_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count());
+        } else {
+            queue.enqueue(sample.data(), sample_size, 1);
+        }
+        if (i % max_batch_size == 0) {
+            queue.publishIfDue();
+        }
+    }
+    auto enqueued = Clock::now();
+    queue.publish();
+    pool.stop();
+    auto flushed = Clock::now();
+    if (writer) {
+        writer->Stop();
+    }
+
+    std::sort(enqueue_ns.begin(), enqueue_ns.end());
+    auto percentile = [&](double p) {
+        return enqueue_ns[std::min(enqueue_ns.size() - 1, (size_t) (p * (double) enqueue_ns.size()))];
+    };
+    double enqueue_seconds = std::chrono::duration<double>(enqueued - start).count();
+    double flush_seconds = std::chrono::duration<double>(flushed - start).count();
+
+    printf("%lld samples of %d bytes, batches of %d, %s sink\n",
+           (long long) num_samples, sample_size, max_batch_size, sink_name.c_str());
+    printf("enqueue ns: p50 %lld  p99 %lld  p99.9 %lld  max %lld\n",
+           (long long) percentile(0.5),
+           (long long) percentile(0.99),
+           (long long) percentile(0.999),
+           (long long) enqueue_ns.back());
+    printf("enqueued in %.3f s; flushed in %.3f s: %.0f samples/s, %.1f MB/s\n",
+           enqueue_seconds,
+           flush_seconds,
+           (double) num_samples / flush_seconds,
+           (double) num_samples * sample_size / flush_seconds / 1e6);
+    printf("dropped %lld\n", (long long) queue.dropCounts().total());
+
+    // The same numbers River Output shows and publishes, to check them against the ones measured here.
+    auto metrics = queue.metrics();
+    printf("queue depth high water %lld / %lld bytes\n",
+           (long long) metrics.queue_depth_high_water,
+           (long long) metrics.queue_capacity);
+    printf("flush latency us: p50 <= %lld  p99 <= %lld  max %lld; write us: p50 <= %lld  p99 <= %lld  max %lld\n",
+           (long long) metrics.flush_latency_us.percentile(0.5),
+           (long long) metrics.flush_latency_us.percentile(0.99),
+           (long long) metrics.flush_latency_us.max,
+           (long long) metrics.write_duration_us.percentile(0.5),
+           (long long) metrics.write_duration_us.percentile(0.99),
+           (long long) metrics.write_duration_us.max);
+    return 0;
+}
@@ -0,0 +1,188 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "BatchSink.h"
+
+#include <stdexcept>
+#include <utility>
+
+void PartialWrite::failed(const char *data, size_t num_bytes, int64_t num_samples, int64_t num_written) {
+    num_written_ = num_written;
+    if (num_written > 0) {
+        num_bytes_ = num_bytes;
+        num_samples_ = num_samples;
+        hash_ = hash(data, num_bytes);
+    }
+}
+
+int64_t PartialWrite::take(const char *data, size_t num_bytes, int64_t num_samples) {
+    int64_t num_written = num_written_;
+    num_written_ = 0;
+    if (num_written == 0 || num_bytes != num_bytes_ || num_samples != num_samples_ || hash(data, num_bytes) != hash_) {
+        return 0;
+    }
+    return num_written;
+}
+
+uint64_t PartialWrite::hash(const char *data, size_t num_bytes) {
+    // FNV-1a; only runs after a failed write.
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < num_bytes; i++) {
+        h = (h ^ (uint8_t) data[i]) * 1099511628211ull;
+    }
+    return h;
+}
+
+RiverStreamSink::RiverStreamSink(river::StreamWriter *writer, Checker check)
+        : check_(std::move(check)),
+          writer_(writer),
+          samples_written_(0) {
+}
+
+RiverStreamSink::RiverStreamSink(Connector connect, Checker check)
+        : connect_(std::move(connect)),
+          check_(std::move(check)),
+          writer_(nullptr),
+          samples_written_(0) {
+}
+
+void RiverStreamSink::write(const char *data, size_t num_bytes, int64_t num_samples) {
+    river::StreamWriter *writer = writer_.load();
+    if (!writer) {
+        throw std::runtime_error("Not connected to River yet");
+    }
+
+    // If this is the retry of a batch that failed partway, don't write its first samples twice.
+    int64_t skip = partial_write_.take(data, num_bytes, num_samples);
+    size_t skip_bytes = skip > 0 ? (size_t) skip * (num_bytes / (size_t) num_samples) : 0;
+
+    int64_t written_before = writer->total_samples_written();
+    try {
+        writer->WriteBytes(data + skip_bytes, num_samples - skip);
+    } catch (...) {
+        int64_t written = writer->total_samples_written() - written_before;
+        partial_write_.failed(data, num_bytes, num_samples, skip + written);
+        samples_written_.fetch_add(written, std::memory_order_relaxed);
+        throw;
+    }
+    samples_written_.fetch_add(num_samples - skip, std::memory_order_relaxed);
+}
+
+void RiverStreamSink::reconnect() {
+    river::StreamWriter *writer = writer_.load();
+    if (!writer) {
+        if (!connect_) {
+            throw std::runtime_error("No StreamWriter to connect with");
+        }
+        owned_writer_ = connect_();
+        writer_.store(owned_writer_.get());
+        return;
+    }
+    if (!check_) {
+        throw std::runtime_error("No way to tell whether the StreamWriter can reach Redis again");
+    }
+    check_(*writer);
+}
+
+river::StreamWriter *RiverStreamSink::writer() const {
+    return writer_.load();
+}
+
+int64_t RiverStreamSink::samplesWritten() const {
+    return samples_written_.load(std::memory_order_relaxed);
+}
+
+NullSink::NullSink()
+        : num_samples_(0),
+          num_bytes_(0),
+          num_batches_(0) {
+}
+
+void NullSink::write(const char * /* data */, size_t num_bytes, int64_t num_samples) {
+    num_samples_.fetch_add(num_samples, std::memory_order_relaxed);
+    num_bytes_.fetch_add((int64_t) num_bytes, std::memory_order_relaxed);
+    num_batches_.fetch_add(1, std::memory_order_relaxed);
+}
+
+int64_t NullSink::numSamples() const {
+    return num_samples_.load(std::memory_order_relaxed);
+}
+
+int64_t NullSink::numBytes() const {
+    return num_bytes_.load(std::memory_order_relaxed);
+}
+
+int64_t NullSink::numBatches() const {
+    return num_batches_.load(std::memory_order_relaxed);
+}
+
+void MemorySink::write(const char *data, size_t num_bytes, int64_t num_samples) {
+    Batch batch;
+    batch.bytes.assign(data, data + num_bytes);
+    batch.num_samples = num_samples;
+    batch.written_at = std::chrono::steady_clock::now();
+
+    const std::lock_guard<std::mutex> lock(mutex_);
+    batches_.push_back(std::move(batch));
+}
+
+std::vector<MemorySink::Batch> MemorySink::batches() const {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return batches_;
+}
+
+std::vector<char> MemorySink::bytes() const {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<char> out;
+    for (const auto &batch: batches_) {
+        out.insert(out.end(), batch.bytes.begin(), batch.bytes.end());
+    }
+    return out;
+}
+
+int64_t MemorySink::numSamples() const {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    int64_t n = 0;
+    for (const auto &batch: batches_) {
+        n += batch.num_samples;
+    }
+    return n;
+}
+
+FileSink::FileSink(const std::string &path)
+        : file_(fopen(path.c_str(), "wb")),
+          path_(path) {
+    if (!file_) {
+        throw std::runtime_error("Couldn't open " + path + " for writing");
+    }
+}
+
+FileSink::~FileSink() {
+    fclose(file_);
+}
+
+void FileSink::write(const char *data, size_t num_bytes, int64_t /* num_samples */) {
+    if (fwrite(data, 1, num_bytes, file_) != num_bytes) {
+        throw std::runtime_error("Failed to write to " + path_);
+    }
+}
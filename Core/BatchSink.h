@@ -0,0 +1,200 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __BATCHSINK_H_C3A8F051__
+#define __BATCHSINK_H_C3A8F051__
+
+#include <river/river.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+
+    Where RiverWriterQueue sends its batches. Normally a RiverStreamSink; the
+    other implementations stand in for River so that the pipeline can be
+    tested and load tested without a Redis server.
+
+    write() and reconnect() are only called from the queue's writer thread.
+    After a write() throws, the next write() is normally the same batch
+    again, so a sink that got part of it through can skip that part on the
+    retry (see PartialWrite). Not always, though: the batch is dropped if
+    the spool can't take it.
+
+*/
+class BatchSink
+{
+public:
+    virtual ~BatchSink() = default;
+
+    /** Writes num_samples samples, which take up num_bytes bytes at data. May throw on failure. */
+    virtual void write(const char* data, size_t num_bytes, int64_t num_samples) = 0;
+
+    /**
+     * Called after write() threw, before the next write() is tried. Throws if the destination still can't be
+     * reached. Does nothing by default, so the next write() is the retry.
+     */
+    virtual void reconnect() {}
+};
+
+/**
+    Remembers how much of a batch got written before its write failed, so
+    that the retry of that batch can skip those samples. A batch is
+    recognized by its size and a hash of its bytes, not its address: a
+    spooled batch comes back from the spool file.
+*/
+class PartialWrite
+{
+public:
+    /** Records that num_written of the batch's samples were written before its write failed */
+    void failed(const char* data, size_t num_bytes, int64_t num_samples, int64_t num_written);
+
+    /**
+     * How many of the batch's samples were already written, if it's the one whose write failed last; 0 for any
+     * other batch. Forgets the failed batch either way.
+     */
+    int64_t take(const char* data, size_t num_bytes, int64_t num_samples);
+
+private:
+    static uint64_t hash(const char* data, size_t num_bytes);
+
+    int64_t num_written_ = 0;
+    size_t num_bytes_ = 0;
+    int64_t num_samples_ = 0;
+    uint64_t hash_ = 0;
+};
+
+/** Writes each batch to River with a single WriteBytes call */
+class RiverStreamSink : public BatchSink
+{
+public:
+    /** Creates the stream and initializes its StreamWriter; throws if Redis can't be reached */
+    using Connector = std::function<std::unique_ptr<river::StreamWriter>()>;
+
+    /** Throws if the writer still can't reach Redis, e.g. because reading the stream's metadata fails */
+    using Checker = std::function<void(river::StreamWriter& writer)>;
+
+    /** writer must already be initialized and outlive the sink. Without check, reconnect() always throws. */
+    explicit RiverStreamSink(river::StreamWriter* writer, Checker check = nullptr);
+
+    /** Connects with connect on the first reconnect(), so the stream can be created once Redis is up */
+    RiverStreamSink(Connector connect, Checker check);
+
+    /**
+     * Throws if not connected yet, or if WriteBytes does. The writer's total_samples_written() says how much of a
+     * failed batch made it to Redis, and the retry only writes the rest.
+     */
+    void write(const char* data, size_t num_bytes, int64_t num_samples) override;
+
+    /**
+     * Creates the stream the first time. After that, the writer is kept: River won't initialize another
+     * StreamWriter on a stream that already exists. Instead, check tells whether the writer can reach Redis again,
+     * and the next write() retries with it.
+     */
+    void reconnect() override;
+
+    /** nullptr until connected. Safe to call from any thread. */
+    river::StreamWriter* writer() const;
+
+    /** Samples written to River. Safe to call from any thread. */
+    int64_t samplesWritten() const;
+
+private:
+    Connector connect_;
+    Checker check_;
+    std::unique_ptr<river::StreamWriter> owned_writer_;
+    std::atomic<river::StreamWriter*> writer_;
+    std::atomic<int64_t> samples_written_;
+    // Writer thread only.
+    PartialWrite partial_write_;
+};
+
+/** Discards everything, so only the cost of the pipeline itself is measured */
+class NullSink : public BatchSink
+{
+public:
+    NullSink();
+
+    void write(const char* data, size_t num_bytes, int64_t num_samples) override;
+
+    int64_t numSamples() const;
+    int64_t numBytes() const;
+    int64_t numBatches() const;
+
+private:
+    std::atomic<int64_t> num_samples_;
+    std::atomic<int64_t> num_bytes_;
+    std::atomic<int64_t> num_batches_;
+};
+
+/** Keeps a copy of every batch and when it was written, for tests */
+class MemorySink : public BatchSink
+{
+public:
+    struct Batch {
+        std::vector<char> bytes;
+        int64_t num_samples;
+        std::chrono::steady_clock::time_point written_at;
+    };
+
+    void write(const char* data, size_t num_bytes, int64_t num_samples) override;
+
+    /** Copy of the batches written so far. Safe to call from any thread. */
+    std::vector<Batch> batches() const;
+
+    /** All samples written so far, back to back */
+    std::vector<char> bytes() const;
+
+    int64_t numSamples() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<Batch> batches_;
+};
+
+/** Appends the raw bytes of every batch to a local file */
+class FileSink : public BatchSink
+{
+public:
+    /** Truncates path. Throws std::runtime_error if it can't be opened. */
+    explicit FileSink(const std::string& path);
+
+    /** Flushes and closes the file */
+    ~FileSink() override;
+
+    /** Throws std::runtime_error if the write fails, e.g. because the disk is full. */
+    void write(const char* data, size_t num_bytes, int64_t num_samples) override;
+
+private:
+    FILE* file_;
+    const std::string path_;
+};
+
+#endif  // __BATCHSINK_H_C3A8F051__
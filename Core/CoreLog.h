@@ -0,0 +1,37 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __CORELOG_H_4F2A8C61__
+#define __CORELOG_H_4F2A8C61__
+
+#include <functional>
+#include <string>
+
+/**
+ * Where the core library reports what goes wrong on its threads, e.g. a lost connection. The plugin passes one that
+ * writes to the Open Ephys log; nothing is logged if it's empty. Called from whichever thread hit the problem, so it
+ * must be thread safe.
+ */
+using CoreLogFunction = std::function<void(const std::string& message)>;
+
+#endif  // __CORELOG_H_4F2A8C61__
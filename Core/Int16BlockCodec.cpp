@@ -0,0 +1,180 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Int16BlockCodec.h"
+
+#include <bit>
+#include <cstring>
+
+namespace {
+
+inline uint16_t zigzag(int16_t delta) {
+    return (uint16_t) (((uint16_t) delta << 1) ^ (uint16_t) (delta >> 15));
+}
+
+inline int16_t unzigzag(uint16_t value) {
+    return (int16_t) ((value >> 1) ^ (uint16_t) -(int16_t) (value & 1));
+}
+
+/** Difference to the previous value, wrapping around the int16 range */
+inline int16_t delta(int16_t value, int16_t previous) {
+    return (int16_t) (uint16_t) ((uint16_t) value - (uint16_t) previous);
+}
+
+template<typename T>
+void writeLittleEndian(char *&out, T value) {
+    auto bits = (std::make_unsigned_t<T>) value;
+    for (size_t i = 0; i < sizeof(T); i++) {
+        *out++ = (char) (uint8_t) (bits >> (8 * i));
+    }
+}
+
+template<typename T>
+T readLittleEndian(const char *&in) {
+    std::make_unsigned_t<T> bits = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+        bits |= (std::make_unsigned_t<T>) (uint8_t) *in++ << (8 * i);
+    }
+    return (T) bits;
+}
+
+inline size_t packedBytes(uint32_t num_values, int bit_width) {
+    return ((size_t) num_values * bit_width + 7) / 8;
+}
+
+}  // namespace
+
+size_t maxEncodedInt16BlockSize(int num_channels, int num_samples) {
+    if (num_samples <= 0) {
+        return Int16BlockHeader::kSize + 3 * (size_t) num_channels;
+    }
+    return Int16BlockHeader::kSize + (size_t) num_channels * (3 + packedBytes(num_samples - 1, 16));
+}
+
+size_t encodeInt16Block(const int16_t *frames,
+                        int num_channels,
+                        int num_samples,
+                        int64_t first_sample_number,
+                        int sample_step,
+                        char *out) {
+    char *const start = out;
+    writeLittleEndian(out, Int16BlockHeader::kMagic);
+    // num_bytes is filled in at the end.
+    char *num_bytes_at = out;
+    out += sizeof(uint32_t);
+    writeLittleEndian(out, (uint32_t) num_samples);
+    writeLittleEndian(out, (uint32_t) num_channels);
+    writeLittleEndian(out, (int32_t) sample_step);
+    writeLittleEndian(out, first_sample_number);
+
+    const size_t stride = (size_t) num_channels;
+    for (int c = 0; c < num_channels; c++) {
+        const int16_t *values = frames + c;
+        writeLittleEndian(out, num_samples > 0 ? values[0] : (int16_t) 0);
+
+        // One pass to find the width, one to pack.
+        uint16_t all_bits = 0;
+        for (size_t t = 1; t < (size_t) num_samples; t++) {
+            all_bits |= zigzag(delta(values[t * stride], values[(t - 1) * stride]));
+        }
+        const int bit_width = std::bit_width(all_bits);
+        *out++ = (char) bit_width;
+        if (bit_width == 0) {
+            continue;
+        }
+
+        uint64_t pending = 0;
+        int pending_bits = 0;
+        for (size_t t = 1; t < (size_t) num_samples; t++) {
+            pending |= (uint64_t) zigzag(delta(values[t * stride], values[(t - 1) * stride])) << pending_bits;
+            pending_bits += bit_width;
+            if (pending_bits >= 32) {
+                writeLittleEndian(out, (uint32_t) pending);
+                pending >>= 32;
+                pending_bits -= 32;
+            }
+        }
+        for (; pending_bits > 0; pending_bits -= 8) {
+            *out++ = (char) (uint8_t) pending;
+            pending >>= 8;
+        }
+    }
+
+    auto num_bytes = (uint32_t) (out - start);
+    writeLittleEndian(num_bytes_at, num_bytes);
+    return num_bytes;
+}
+
+bool readInt16BlockHeader(const char *data, size_t size, Int16BlockHeader *header) {
+    if (size < Int16BlockHeader::kSize || readLittleEndian<uint32_t>(data) != Int16BlockHeader::kMagic) {
+        return false;
+    }
+    header->num_bytes = readLittleEndian<uint32_t>(data);
+    header->num_samples = readLittleEndian<uint32_t>(data);
+    header->num_channels = readLittleEndian<uint32_t>(data);
+    header->sample_step = readLittleEndian<int32_t>(data);
+    header->first_sample_number = readLittleEndian<int64_t>(data);
+    return true;
+}
+
+bool decodeInt16Block(const char *data, size_t size, Int16BlockHeader *header, std::vector<int16_t> *values) {
+    if (!readInt16BlockHeader(data, size, header) || header->num_bytes > size) {
+        return false;
+    }
+    const char *in = data + Int16BlockHeader::kSize;
+    const char *const end = data + header->num_bytes;
+    const uint32_t num_samples = header->num_samples;
+    const size_t stride = header->num_channels;
+
+    values->assign((size_t) header->num_channels * num_samples, 0);
+    for (uint32_t c = 0; c < header->num_channels; c++) {
+        if (end - in < 3) {
+            return false;
+        }
+        auto value = readLittleEndian<int16_t>(in);
+        const int bit_width = (uint8_t) *in++;
+        if (bit_width > 16 || (size_t) (end - in) < packedBytes(num_samples > 0 ? num_samples - 1 : 0, bit_width)) {
+            return false;
+        }
+
+        int16_t *channel = values->data() + c;
+        if (num_samples == 0) {
+            continue;
+        }
+        channel[0] = value;
+        uint64_t pending = 0;
+        int pending_bits = 0;
+        const uint64_t mask = (1u << bit_width) - 1;
+        for (uint32_t t = 1; t < num_samples; t++) {
+            while (pending_bits < bit_width) {
+                pending |= (uint64_t) (uint8_t) *in++ << pending_bits;
+                pending_bits += 8;
+            }
+            value = (int16_t) (uint16_t) ((uint16_t) value + (uint16_t) unzigzag((uint16_t) (pending & mask)));
+            channel[t * stride] = value;
+            pending >>= bit_width;
+            pending_bits -= bit_width;
+        }
+    }
+    return in == end;
+}
@@ -0,0 +1,98 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __INT16BLOCKCODEC_H_3A9C6E52__
+#define __INT16BLOCKCODEC_H_3A9C6E52__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+
+    Lossless compression of a block of int16 continuous data: per channel,
+    the first value as is, then the difference to the previous value
+    (wrapping, so it fits in 16 bits), zigzag-encoded (so small negative
+    differences become small numbers) and bit-packed at the fewest bits
+    that fit the channel's largest difference in this block. Neural data
+    changes slowly relative to its range, so this typically takes 4 to 10
+    bits per value instead of 16.
+
+    Each block decodes on its own, and starts with a magic number so that a
+    reader that lost its place (or joined a stream partway through) can find
+    the next block. Layout, all little-endian:
+
+        uint32 magic                 "RI16", i.e. 0x36314952
+        uint32 num_bytes             the whole encoded block, this header included
+        uint32 num_samples
+        uint32 num_channels
+        int32  sample_step           sample numbers advance by this much per sample
+        int64  first_sample_number
+        then per channel:
+            int16 first value
+            uint8 bit width w (0 to 16)
+            (num_samples - 1) zigzag deltas of w bits each, least significant bit first, padded to a whole byte
+
+    Resources/scripts/decode_continuous.py decodes it in Python.
+
+*/
+struct Int16BlockHeader {
+    static constexpr uint32_t kMagic = 0x36314952;
+
+    uint32_t num_bytes = 0;
+    uint32_t num_samples = 0;
+    uint32_t num_channels = 0;
+    int32_t sample_step = 1;
+    int64_t first_sample_number = 0;
+
+    static constexpr size_t kSize = 28;
+};
+
+/** Most bytes encodeInt16Block() can take for a block of this size */
+size_t maxEncodedInt16BlockSize(int num_channels, int num_samples);
+
+/**
+    Encodes num_samples interleaved frames of num_channels values (channel c of frame t at
+    frames[t * num_channels + c], as quantizeToInterleavedInt16() writes them) into out, which must have room for
+    maxEncodedInt16BlockSize(). Returns the number of bytes written, i.e. the header's num_bytes.
+*/
+size_t encodeInt16Block(const int16_t *frames,
+                        int num_channels,
+                        int num_samples,
+                        int64_t first_sample_number,
+                        int sample_step,
+                        char *out);
+
+/**
+    Reads the header at the start of an encoded block. Returns false if size is too small to hold it, or it doesn't
+    start with the magic number.
+*/
+bool readInt16BlockHeader(const char *data, size_t size, Int16BlockHeader *header);
+
+/**
+    Decodes a block into header and values, as interleaved frames like encodeInt16Block() takes. Returns false if
+    the block is malformed or longer than size.
+*/
+bool decodeInt16Block(const char *data, size_t size, Int16BlockHeader *header, std::vector<int16_t> *values);
+
+#endif  // __INT16BLOCKCODEC_H_3A9C6E52__
@@ -0,0 +1,277 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Int16Quantizer.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#define INT16_QUANTIZER_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define INT16_QUANTIZER_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define INT16_QUANTIZER_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// Anything at or beyond these rounds to a value outside of int16.
+constexpr float kSaturateHigh = 32767.5f;
+constexpr float kSaturateLow = -32768.5f;
+
+inline int16_t quantizeOne(float value, float scale, int64_t &saturated) {
+    float v = value * scale;
+    if (v >= kSaturateHigh) {
+        saturated++;
+        return 32767;
+    }
+    // Written this way so that NaN also lands here.
+    if (!(v >= kSaturateLow)) {
+        saturated++;
+        return -32768;
+    }
+    // Ties to even, matching the vector conversions below.
+    return (int16_t) std::nearbyint(v);
+}
+
+/** Scalar fallback for channels [c_begin, c_end) and samples [t_begin, t_end). */
+int64_t quantizeRange(const float *const *channels,
+                      const float *scales,
+                      int c_begin,
+                      int c_end,
+                      int t_begin,
+                      int t_end,
+                      char *out,
+                      size_t frame_stride) {
+    int64_t saturated = 0;
+    for (int t = t_begin; t < t_end; t++) {
+        char *frame = out + frame_stride * t;
+        for (int c = c_begin; c < c_end; c++) {
+            int16_t q = quantizeOne(channels[c][t], scales[c], saturated);
+            memcpy(frame + 2 * c, &q, sizeof(int16_t));
+        }
+    }
+    return saturated;
+}
+
+#if defined(INT16_QUANTIZER_AVX2) || defined(INT16_QUANTIZER_SSE2)
+
+const int kPopcount4[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+
+/** Scales, counts saturation, and converts 8 consecutive floats to 8 saturated int16s. */
+inline __m128i convertEight(const float *src, float scale, int64_t &saturated) {
+#if defined(INT16_QUANTIZER_AVX2)
+    __m256 v = _mm256_mul_ps(_mm256_loadu_ps(src), _mm256_set1_ps(scale));
+    __m256 out_of_range = _mm256_or_ps(_mm256_cmp_ps(v, _mm256_set1_ps(kSaturateHigh), _CMP_GE_OQ),
+                                       _mm256_cmp_ps(v, _mm256_set1_ps(kSaturateLow), _CMP_NGE_UQ));
+    int mask = _mm256_movemask_ps(out_of_range);
+    saturated += kPopcount4[mask & 0xF] + kPopcount4[mask >> 4];
+
+    // Clamp before converting, since out-of-range conversions produce INT_MIN regardless of sign. max() returns
+    // its second operand for NaN, so NaN becomes -32768.
+    v = _mm256_min_ps(_mm256_max_ps(v, _mm256_set1_ps(-32768.0f)), _mm256_set1_ps(32767.0f));
+    __m256i i = _mm256_cvtps_epi32(v);
+    return _mm_packs_epi32(_mm256_castsi256_si128(i), _mm256_extracti128_si256(i, 1));
+#else
+    const __m128 s = _mm_set1_ps(scale);
+    __m128 a = _mm_mul_ps(_mm_loadu_ps(src), s);
+    __m128 b = _mm_mul_ps(_mm_loadu_ps(src + 4), s);
+
+    const __m128 high = _mm_set1_ps(kSaturateHigh);
+    const __m128 low = _mm_set1_ps(kSaturateLow);
+    saturated += kPopcount4[_mm_movemask_ps(_mm_or_ps(_mm_cmpge_ps(a, high), _mm_cmpnge_ps(a, low)))];
+    saturated += kPopcount4[_mm_movemask_ps(_mm_or_ps(_mm_cmpge_ps(b, high), _mm_cmpnge_ps(b, low)))];
+
+    // See above re: clamping and NaN.
+    const __m128 min_value = _mm_set1_ps(-32768.0f);
+    const __m128 max_value = _mm_set1_ps(32767.0f);
+    a = _mm_min_ps(_mm_max_ps(a, min_value), max_value);
+    b = _mm_min_ps(_mm_max_ps(b, min_value), max_value);
+    return _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+#endif
+}
+
+/** Quantizes an 8 channel x 8 sample tile and writes it transposed, i.e. as 8 partial frames. */
+inline void quantizeTile(const float *const *channels,
+                         const float *scales,
+                         int c0,
+                         int t0,
+                         char *out,
+                         size_t frame_stride,
+                         int64_t &saturated) {
+    // One row per channel, 8 samples each...
+    __m128i r0 = convertEight(channels[c0 + 0] + t0, scales[c0 + 0], saturated);
+    __m128i r1 = convertEight(channels[c0 + 1] + t0, scales[c0 + 1], saturated);
+    __m128i r2 = convertEight(channels[c0 + 2] + t0, scales[c0 + 2], saturated);
+    __m128i r3 = convertEight(channels[c0 + 3] + t0, scales[c0 + 3], saturated);
+    __m128i r4 = convertEight(channels[c0 + 4] + t0, scales[c0 + 4], saturated);
+    __m128i r5 = convertEight(channels[c0 + 5] + t0, scales[c0 + 5], saturated);
+    __m128i r6 = convertEight(channels[c0 + 6] + t0, scales[c0 + 6], saturated);
+    __m128i r7 = convertEight(channels[c0 + 7] + t0, scales[c0 + 7], saturated);
+
+    // ...transposed into one row per sample, 8 channels each.
+    __m128i p0 = _mm_unpacklo_epi16(r0, r1);
+    __m128i p1 = _mm_unpackhi_epi16(r0, r1);
+    __m128i p2 = _mm_unpacklo_epi16(r2, r3);
+    __m128i p3 = _mm_unpackhi_epi16(r2, r3);
+    __m128i p4 = _mm_unpacklo_epi16(r4, r5);
+    __m128i p5 = _mm_unpackhi_epi16(r4, r5);
+    __m128i p6 = _mm_unpacklo_epi16(r6, r7);
+    __m128i p7 = _mm_unpackhi_epi16(r6, r7);
+
+    __m128i u0 = _mm_unpacklo_epi32(p0, p2);
+    __m128i u1 = _mm_unpackhi_epi32(p0, p2);
+    __m128i u2 = _mm_unpacklo_epi32(p1, p3);
+    __m128i u3 = _mm_unpackhi_epi32(p1, p3);
+    __m128i u4 = _mm_unpacklo_epi32(p4, p6);
+    __m128i u5 = _mm_unpackhi_epi32(p4, p6);
+    __m128i u6 = _mm_unpacklo_epi32(p5, p7);
+    __m128i u7 = _mm_unpackhi_epi32(p5, p7);
+
+    char *dst = out + frame_stride * t0 + 2 * c0;
+    _mm_storeu_si128((__m128i *) (dst + frame_stride * 0), _mm_unpacklo_epi64(u0, u4));
+    _mm_storeu_si128((__m128i *) (dst + frame_stride * 1), _mm_unpackhi_epi64(u0, u4));
+    _mm_storeu_si128((__m128i *) (dst + frame_stride * 2), _mm_unpacklo_epi64(u1, u5));
+    _mm_storeu_si128((__m128i *) (dst + frame_stride * 3), _mm_unpackhi_epi64(u1, u5));
+    _mm_storeu_si128((__m128i *) (dst + frame_stride * 4), _mm_unpacklo_epi64(u2, u6));
+    _mm_storeu_si128((__m128i *) (dst + frame_stride * 5), _mm_unpackhi_epi64(u2, u6));
+    _mm_storeu_si128((__m128i *) (dst + frame_stride * 6), _mm_unpacklo_epi64(u3, u7));
+    _mm_storeu_si128((__m128i *) (dst + frame_stride * 7), _mm_unpackhi_epi64(u3, u7));
+}
+
+#elif defined(INT16_QUANTIZER_NEON)
+
+inline int16x8_t convertEight(const float *src, float scale, int64_t &saturated) {
+    const float32x4_t s = vdupq_n_f32(scale);
+    float32x4_t a = vmulq_f32(vld1q_f32(src), s);
+    float32x4_t b = vmulq_f32(vld1q_f32(src + 4), s);
+
+    const float32x4_t high = vdupq_n_f32(kSaturateHigh);
+    const float32x4_t low = vdupq_n_f32(kSaturateLow);
+    uint32x4_t out_a = vorrq_u32(vcgeq_f32(a, high), vmvnq_u32(vcgeq_f32(a, low)));
+    uint32x4_t out_b = vorrq_u32(vcgeq_f32(b, high), vmvnq_u32(vcgeq_f32(b, low)));
+    saturated += vaddvq_u32(vshrq_n_u32(out_a, 31)) + vaddvq_u32(vshrq_n_u32(out_b, 31));
+
+    // maxnm/minnm return the number when the other operand is NaN, so NaN becomes -32768.
+    const float32x4_t min_value = vdupq_n_f32(-32768.0f);
+    const float32x4_t max_value = vdupq_n_f32(32767.0f);
+    a = vminnmq_f32(vmaxnmq_f32(a, min_value), max_value);
+    b = vminnmq_f32(vmaxnmq_f32(b, min_value), max_value);
+    return vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b)));
+}
+
+inline void quantizeTile(const float *const *channels,
+                         const float *scales,
+                         int c0,
+                         int t0,
+                         char *out,
+                         size_t frame_stride,
+                         int64_t &saturated) {
+    int16x8_t r[8];
+    for (int i = 0; i < 8; i++) {
+        r[i] = convertEight(channels[c0 + i] + t0, scales[c0 + i], saturated);
+    }
+
+    int16x8x2_t t01 = vtrnq_s16(r[0], r[1]);
+    int16x8x2_t t23 = vtrnq_s16(r[2], r[3]);
+    int16x8x2_t t45 = vtrnq_s16(r[4], r[5]);
+    int16x8x2_t t67 = vtrnq_s16(r[6], r[7]);
+
+    // Even samples (0, 4 | 2, 6) and odd samples (1, 5 | 3, 7) of channels 0-3 and 4-7.
+    int32x4x2_t u02 = vtrnq_s32(vreinterpretq_s32_s16(t01.val[0]), vreinterpretq_s32_s16(t23.val[0]));
+    int32x4x2_t u13 = vtrnq_s32(vreinterpretq_s32_s16(t01.val[1]), vreinterpretq_s32_s16(t23.val[1]));
+    int32x4x2_t u46 = vtrnq_s32(vreinterpretq_s32_s16(t45.val[0]), vreinterpretq_s32_s16(t67.val[0]));
+    int32x4x2_t u57 = vtrnq_s32(vreinterpretq_s32_s16(t45.val[1]), vreinterpretq_s32_s16(t67.val[1]));
+
+    int32x4_t frames[8] = {
+            vcombine_s32(vget_low_s32(u02.val[0]), vget_low_s32(u46.val[0])),
+            vcombine_s32(vget_low_s32(u13.val[0]), vget_low_s32(u57.val[0])),
+            vcombine_s32(vget_low_s32(u02.val[1]), vget_low_s32(u46.val[1])),
+            vcombine_s32(vget_low_s32(u13.val[1]), vget_low_s32(u57.val[1])),
+            vcombine_s32(vget_high_s32(u02.val[0]), vget_high_s32(u46.val[0])),
+            vcombine_s32(vget_high_s32(u13.val[0]), vget_high_s32(u57.val[0])),
+            vcombine_s32(vget_high_s32(u02.val[1]), vget_high_s32(u46.val[1])),
+            vcombine_s32(vget_high_s32(u13.val[1]), vget_high_s32(u57.val[1])),
+    };
+
+    char *dst = out + frame_stride * t0 + 2 * c0;
+    for (int i = 0; i < 8; i++) {
+        vst1q_s16((int16_t *) (dst + frame_stride * i), vreinterpretq_s16_s32(frames[i]));
+    }
+}
+
+#endif
+
+}  // namespace
+
+int64_t quantizeToInterleavedInt16Scalar(const float *const *channels,
+                                         const float *scales,
+                                         int num_channels,
+                                         int num_samples,
+                                         char *out,
+                                         size_t frame_stride) {
+    return quantizeRange(channels, scales, 0, num_channels, 0, num_samples, out, frame_stride);
+}
+
+int64_t quantizeToInterleavedInt16(const float *const *channels,
+                                   const float *scales,
+                                   int num_channels,
+                                   int num_samples,
+                                   char *out,
+                                   size_t frame_stride) {
+#if defined(INT16_QUANTIZER_AVX2) || defined(INT16_QUANTIZER_SSE2) || defined(INT16_QUANTIZER_NEON)
+    int64_t saturated = 0;
+    const int vector_channels = num_channels & ~7;
+    const int vector_samples = num_samples & ~7;
+
+    // Sample-major so that each pass writes 8 whole frames before moving on.
+    for (int t = 0; t < vector_samples; t += 8) {
+        for (int c = 0; c < vector_channels; c += 8) {
+            quantizeTile(channels, scales, c, t, out, frame_stride, saturated);
+        }
+    }
+
+    // Channels that don't fill a tile, then samples that don't fill a tile.
+    saturated += quantizeRange(channels, scales, vector_channels, num_channels, 0, vector_samples, out, frame_stride);
+    saturated += quantizeRange(channels, scales, 0, num_channels, vector_samples, num_samples, out, frame_stride);
+    return saturated;
+#else
+    return quantizeToInterleavedInt16Scalar(channels, scales, num_channels, num_samples, out, frame_stride);
+#endif
+}
+
+const char *int16QuantizerKernelName() {
+#if defined(INT16_QUANTIZER_AVX2)
+    return "AVX2";
+#elif defined(INT16_QUANTIZER_SSE2)
+    return "SSE2";
+#elif defined(INT16_QUANTIZER_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,67 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __INT16QUANTIZER_H_5E2B7F14__
+#define __INT16QUANTIZER_H_5E2B7F14__
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+
+    Converts planar float channels (as found in an AudioSampleBuffer) into
+    interleaved int16 frames.
+
+    Each value is multiplied by its channel's scale (typically 1 / bitVolts),
+    rounded to nearest (ties to even) and saturated to the int16 range. Frame
+    t starts at out + t * frame_stride bytes, and channel c is written at byte
+    offset 2 * c within the frame; any bytes after the last channel (e.g. a
+    sample number) are left untouched.
+
+    Returns the number of values that were clipped to the int16 range. NaNs
+    are written as -32768 and counted as clipped.
+
+    The vectorized kernel is picked at compile time: AVX2 when built with
+    -mavx2 (or /arch:AVX2), otherwise SSE2 on x86-64 and NEON on AArch64,
+    falling back to quantizeToInterleavedInt16Scalar() elsewhere.
+
+*/
+int64_t quantizeToInterleavedInt16(const float *const *channels,
+                                   const float *scales,
+                                   int num_channels,
+                                   int num_samples,
+                                   char *out,
+                                   size_t frame_stride);
+
+/** Reference implementation of quantizeToInterleavedInt16(), one value at a time. */
+int64_t quantizeToInterleavedInt16Scalar(const float *const *channels,
+                                         const float *scales,
+                                         int num_channels,
+                                         int num_samples,
+                                         char *out,
+                                         size_t frame_stride);
+
+/** Name of the kernel quantizeToInterleavedInt16() was compiled with, e.g. "AVX2" */
+const char *int16QuantizerKernelName();
+
+#endif  // __INT16QUANTIZER_H_5E2B7F14__
@@ -0,0 +1,169 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "PolyphaseDecimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// ~80 dB of stopband attenuation.
+constexpr double kKaiserBeta = 8.0;
+
+// Fraction of the output Nyquist frequency to pass.
+constexpr double kPassbandFraction = 0.9;
+
+/** Zeroth-order modified Bessel function of the first kind, for the Kaiser window */
+double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+std::vector<float> designLowpass(int num_taps, double cutoff) {
+    std::vector<double> taps(num_taps);
+    const double center = (num_taps - 1) / 2.0;
+    const double window_norm = besselI0(kKaiserBeta);
+    double sum = 0;
+    for (int i = 0; i < num_taps; i++) {
+        double x = i - center;
+        double sinc = x == 0 ? 2 * cutoff : std::sin(2 * kPi * cutoff * x) / (kPi * x);
+        double r = num_taps > 1 ? 2.0 * i / (num_taps - 1) - 1.0 : 0.0;
+        double window = besselI0(kKaiserBeta * std::sqrt(std::max(0.0, 1.0 - r * r))) / window_norm;
+        taps[i] = sinc * window;
+        sum += taps[i];
+    }
+
+    // Unity gain at DC.
+    std::vector<float> normalized(num_taps);
+    for (int i = 0; i < num_taps; i++) {
+        normalized[i] = (float) (taps[i] / sum);
+    }
+    return normalized;
+}
+
+}  // namespace
+
+PolyphaseDecimator::PolyphaseDecimator(int num_channels, int factor, int taps_per_phase)
+        : num_channels_(std::max(1, num_channels)),
+          factor_(std::max(1, factor)),
+          cutoff_(kPassbandFraction * 0.5 / std::max(1, factor)),
+          taps_(designLowpass(std::max(1, factor) * std::max(1, taps_per_phase) + 1, cutoff_)),
+          max_block_size_(0),
+          phase_(0),
+          accumulator_(num_channels_) {
+    // Stored reversed so that both the taps and the history are walked forwards.
+    std::reverse(taps_.begin(), taps_.end());
+    reset();
+}
+
+int PolyphaseDecimator::numOutputsFor(int num_samples) const {
+    if (num_samples <= phase_) {
+        return 0;
+    }
+    return (num_samples - phase_ + factor_ - 1) / factor_;
+}
+
+int PolyphaseDecimator::nextOutputOffset() const {
+    return phase_;
+}
+
+int PolyphaseDecimator::process(const float *const *channels, int num_samples, float *const *out) {
+    if (num_samples <= 0) {
+        return 0;
+    }
+
+    const int history_size = numTaps() - 1;
+    if (num_samples > max_block_size_) {
+        max_block_size_ = num_samples;
+        history_.resize((size_t) (history_size + max_block_size_) * num_channels_);
+    }
+
+    // Planar -> interleaved, after the history from previous blocks.
+    float *block = history_.data() + (size_t) history_size * num_channels_;
+    for (int c = 0; c < num_channels_; c++) {
+        const float *src = channels[c];
+        for (int t = 0; t < num_samples; t++) {
+            block[(size_t) t * num_channels_ + c] = src[t];
+        }
+    }
+
+    const int num_taps = numTaps();
+    const float *taps = taps_.data();
+    float *acc = accumulator_.data();
+    int num_outputs = 0;
+    for (int t = phase_; t < num_samples; t += factor_) {
+        // Input frame t sits at history index t + history_size, so the window starts at frame t.
+        const float *window = history_.data() + (size_t) t * num_channels_;
+        std::fill(acc, acc + num_channels_, 0.0f);
+        for (int k = 0; k < num_taps; k++) {
+            const float h = taps[k];
+            const float *frame = window + (size_t) k * num_channels_;
+            for (int c = 0; c < num_channels_; c++) {
+                acc[c] += h * frame[c];
+            }
+        }
+        for (int c = 0; c < num_channels_; c++) {
+            out[c][num_outputs] = acc[c];
+        }
+        num_outputs++;
+    }
+    phase_ = (phase_ - num_samples) % factor_;
+    if (phase_ < 0) {
+        phase_ += factor_;
+    }
+
+    // Keep the last history_size frames for the next block.
+    memmove(history_.data(),
+            history_.data() + (size_t) num_samples * num_channels_,
+            (size_t) history_size * num_channels_ * sizeof(float));
+    return num_outputs;
+}
+
+void PolyphaseDecimator::reset() {
+    std::fill(history_.begin(), history_.end(), 0.0f);
+    if (history_.empty()) {
+        history_.assign((size_t) (numTaps() - 1) * num_channels_, 0.0f);
+    }
+    phase_ = 0;
+}
+
+std::string PolyphaseDecimator::description(double input_sampling_rate) const {
+    std::ostringstream ss;
+    ss << "Kaiser-windowed sinc lowpass (beta " << kKaiserBeta << "), "
+       << numTaps() << " taps, cutoff " << cutoff_ * input_sampling_rate << " Hz, "
+       << "group delay " << groupDelaySamples() << " input samples";
+    return ss.str();
+}
@@ -0,0 +1,112 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __POLYPHASEDECIMATOR_H_8C4D21E7__
+#define __POLYPHASEDECIMATOR_H_8C4D21E7__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+
+    Low-pass filters and downsamples a set of channels by an integer factor.
+
+    The anti-aliasing filter is a Kaiser-windowed sinc with a cutoff at 90% of
+    the output Nyquist frequency. Only every factor-th output of the filter
+    is kept, so it is only evaluated at those points, i.e. one polyphase
+    branch sum per output rather than a full-rate convolution.
+
+    Filter state is kept across calls to process(), so consecutive blocks are
+    filtered as one continuous signal regardless of how they're split up.
+    History is stored channel-interleaved so that the inner loop runs over
+    contiguous channels, which the compiler vectorizes.
+
+    Not thread safe; meant to be driven from the processing thread only.
+
+*/
+class PolyphaseDecimator
+{
+public:
+    /** Constructor. taps_per_phase sets the filter length: factor * taps_per_phase + 1 taps. */
+    PolyphaseDecimator(int num_channels, int factor, int taps_per_phase = 16);
+
+    /** Number of outputs the next process() call will produce for a block of num_samples */
+    int numOutputsFor(int num_samples) const;
+
+    /**
+        Offset, relative to the first sample of the next block, of the input
+        sample that the next output lines up with (before group delay). Later
+        outputs in the same block follow every factor() samples.
+    */
+    int nextOutputOffset() const;
+
+    /**
+        Filters a block of planar channels and writes numOutputsFor(num_samples)
+        outputs per channel to out[c]. Returns the number of outputs written.
+        Only allocates if num_samples is larger than any previous block.
+    */
+    int process(const float* const* channels, int num_samples, float* const* out);
+
+    /** Forgets all history, e.g. between acquisitions */
+    void reset();
+
+    int factor() const {
+        return factor_;
+    }
+
+    int numTaps() const {
+        return (int) taps_.size();
+    }
+
+    /** Delay introduced by the filter, in input samples */
+    double groupDelaySamples() const {
+        return (taps_.size() - 1) / 2.0;
+    }
+
+    /** Cutoff frequency, as a fraction of the input sampling rate */
+    double cutoff() const {
+        return cutoff_;
+    }
+
+    /** Human-readable summary of the filter, for stream metadata */
+    std::string description(double input_sampling_rate) const;
+
+private:
+    const int num_channels_;
+    const int factor_;
+    const double cutoff_;
+    std::vector<float> taps_;
+
+    // Last numTaps() - 1 input frames, followed by room for the current block; frame-major.
+    std::vector<float> history_;
+    int max_block_size_;
+
+    // Input samples to skip before the next output.
+    int phase_;
+
+    // One accumulator per channel.
+    std::vector<float> accumulator_;
+};
+
+#endif  // __POLYPHASEDECIMATOR_H_8C4D21E7__
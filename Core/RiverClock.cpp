@@ -0,0 +1,45 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "RiverClock.h"
+
+std::vector<river::FieldDefinition> riverClockFields() {
+    return {river::FieldDefinition("sample_number", river::FieldDefinition::INT64, 8),
+            river::FieldDefinition("steady_ns", river::FieldDefinition::INT64, 8),
+            river::FieldDefinition("system_ns", river::FieldDefinition::INT64, 8)};
+}
+
+ClockSampler::ClockSampler(int64_t interval_ns)
+        : interval_ns_(interval_ns > 0 ? interval_ns : 0),
+          started_(false),
+          last_ns_(0) {
+}
+
+bool ClockSampler::due(int64_t steady_ns) {
+    if (started_ && steady_ns - last_ns_ < interval_ns_) {
+        return false;
+    }
+    started_ = true;
+    last_ns_ = steady_ns;
+    return true;
+}
@@ -0,0 +1,79 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __RIVERCLOCK_H_7C1E4B92__
+#define __RIVERCLOCK_H_7C1E4B92__
+
+#include <river/river.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// One sample of a clock stream: a sample number and the host's clocks when it was current. Packed like RiverSpike.
+typedef struct {
+    int64_t sample_number;
+    // std::chrono::steady_clock, and system_clock (since the Unix epoch), both in ns.
+    int64_t steady_ns;
+    int64_t system_ns;
+} __attribute__((__packed__)) RiverClockSample;
+
+static_assert(sizeof(RiverClockSample) == 24, "RiverClockSample must match its River schema");
+
+/** sample_number, steady_ns and system_ns; the layout of RiverClockSample */
+std::vector<river::FieldDefinition> riverClockFields();
+
+/** Writes one clock sample to dst, which needn't be aligned. */
+inline void packRiverClockSample(char *dst, int64_t sample_number, int64_t steady_ns, int64_t system_ns) {
+    RiverClockSample sample;
+    sample.sample_number = sample_number;
+    sample.steady_ns = steady_ns;
+    sample.system_ns = system_ns;
+    memcpy(dst, &sample, sizeof(RiverClockSample));
+}
+
+/**
+    Decides which blocks get a clock sample: every block if the interval is
+    0, otherwise the first block at least one interval after the last
+    sample (so samples are never closer together than the interval, and
+    drift later by up to one block each time).
+*/
+class ClockSampler
+{
+public:
+    explicit ClockSampler(int64_t interval_ns);
+
+    /** Whether a sample is due at steady_ns; if so, it counts as taken. The first call always is. */
+    bool due(int64_t steady_ns);
+
+    int64_t intervalNs() const {
+        return interval_ns_;
+    }
+
+private:
+    const int64_t interval_ns_;
+    bool started_;
+    int64_t last_ns_;
+};
+
+#endif  // __RIVERCLOCK_H_7C1E4B92__
@@ -0,0 +1,54 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __RIVERSPIKE_H_A41C7E20__
+#define __RIVERSPIKE_H_A41C7E20__
+
+#include <river/river.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// For writing spikes to River. Ensure it's packed so that padding doesn't mess up the size of the struct.
+typedef struct {
+    int32_t channel_index;
+    int32_t unit_index;
+    int64_t sample_number;
+} __attribute__((__packed__)) RiverSpike;
+
+static_assert(sizeof(RiverSpike) == 16, "RiverSpike must match its River schema");
+
+/** channel_index, unit_index and sample_number; the layout of RiverSpike */
+std::vector<river::FieldDefinition> riverSpikeFields();
+
+/** Writes one spike header to dst, which needn't be aligned. */
+inline void packRiverSpike(char *dst, int32_t channel_index, int32_t unit_index, int64_t sample_number) {
+    RiverSpike spike;
+    spike.channel_index = channel_index;
+    spike.unit_index = unit_index;
+    spike.sample_number = sample_number;
+    memcpy(dst, &spike, sizeof(RiverSpike));
+}
+
+#endif  // __RIVERSPIKE_H_A41C7E20__
@@ -0,0 +1,688 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "RiverWriterQueue.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+
+void WakeSignal::signal() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        signalled_ = true;
+    }
+    condition_.notify_one();
+}
+
+bool WakeSignal::wait(int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (timeout_ms < 0) {
+        condition_.wait(lock, [this]() { return signalled_; });
+    } else if (!condition_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this]() { return signalled_; })) {
+        return false;
+    }
+    signalled_ = false;
+    return true;
+}
+
+namespace {
+
+size_t slabCapacityFor(const RiverWriterOptions& options) {
+    // No bigger than the whole queue, or a large max_batch_size would inflate the arena well past capacity_bytes.
+    size_t max_batch_bytes = (size_t) std::max(1, options.max_batch_size) * (size_t) std::max(1, options.sample_size);
+    return std::min(max_batch_bytes, std::max((size_t) 1, options.capacity_bytes));
+}
+
+int64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+size_t maxBatchesFor(const RiverWriterOptions& options) {
+    // Every batch holds at least one sample. Need at least two so one can be filled while the other is written.
+    size_t max_samples = options.capacity_bytes / (size_t) std::max(1, options.sample_size);
+    return std::clamp(max_samples, (size_t) 2, RiverWriterQueue::kMaxBatches);
+}
+
+}  // namespace
+
+RiverWriterQueue::RiverWriterQueue(BatchSink *sink, const RiverWriterOptions& options)
+        : consumer_(nullptr),
+          options_(options),
+          capacity_bytes_(std::max((size_t) 1, options.capacity_bytes)),
+          slab_capacity_(slabCapacityFor(options)),
+          max_batches_(maxBatchesFor(options)),
+          max_latency_(options.max_latency_ms),
+          filled_slabs_(max_batches_),
+          free_slabs_(max_batches_),
+          slabs_(max_batches_),
+          // A batch that doesn't fit before the end of the arena starts over at the beginning, leaving the rest of
+          // the end unused until the arena wraps around again. The slack keeps that from eating into the budget.
+          arena_size_(capacity_bytes_ + 2 * slab_capacity_),
+          arena_(new char[arena_size_]),
+          slabs_in_use_(max_batches_, nullptr),
+          oldest_in_use_(0),
+          num_in_use_(0),
+          arena_head_(0),
+          arena_tail_(0),
+          current_slab_(nullptr),
+          reserved_bytes_(0),
+          reserved_samples_(0),
+          bytes_in_(0),
+          bytes_recycled_(0),
+          num_dropped_newest_(0),
+          num_dropped_oldest_(0),
+          num_dropped_timed_out_(0),
+          num_dropped_failed_(0),
+          spool_failing_(false),
+          retry_slab_(nullptr),
+          reconnect_delay_ms_(std::max(1, options.reconnect_initial_ms)),
+          spool_pending_samples_(0),
+          spool_pending_bytes_(0),
+          num_spooled_(0),
+          num_replayed_(0),
+          sink_disconnected_(false),
+          outage_start_ns_(0),
+          total_outage_ns_(0),
+          longest_outage_ns_(0),
+          num_reconnect_attempts_(0),
+          num_reconnects_(0),
+          queue_depth_high_water_(0),
+          bytes_written_(0),
+          samples_written_(0),
+          batches_written_(0) {
+    sink_ = sink;
+
+    spare_slabs_.reserve(max_batches_);
+    for (auto &slab: slabs_) {
+        spare_slabs_.push_back(&slab);
+    }
+}
+
+RiverWriterPool::RiverWriterPool(const std::vector<RiverWriterQueue *>& queues, int num_threads) {
+    int n = std::max(1, std::min(num_threads, (int) queues.size()));
+    for (int i = 0; i < n; i++) {
+        workers_.push_back(std::make_unique<Worker>(i));
+    }
+    for (size_t i = 0; i < queues.size(); i++) {
+        Worker *worker = workers_[i % workers_.size()].get();
+        worker->queues.push_back(queues[i]);
+        queues[i]->consumer_ = &worker->wake;
+    }
+}
+
+RiverWriterPool::~RiverWriterPool() {
+    stop();
+}
+
+void RiverWriterPool::start() {
+    for (auto &worker: workers_) {
+        if (!worker->thread.joinable()) {
+            worker->should_exit = false;
+            Worker *w = worker.get();
+            worker->thread = std::thread([w]() { w->run(); });
+        }
+    }
+}
+
+void RiverWriterPool::stop() {
+    // Ask every thread first so they all wind down in parallel.
+    for (auto &worker: workers_) {
+        worker->should_exit = true;
+        worker->wake.signal();
+    }
+    for (auto &worker: workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+int RiverWriterPool::numThreads() const {
+    return (int) workers_.size();
+}
+
+int RiverWriterPool::defaultNumThreads(int num_queues) {
+    int num_cpus = (int) std::thread::hardware_concurrency();
+    return std::max(1, std::min(num_queues, std::max(1, num_cpus)));
+}
+
+RiverWriterPool::Worker::Worker(int index)
+        : index(index),
+          should_exit(false) {
+}
+
+void RiverWriterPool::Worker::run() {
+#if defined(__linux__)
+    // Shows up in perf and top; Linux limits names to 15 characters.
+    char name[16];
+    snprintf(name, sizeof(name), "RiverWriter-%d", index);
+    pthread_setname_np(pthread_self(), name);
+#endif
+    if (Tracer::enabled()) {
+        char trace_name[32];
+        snprintf(trace_name, sizeof(trace_name), "RiverWriter-%d", index);
+        Tracer::setThreadName(trace_name);
+    }
+
+    while (!should_exit.load()) {
+        // Send all batches that are queued up, and find out when the next one wants a retry or more replaying.
+        int wait_ms = -1;
+        for (auto *queue: queues) {
+            int queue_wait_ms = queue->writeFilledSlabs();
+            if (queue_wait_ms >= 0 && (wait_ms < 0 || queue_wait_ms < wait_ms)) {
+                wait_ms = queue_wait_ms;
+            }
+        }
+
+        // Check again pre-emptively so we can bail before sleeping
+        if (should_exit.load()) {
+            break;
+        }
+
+        // Woken by any of its queues' publish() once a batch is full or due, or by stop(). A signal() that arrives
+        // before we get here isn't lost: it stays signalled until the next wait().
+        if (wait_ms != 0) {
+            wake.wait(wait_ms);
+        }
+    }
+
+    // Write out anything published right before stopping. Whoever stopped us is waiting (usually the message
+    // thread), so a long spool only gets a head start.
+    auto replay_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kStopReplayMs);
+    for (auto *queue: queues) {
+        queue->finish(replay_deadline);
+    }
+}
+
+int RiverWriterQueue::writeFilledSlabs() {
+    return writeSlabs(false, std::chrono::steady_clock::time_point::max());
+}
+
+void RiverWriterQueue::finish(std::chrono::steady_clock::time_point replay_deadline) {
+    writeSlabs(true, replay_deadline);
+
+    // The sink is still down; without a spool, that's the end of these.
+    PayloadSlab *slab;
+    if (retry_slab_) {
+        num_dropped_failed_.fetch_add(retry_slab_->num_samples, std::memory_order_relaxed);
+        recycle(retry_slab_);
+        retry_slab_ = nullptr;
+    }
+    while (filled_slabs_.tryPop(slab)) {
+        num_dropped_failed_.fetch_add(slab->num_samples, std::memory_order_relaxed);
+        recycle(slab);
+    }
+}
+
+int RiverWriterQueue::writeSlabs(bool force, std::chrono::steady_clock::time_point replay_deadline) {
+    RIVER_TRACE_SCOPE("RiverWriterQueue::writeFilledSlabs");
+    PayloadSlab *slab;
+    if (!options_.spool_path.empty()) {
+        while (filled_slabs_.tryPop(slab)) {
+            writeOrSpool(slab);
+            recycle(slab);
+        }
+        return replaySpool(force, replay_deadline);
+    }
+
+    // Without a spool, slabs wait in the queue until the sink is back.
+    if (!sinkReady(force)) {
+        return msUntilReconnect();
+    }
+    if (retry_slab_) {
+        if (!tryWriteSlab(retry_slab_)) {
+            return msUntilReconnect();
+        }
+        recycle(retry_slab_);
+        retry_slab_ = nullptr;
+    }
+    while (filled_slabs_.tryPop(slab)) {
+        if (!tryWriteSlab(slab)) {
+            // Can't go back in the ring, so hold on to it here. DROP_OLDEST can't steal it, which is fine: it's just
+            // one slab.
+            retry_slab_ = slab;
+            return msUntilReconnect();
+        }
+        recycle(slab);
+    }
+    return -1;
+}
+
+void RiverWriterQueue::recycle(PayloadSlab *slab) {
+    bytes_recycled_.fetch_add((int64_t) slab->num_bytes, std::memory_order_relaxed);
+    // Can't fail: the ring has room for every slab.
+    free_slabs_.tryPush(slab);
+    if (options_.overflow_policy == OverflowPolicy::BLOCK) {
+        slab_freed_.signal();
+    }
+}
+
+void RiverWriterQueue::writeOrSpool(PayloadSlab *slab) {
+    // Anything already spooled has to go first to keep the stream in order. And if the producer is close to filling
+    // the queue, spooling (a memcpy) frees slabs faster than waiting on the sink would.
+    bool falling_behind = queuedBytes() >= capacity_bytes_ / 2;
+    if ((spool_ && !spool_->empty()) || sink_disconnected_.load(std::memory_order_relaxed) || falling_behind) {
+        spool(slab->data, slab->num_bytes, slab->num_samples);
+        return;
+    }
+
+    if (!tryWriteSlab(slab)) {
+        spool(slab->data, slab->num_bytes, slab->num_samples);
+    }
+}
+
+bool RiverWriterQueue::tryWriteSlab(PayloadSlab *slab) {
+    if (!tryWriteToSink(slab->data, slab->num_bytes, slab->num_samples)) {
+        return false;
+    }
+    flush_latency_us_.record(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - slab->first_sample_time).count());
+    batch_size_.record(slab->num_samples);
+    return true;
+}
+
+bool RiverWriterQueue::tryWriteToSink(const char *data, size_t num_bytes, int64_t num_samples) {
+    RIVER_TRACE_SCOPE("BatchSink::write");
+    auto write_start = std::chrono::steady_clock::now();
+    try {
+        sink_->write(data, num_bytes, num_samples);
+    } catch (const std::exception& e) {
+        if (outage_start_ns_.load(std::memory_order_relaxed) == 0) {
+            outage_start_ns_.store(steadyNowNs());
+            log("Writing to River failed, reconnecting: " + std::string(e.what()));
+        }
+        scheduleReconnect();
+        return false;
+    }
+    write_duration_us_.record(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - write_start).count());
+    bytes_written_.fetch_add((int64_t) num_bytes, std::memory_order_relaxed);
+    samples_written_.fetch_add(num_samples, std::memory_order_relaxed);
+    batches_written_.fetch_add(1, std::memory_order_relaxed);
+
+    int64_t outage_start_ns = outage_start_ns_.load(std::memory_order_relaxed);
+    if (outage_start_ns != 0) {
+        int64_t outage_ns = steadyNowNs() - outage_start_ns;
+        total_outage_ns_.fetch_add(outage_ns, std::memory_order_relaxed);
+        if (outage_ns > longest_outage_ns_.load(std::memory_order_relaxed)) {
+            longest_outage_ns_.store(outage_ns, std::memory_order_relaxed);
+        }
+        num_reconnects_.fetch_add(1, std::memory_order_relaxed);
+        outage_start_ns_.store(0);
+        reconnect_delay_ms_ = options_.reconnect_initial_ms;
+        char outage_s[32];
+        snprintf(outage_s, sizeof(outage_s), "%.1f", outage_ns / 1e9);
+        log("Writing to River again after " + std::string(outage_s) + " s");
+    }
+    return true;
+}
+
+bool RiverWriterQueue::sinkReady(bool force) {
+    if (!sink_disconnected_.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    if (!force && std::chrono::steady_clock::now() < next_reconnect_) {
+        return false;
+    }
+
+    RIVER_TRACE_SCOPE("BatchSink::reconnect");
+    num_reconnect_attempts_.fetch_add(1, std::memory_order_relaxed);
+    try {
+        sink_->reconnect();
+    } catch (const std::exception& e) {
+        scheduleReconnect();
+        return false;
+    }
+    sink_disconnected_.store(false);
+    return true;
+}
+
+void RiverWriterQueue::scheduleReconnect() {
+    sink_disconnected_.store(true);
+    next_reconnect_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(reconnect_delay_ms_);
+    reconnect_delay_ms_ = std::min(std::max(1, reconnect_delay_ms_ * 2), std::max(1, options_.reconnect_max_ms));
+}
+
+int RiverWriterQueue::msUntilReconnect() const {
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            next_reconnect_ - std::chrono::steady_clock::now());
+    // Rounding down to 0 would mean "call again straight away", which would spin until the deadline.
+    return std::max(1, (int) remaining.count());
+}
+
+bool RiverWriterQueue::spool(const char *data, size_t num_bytes, int64_t num_samples) {
+    RIVER_TRACE_SCOPE("SpoolFile::append");
+    try {
+        if (!spool_) {
+            spool_ = std::make_unique<SpoolFile>(options_.spool_path);
+        }
+        spool_->append(data, num_bytes, num_samples);
+    } catch (const std::exception& e) {
+        if (!spool_failing_) {
+            log("Couldn't spool to " + options_.spool_path + ", dropping samples until it works again: "
+                + std::string(e.what()));
+            spool_failing_ = true;
+        }
+        num_dropped_failed_.fetch_add(num_samples, std::memory_order_relaxed);
+        return false;
+    }
+    spool_failing_ = false;
+    num_spooled_.fetch_add(num_samples, std::memory_order_relaxed);
+    updateSpoolStats();
+    return true;
+}
+
+int RiverWriterQueue::replaySpool(bool force, std::chrono::steady_clock::time_point replay_deadline) {
+    if (!spool_ || spool_->empty()) {
+        return -1;
+    }
+    if (!sinkReady(force)) {
+        return force ? -1 : msUntilReconnect();
+    }
+
+    // Newly published slabs get the next look; they'll be spooled behind these anyway.
+    while (!spool_->empty() && (force || filled_slabs_.size() == 0)
+           && std::chrono::steady_clock::now() < replay_deadline) {
+        const char *data;
+        size_t num_bytes;
+        int64_t num_samples;
+        spool_->peek(&data, &num_bytes, &num_samples);
+        if (!tryWriteToSink(data, num_bytes, num_samples)) {
+            updateSpoolStats();
+            return force ? -1 : msUntilReconnect();
+        }
+        spool_->pop();
+        num_replayed_.fetch_add(num_samples, std::memory_order_relaxed);
+        updateSpoolStats();
+    }
+    return spool_->empty() ? -1 : 0;
+}
+
+void RiverWriterQueue::log(const std::string &message) const {
+    if (options_.log) {
+        options_.log(message);
+    }
+}
+
+void RiverWriterQueue::updateSpoolStats() {
+    spool_pending_samples_.store(spool_->pendingSamples(), std::memory_order_relaxed);
+    spool_pending_bytes_.store((int64_t) spool_->pendingBytes(), std::memory_order_relaxed);
+}
+
+bool RiverWriterQueue::hasRoomFor(size_t num_bytes) {
+    if (queuedBytes() + num_bytes > capacity_bytes_) {
+        return false;
+    }
+    if (current_slab_) {
+        return true;
+    }
+    current_slab_ = startSlab(num_bytes);
+    if (!current_slab_) {
+        return false;
+    }
+    current_slab_->first_sample_time = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool RiverWriterQueue::makeRoomFor(size_t num_bytes, int64_t num_samples) {
+    if (hasRoomFor(num_bytes)) {
+        return true;
+    }
+    if (num_bytes > capacity_bytes_) {
+        // Would never fit, however much is dropped or however long this waits.
+        num_dropped_newest_.fetch_add(num_samples, std::memory_order_relaxed);
+        return false;
+    }
+
+    switch (options_.overflow_policy) {
+        case OverflowPolicy::DROP_OLDEST: {
+            // The current slab is the newest; it has to be published to be dropped, or written.
+            publish();
+            PayloadSlab *slab;
+            while (filled_slabs_.tryStealOldest(slab)) {
+                num_dropped_oldest_.fetch_add(slab->num_samples, std::memory_order_relaxed);
+                bytes_in_.fetch_sub((int64_t) slab->num_bytes, std::memory_order_relaxed);
+                release(slab);
+                if (hasRoomFor(num_bytes)) {
+                    return true;
+                }
+            }
+            // Nothing waiting that's older; the writer is holding the rest.
+            break;
+        }
+        case OverflowPolicy::BLOCK: {
+            RIVER_TRACE_SCOPE("RiverWriterQueue::waitForFreeSlab");
+            publish();
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options_.block_timeout_ms);
+            while (true) {
+                if (hasRoomFor(num_bytes)) {
+                    return true;
+                }
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - std::chrono::steady_clock::now());
+                if (remaining.count() <= 0) {
+                    num_dropped_timed_out_.fetch_add(num_samples, std::memory_order_relaxed);
+                    return false;
+                }
+                slab_freed_.wait((int) remaining.count());
+            }
+        }
+        case OverflowPolicy::DROP_NEWEST:
+            break;
+    }
+
+    num_dropped_newest_.fetch_add(num_samples, std::memory_order_relaxed);
+    return false;
+}
+
+PayloadSlab *RiverWriterQueue::startSlab(size_t num_bytes) {
+    collectReleasedSlabs();
+    if (spare_slabs_.empty()) {
+        return nullptr;
+    }
+
+    uint64_t start = arena_head_;
+    size_t offset = (size_t) (start % arena_size_);
+    if (offset + num_bytes > arena_size_) {
+        // Skip the rest of the arena; it's returned along with this slab.
+        start += arena_size_ - offset;
+        offset = 0;
+    }
+    size_t free_bytes = arena_size_ - (size_t) (start - arena_tail_);
+    if (start - arena_tail_ > arena_size_ || free_bytes < num_bytes) {
+        return nullptr;
+    }
+
+    PayloadSlab *slab = spare_slabs_.back();
+    spare_slabs_.pop_back();
+    slab->data = arena_.get() + offset;
+    slab->capacity = std::min({std::max(slab_capacity_, num_bytes), free_bytes, arena_size_ - offset});
+    slab->num_bytes = 0;
+    slab->num_samples = 0;
+    slab->released = false;
+    arena_head_ = start + slab->capacity;
+    slab->arena_end = arena_head_;
+    slabs_in_use_[(oldest_in_use_ + num_in_use_) % max_batches_] = slab;
+    num_in_use_++;
+    return slab;
+}
+
+void RiverWriterQueue::collectReleasedSlabs() {
+    PayloadSlab *slab;
+    while (free_slabs_.tryPop(slab)) {
+        release(slab);
+    }
+
+    // A slab's memory can only be handed out again once every slab before it in the arena is released too.
+    while (num_in_use_ > 0 && slabs_in_use_[oldest_in_use_]->released) {
+        slab = slabs_in_use_[oldest_in_use_];
+        arena_tail_ = slab->arena_end;
+        spare_slabs_.push_back(slab);
+        oldest_in_use_ = (oldest_in_use_ + 1) % max_batches_;
+        num_in_use_--;
+    }
+}
+
+void RiverWriterQueue::release(PayloadSlab *slab) {
+    slab->released = true;
+}
+
+size_t RiverWriterQueue::queuedBytes() const {
+    // Recycled bytes were all committed first, so this can only be stale in the direction of more queued.
+    int64_t recycled = bytes_recycled_.load(std::memory_order_relaxed);
+    return (size_t) std::max((int64_t) 0, bytes_in_.load(std::memory_order_relaxed) - recycled);
+}
+
+char *RiverWriterQueue::reserve(size_t num_bytes, int64_t num_samples) {
+    if (current_slab_ && current_slab_->num_bytes + num_bytes > current_slab_->capacity) {
+        publish();
+    }
+    if (!makeRoomFor(num_bytes, num_samples)) {
+        return nullptr;
+    }
+
+    reserved_bytes_ = num_bytes;
+    reserved_samples_ = num_samples;
+    return current_slab_->data + current_slab_->num_bytes;
+}
+
+void RiverWriterQueue::commit() {
+    commit(reserved_bytes_, reserved_samples_);
+}
+
+void RiverWriterQueue::commit(size_t num_bytes, int64_t num_samples) {
+    current_slab_->num_bytes += num_bytes;
+    current_slab_->num_samples += num_samples;
+    bytes_in_.fetch_add((int64_t) num_bytes, std::memory_order_relaxed);
+    auto queued_bytes = (int64_t) queuedBytes();
+    if (queued_bytes > queue_depth_high_water_.load(std::memory_order_relaxed)) {
+        queue_depth_high_water_.store(queued_bytes, std::memory_order_relaxed);
+    }
+    reserved_bytes_ = 0;
+    reserved_samples_ = 0;
+
+    if (current_slab_->num_bytes >= current_slab_->capacity) {
+        publish();
+    }
+}
+
+bool RiverWriterQueue::enqueue(const char *data, size_t num_bytes, int64_t num_samples) {
+    if (num_samples == 0) {
+        return true;
+    }
+
+    char *dst = reserve(num_bytes, num_samples);
+    if (!dst) {
+        return false;
+    }
+    memcpy(dst, data, num_bytes);
+    commit();
+    return true;
+}
+
+void RiverWriterQueue::publish() {
+    if (!current_slab_ || current_slab_->num_samples == 0) {
+        return;
+    }
+
+    // Give back the part of the arena it didn't use; it's the newest slab, so that's the end of what's handed out.
+    arena_head_ -= current_slab_->capacity - current_slab_->num_bytes;
+    current_slab_->capacity = current_slab_->num_bytes;
+    current_slab_->arena_end = arena_head_;
+
+    // Can't fail: the ring has room for every slab.
+    filled_slabs_.tryPush(current_slab_);
+    current_slab_ = nullptr;
+    if (consumer_) {
+        consumer_->signal();
+    }
+}
+
+void RiverWriterQueue::publishIfDue() {
+    if (!current_slab_ || current_slab_->num_samples == 0) {
+        return;
+    }
+    if (std::chrono::steady_clock::now() - current_slab_->first_sample_time >= max_latency_) {
+        publish();
+    }
+}
+
+DropCounts RiverWriterQueue::dropCounts() const {
+    DropCounts counts;
+    counts.newest = num_dropped_newest_.load(std::memory_order_relaxed);
+    counts.oldest = num_dropped_oldest_.load(std::memory_order_relaxed);
+    counts.timed_out = num_dropped_timed_out_.load(std::memory_order_relaxed);
+    counts.failed = num_dropped_failed_.load(std::memory_order_relaxed);
+    return counts;
+}
+
+SpoolStats RiverWriterQueue::spoolStats() const {
+    SpoolStats stats;
+    stats.pending_samples = spool_pending_samples_.load(std::memory_order_relaxed);
+    stats.pending_bytes = spool_pending_bytes_.load(std::memory_order_relaxed);
+    stats.spooled_samples = num_spooled_.load(std::memory_order_relaxed);
+    stats.replayed_samples = num_replayed_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+WriterMetrics RiverWriterQueue::metrics() const {
+    WriterMetrics metrics;
+    metrics.taken_at = std::chrono::steady_clock::now();
+    metrics.queue_depth = (int64_t) queuedBytes();
+    metrics.queue_depth_high_water = queue_depth_high_water_.load(std::memory_order_relaxed);
+    metrics.queue_capacity = (int64_t) capacity_bytes_;
+    metrics.bytes_written = bytes_written_.load(std::memory_order_relaxed);
+    metrics.samples_written = samples_written_.load(std::memory_order_relaxed);
+    metrics.batches_written = batches_written_.load(std::memory_order_relaxed);
+    metrics.flush_latency_us = flush_latency_us_.snapshot();
+    metrics.batch_size = batch_size_.snapshot();
+    metrics.write_duration_us = write_duration_us_.snapshot();
+    return metrics;
+}
+
+ConnectionStats RiverWriterQueue::connectionStats() const {
+    ConnectionStats stats;
+    stats.connected = !sink_disconnected_.load(std::memory_order_relaxed);
+    stats.reconnect_attempts = num_reconnect_attempts_.load(std::memory_order_relaxed);
+    stats.reconnects = num_reconnects_.load(std::memory_order_relaxed);
+
+    int64_t total_ns = total_outage_ns_.load(std::memory_order_relaxed);
+    int64_t longest_ns = longest_outage_ns_.load(std::memory_order_relaxed);
+    int64_t outage_start_ns = outage_start_ns_.load(std::memory_order_relaxed);
+    if (outage_start_ns != 0) {
+        int64_t current_ns = steadyNowNs() - outage_start_ns;
+        stats.current_outage_s = current_ns / 1e9;
+        total_ns += current_ns;
+        longest_ns = std::max(longest_ns, current_ns);
+    }
+    stats.total_outage_s = total_ns / 1e9;
+    stats.longest_outage_s = longest_ns / 1e9;
+    return stats;
+}
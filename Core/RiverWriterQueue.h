@@ -0,0 +1,457 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __RIVERWRITERQUEUE_H_5E2B9F14__
+#define __RIVERWRITERQUEUE_H_5E2B9F14__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BatchSink.h"
+#include "CoreLog.h"
+#include "SpoolFile.h"
+#include "SpscRingBuffer.h"
+#include "WriterMetrics.h"
+
+/**
+
+    Wakes up one waiting thread. Like juce::WaitableEvent, a signal() that
+    arrives while nobody is waiting isn't lost: the next wait() returns
+    straight away.
+
+*/
+class WakeSignal
+{
+public:
+    WakeSignal() : signalled_(false) {}
+
+    void signal();
+
+    /** Waits for signal(), up to timeout_ms (forever if negative). Returns false on timeout. */
+    bool wait(int timeout_ms);
+
+private:
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool signalled_;
+};
+
+/**
+
+    A preallocated chunk of memory that the processing thread writes samples
+    into in place. Each slab is handed over as one batch and recycled once
+    it has been written.
+
+*/
+struct PayloadSlab {
+    /** A slab whose memory is owned by someone else, e.g. RiverWriterQueue's arena */
+    PayloadSlab() = default;
+
+    /** A slab that owns capacity bytes */
+    explicit PayloadSlab(size_t capacity)
+            : storage(new char[capacity]), data(storage.get()), capacity(capacity) {}
+
+    std::unique_ptr<char[]> storage;
+    char* data = nullptr;
+    size_t capacity = 0;
+    size_t num_bytes = 0;
+    int64_t num_samples = 0;
+
+    // When the oldest sample in this slab was reserved; the slab must be written by this + max latency.
+    std::chrono::steady_clock::time_point first_sample_time;
+
+    // RiverWriterQueue's bookkeeping: where the slab's memory ends in the arena (counting every byte ever handed
+    // out, so it only grows), and whether the writer is done with it.
+    uint64_t arena_end = 0;
+    bool released = false;
+};
+
+/** What RiverWriterQueue does with new samples once its queue is at capacity */
+enum class OverflowPolicy {
+    DROP_NEWEST = 0,
+    DROP_OLDEST = 1,
+    // Wait (on the processing thread!) for the writer to free up room, then drop the newest samples on timeout.
+    BLOCK = 2,
+};
+
+/** Settings for RiverWriterQueue */
+struct RiverWriterOptions {
+    int max_latency_ms;
+    // Each batch holds up to this many samples.
+    int max_batch_size;
+    int sample_size;
+    // Max number of bytes waiting to be written, including the batch currently being filled and the one being
+    // written.
+    size_t capacity_bytes;
+    OverflowPolicy overflow_policy;
+    int block_timeout_ms;
+    // If set, batches the sink fails to write, or that arrive while the writer has fallen behind, are appended to a
+    // SpoolFile at this path instead of being lost, and replayed in order once the sink takes them again.
+    std::string spool_path;
+    // After the sink fails, wait this long before reconnecting and retrying, doubling after each failed attempt up to
+    // reconnect_max_ms.
+    int reconnect_initial_ms = 100;
+    int reconnect_max_ms = 10000;
+    // Told when the sink goes away and comes back, and when spooling fails.
+    CoreLogFunction log;
+};
+
+/** Number of samples dropped under each overflow policy, or because the sink failed */
+struct DropCounts {
+    int64_t newest = 0;
+    int64_t oldest = 0;
+    int64_t timed_out = 0;
+    // The sink was still unreachable when the writer stopped, or the spool couldn't take the batch.
+    int64_t failed = 0;
+
+    int64_t total() const {
+        return newest + oldest + timed_out + failed;
+    }
+};
+
+/** What RiverWriterQueue's spool is holding */
+struct SpoolStats {
+    // Waiting in the spool file to be replayed.
+    int64_t pending_samples = 0;
+    int64_t pending_bytes = 0;
+    // Totals since the queue was created.
+    int64_t spooled_samples = 0;
+    int64_t replayed_samples = 0;
+};
+
+/** How RiverWriterQueue's connection to its sink has held up */
+struct ConnectionStats {
+    bool connected = true;
+    // Calls to BatchSink::reconnect(), and outages that ended with a successful write.
+    int64_t reconnect_attempts = 0;
+    int64_t reconnects = 0;
+    // In seconds; total and longest include the current outage, if any.
+    double current_outage_s = 0;
+    double total_outage_s = 0;
+    double longest_outage_s = 0;
+};
+
+/**
+
+    Batches data for one River stream on the processing thread, to be
+    written to its BatchSink (normally River) by a RiverWriterPool thread.
+
+    Batches are carved out of one arena, allocated up front with room for
+    capacity_bytes plus a little slack for wrapping around, so the
+    processing thread never allocates. A batch is trimmed to what it holds
+    when it's published, so small batches (e.g. published early to keep
+    latency down) only take up the bytes they use; the overflow policy
+    applies once the bytes waiting to be written would exceed
+    capacity_bytes, or in the rare case that kMaxBatches batches are.
+
+*/
+class RiverWriterQueue
+{
+public:
+
+    /**
+     * Constructor. sink must outlive the queue. Allocates the arena (capacity_bytes, plus up to two batches of
+     * slack) up front, so throws std::bad_alloc if that much memory isn't available.
+     */
+    RiverWriterQueue(BatchSink *sink, const RiverWriterOptions& options);
+
+	/** Destructor */
+    ~RiverWriterQueue() = default;
+
+    /**
+     * Returns slab memory for num_bytes (holding num_samples samples) that the caller should write into and then
+     * commit(). If the queue is at capacity, the overflow policy decides what happens; returns nullptr (and counts
+     * the samples as dropped) if the new samples can't be queued. Only blocks under OverflowPolicy::BLOCK.
+     * Processing thread only.
+     */
+    char* reserve(size_t num_bytes, int64_t num_samples);
+
+    /** Marks the memory handed out by the last reserve() as ready to write. Processing thread only. */
+    void commit();
+
+    /**
+     * Like commit(), but only the first num_bytes of the reserved memory, holding num_samples samples, for when
+     * reserve() asked for an upper bound (e.g. before encoding). Processing thread only.
+     */
+    void commit(size_t num_bytes, int64_t num_samples);
+
+    /** Copies bytes into the writing queue via reserve() + commit(). Processing thread only. */
+    bool enqueue(const char* data, size_t num_bytes, int64_t num_samples);
+
+    /**
+     * Hands the slab currently being filled (if any) to the writer and wakes it up. Called automatically once a
+     * slab holds max_batch_size samples. Processing thread only.
+     */
+    void publish();
+
+    /** Calls publish() if the oldest unpublished sample has waited max_latency_ms. Processing thread only. */
+    void publishIfDue();
+
+    /**
+     * Writes every published slab to the sink, one write() call per slab.
+     *
+     * If a write throws, the sink counts as disconnected: reconnect() and the retry happen after a backoff that
+     * doubles with each failed attempt. Meanwhile, without a spool, slabs stay in the queue (so it fills up and the
+     * overflow policy applies). With a spool, they're spooled instead, as they are whenever more than half of the
+     * queue is waiting; spooled batches are replayed until the spool is empty, a write fails, or new slabs are
+     * published.
+     *
+     * Returns how many ms until it should be called again even if nothing new is published (0 to call again
+     * straight away, e.g. to keep replaying), or -1 if it only needs calling after a publish(). Consumer thread only.
+     */
+    int writeFilledSlabs();
+
+    /**
+     * Writes out whatever has been published, reconnecting once more straight away if the sink is down. Spooled
+     * batches are only replayed until replay_deadline, since stopping waits for this; the rest stay in the spool
+     * file, which is left on disk, and in spoolStats(). Without a spool, anything that still can't be written is
+     * counted as failed. Consumer thread only.
+     */
+    void finish(std::chrono::steady_clock::time_point replay_deadline);
+
+    /** Number of samples dropped because the queue was at capacity, or the sink failed */
+    DropCounts dropCounts() const;
+
+    /** Safe to call from any thread */
+    SpoolStats spoolStats() const;
+
+    /** Safe to call from any thread */
+    ConnectionStats connectionStats() const;
+
+    /** Safe to call from any thread */
+    WriterMetrics metrics() const;
+
+
+    // Most batches that can be waiting at once, however few bytes they hold.
+    static constexpr size_t kMaxBatches = 1 << 14;
+
+private:
+    /**
+     * Whether num_bytes more can be reserved: they fit in the byte budget and, without a current slab, a new one
+     * can be started (which it does).
+     */
+    bool hasRoomFor(size_t num_bytes);
+
+    /** Applies the overflow policy until hasRoomFor(num_bytes). Returns false if the new samples are dropped. */
+    bool makeRoomFor(size_t num_bytes, int64_t num_samples);
+
+    /** Starts a batch at the arena's head with room for at least num_bytes, or returns nullptr if it won't fit */
+    PayloadSlab* startSlab(size_t num_bytes);
+
+    /** Returns the arena memory of released slabs, oldest first, along with their batches */
+    void collectReleasedSlabs();
+
+    /** Marks slab as unused; its memory is reused once every older slab is released too */
+    void release(PayloadSlab* slab);
+
+    /** Bytes waiting to be written; at most a little stale. Safe to call from any thread. */
+    size_t queuedBytes() const;
+
+    /** writeFilledSlabs(), where force reconnects straight away instead of waiting for the backoff */
+    int writeSlabs(bool force, std::chrono::steady_clock::time_point replay_deadline);
+
+    /** Hands a written slab back to the processing thread, which releases it */
+    void recycle(PayloadSlab* slab);
+
+    /** Writes a slab to the sink, falling back to the spool when that fails or it shouldn't be tried */
+    void writeOrSpool(PayloadSlab* slab);
+
+    /** tryWriteToSink(), also recording the slab's flush latency and size */
+    bool tryWriteSlab(PayloadSlab* slab);
+
+    /** Returns false, and schedules a reconnect, if the sink throws */
+    bool tryWriteToSink(const char* data, size_t num_bytes, int64_t num_samples);
+
+    /**
+     * Whether the sink should be written to: true unless it's disconnected and either the backoff hasn't elapsed
+     * (and force isn't set) or reconnect() throws.
+     */
+    bool sinkReady(bool force);
+
+    /** Marks the sink as disconnected, and backs off further */
+    void scheduleReconnect();
+
+    /** As writeFilledSlabs() returns, while waiting to reconnect */
+    int msUntilReconnect() const;
+
+    /** Returns false (counting the samples as failed) if the spool can't be created or grown */
+    bool spool(const char* data, size_t num_bytes, int64_t num_samples);
+
+    /** Passes message to options_.log, if set */
+    void log(const std::string& message) const;
+
+    /**
+     * Replays spooled batches, stopping at replay_deadline; returns as writeFilledSlabs() does. force ignores the
+     * retry delay.
+     */
+    int replaySpool(bool force, std::chrono::steady_clock::time_point replay_deadline);
+
+    void updateSpoolStats();
+
+    friend class RiverWriterPool;
+
+    // Woken by publish(); set by RiverWriterPool before the queue is used.
+    WakeSignal* consumer_;
+
+    const RiverWriterOptions options_;
+    const size_t capacity_bytes_;
+    const size_t slab_capacity_;
+    const size_t max_batches_;
+    const std::chrono::milliseconds max_latency_;
+
+    // Slabs ready to be written (processing thread -> writer) and slabs the writer is done with (writer ->
+    // processing thread). Each ring has exactly one producer and one consumer, so no lock is needed.
+    SpscRingBuffer<PayloadSlab*> filled_slabs_;
+    SpscRingBuffer<PayloadSlab*> free_slabs_;
+
+    // Every batch, and the memory they point into. Allocated in the constructor.
+    std::vector<PayloadSlab> slabs_;
+    const size_t arena_size_;
+    const std::unique_ptr<char[]> arena_;
+
+    // Signalled by the writer when it recycles a slab, for OverflowPolicy::BLOCK.
+    WakeSignal slab_freed_;
+
+    // Processing thread only. Slabs in the order their memory was handed out, from the oldest one still in use,
+    // and the ones not in use. arena_head_ and arena_tail_ count bytes ever handed out and returned.
+    std::vector<PayloadSlab*> slabs_in_use_;
+    size_t oldest_in_use_;
+    size_t num_in_use_;
+    std::vector<PayloadSlab*> spare_slabs_;
+    uint64_t arena_head_;
+    uint64_t arena_tail_;
+
+    // Processing thread only.
+    PayloadSlab* current_slab_;
+    size_t reserved_bytes_;
+    int64_t reserved_samples_;
+
+    // Bytes ever committed, less those stolen to drop them (processing thread), and bytes ever recycled (consumer
+    // thread). The difference is what's queued, including the current slab.
+    std::atomic<int64_t> bytes_in_;
+    std::atomic<int64_t> bytes_recycled_;
+
+    std::atomic<int64_t> num_dropped_newest_;
+    std::atomic<int64_t> num_dropped_oldest_;
+    std::atomic<int64_t> num_dropped_timed_out_;
+    std::atomic<int64_t> num_dropped_failed_;
+
+    // Consumer thread only. The spool is created the first time something is spooled; retry_slab_ is the slab
+    // whose write failed, when there's no spool.
+    std::unique_ptr<SpoolFile> spool_;
+    // Whether the last append to the spool failed, so a full disk is only logged once.
+    bool spool_failing_;
+    PayloadSlab* retry_slab_;
+    std::chrono::steady_clock::time_point next_reconnect_;
+    int reconnect_delay_ms_;
+
+    // Written by the consumer thread, for spoolStats().
+    std::atomic<int64_t> spool_pending_samples_;
+    std::atomic<int64_t> spool_pending_bytes_;
+    std::atomic<int64_t> num_spooled_;
+    std::atomic<int64_t> num_replayed_;
+
+    // Written by the consumer thread, for connectionStats(). An outage starts with a failed write and ends with a
+    // successful one; the sink is disconnected from then until a reconnect() succeeds.
+    std::atomic<bool> sink_disconnected_;
+    // steady_clock time since epoch; 0 when there's no outage.
+    std::atomic<int64_t> outage_start_ns_;
+    std::atomic<int64_t> total_outage_ns_;
+    std::atomic<int64_t> longest_outage_ns_;
+    std::atomic<int64_t> num_reconnect_attempts_;
+    std::atomic<int64_t> num_reconnects_;
+
+    // For metrics(). The high-water mark (of queuedBytes()) is written by the processing thread, the rest by the
+    // consumer thread.
+    std::atomic<int64_t> queue_depth_high_water_;
+    std::atomic<int64_t> bytes_written_;
+    std::atomic<int64_t> samples_written_;
+    std::atomic<int64_t> batches_written_;
+    Log2Histogram flush_latency_us_;
+    Log2Histogram batch_size_;
+    Log2Histogram write_duration_us_;
+
+    BatchSink* sink_;
+};
+
+/**
+
+    A small set of threads that write RiverWriterQueues to River.
+
+    Each queue is assigned to exactly one thread (round-robin), so every
+    queue keeps a single consumer; a thread sleeps until one of its queues
+    publishes a batch.
+
+*/
+class RiverWriterPool
+{
+public:
+
+    /** Constructor. Uses at most one thread per queue. */
+    RiverWriterPool(const std::vector<RiverWriterQueue*>& queues, int num_threads);
+
+    /** Destructor. Stops the threads if they're still running. */
+    ~RiverWriterPool();
+
+    void start();
+
+    /**
+     * Writes out whatever has been published so far and joins every thread. Each thread replays its queues' spools
+     * for at most kStopReplayMs; whatever's left stays in the spool files.
+     */
+    void stop();
+
+    int numThreads() const;
+
+    /** One thread per queue, up to the number of cores */
+    static int defaultNumThreads(int num_queues);
+
+    static constexpr int kStopReplayMs = 250;
+
+private:
+    class Worker
+    {
+    public:
+        explicit Worker(int index);
+
+        /** Sleeps until one of its queues publishes a batch or the thread is asked to stop. */
+        void run();
+
+        const int index;
+        std::vector<RiverWriterQueue*> queues;
+        WakeSignal wake;
+        std::atomic<bool> should_exit;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+};
+
+#endif  // __RIVERWRITERQUEUE_H_5E2B9F14__
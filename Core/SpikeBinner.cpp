@@ -0,0 +1,101 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SpikeBinner.h"
+
+#include <algorithm>
+
+namespace {
+
+/** Rounds towards negative infinity, so that bins stay aligned for negative sample numbers too */
+int64_t floorDiv(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+}  // namespace
+
+SpikeBinner::SpikeBinner(int num_channels, int num_units, int64_t bin_samples)
+        : num_channels_(num_channels),
+          num_units_(num_units),
+          bin_samples_(bin_samples),
+          started_(false),
+          first_bin_(0),
+          head_(0),
+          num_open_(0),
+          empty_((size_t) num_channels * num_units, 0),
+          num_late_(0),
+          num_dropped_(0),
+          num_allocations_(0) {
+}
+
+void SpikeBinner::start(int64_t sample_number) {
+    if (!started_) {
+        started_ = true;
+        first_bin_ = floorDiv(sample_number, bin_samples_);
+    }
+}
+
+bool SpikeBinner::add(int channel, int unit, int64_t sample_number) {
+    if (channel < 0 || channel >= num_channels_ || unit < 0 || unit >= num_units_) {
+        num_dropped_++;
+        return false;
+    }
+    start(sample_number);
+
+    int64_t bin = floorDiv(sample_number, bin_samples_);
+    if (bin < first_bin_) {
+        bin = first_bin_;
+        num_late_++;
+    }
+    const int64_t index = bin - first_bin_;
+    if (index >= kMaxOpenBins) {
+        num_dropped_++;
+        return false;
+    }
+    while ((int64_t) num_open_ <= index) {
+        if (num_open_ == open_.size()) {
+            // Full, so unroll it with head_ first before adding a bin on the end.
+            std::rotate(open_.begin(), open_.begin() + (std::ptrdiff_t) head_, open_.end());
+            head_ = 0;
+            const size_t capacity = open_.capacity();
+            open_.push_back(empty_);
+            // The new bin's counts, and maybe the ring itself.
+            num_allocations_.fetch_add((empty_.empty() ? 0 : 1) + (open_.capacity() != capacity ? 1 : 0),
+                                       std::memory_order_relaxed);
+        }
+        num_open_++;
+    }
+
+    uint16_t &count = open_[(head_ + (size_t) index) % open_.size()][(size_t) channel * num_units_ + unit];
+    if (count < UINT16_MAX) {
+        count++;
+    }
+    return true;
+}
+
+void SpikeBinner::recycleFirst() {
+    std::fill(open_[head_].begin(), open_[head_].end(), 0);
+    head_ = (head_ + 1) % open_.size();
+    num_open_--;
+}
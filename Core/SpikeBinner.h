@@ -0,0 +1,150 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SPIKEBINNER_H_9B4E2C71__
+#define __SPIKEBINNER_H_9B4E2C71__
+
+#include <cstddef>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/**
+
+    Counts spikes per (channel, unit) in fixed-width bins aligned to sample
+    numbers: bin k covers sample numbers [k * bin_samples, (k + 1) *
+    bin_samples). Each bin's counts are a flat array indexed by
+    channel * num_units + unit, saturating at 65535.
+
+    Several bins can be open at once, since a block of samples can span
+    many bins and spikes can arrive a little after the fact. Bins are
+    emitted in order, empty ones included, once the caller knows no more
+    spikes will land in them. Spikes that arrive for a bin that has already
+    been emitted count towards the oldest open bin instead, and as late.
+
+    Only allocates while more bins are open at once than ever before.
+
+*/
+class SpikeBinner
+{
+public:
+    // Spikes more than this many bins past the oldest open bin are dropped, rather than allocating without bound
+    // for a bogus sample number.
+    static constexpr int64_t kMaxOpenBins = 4096;
+
+    /** bin_samples must be positive */
+    SpikeBinner(int num_channels, int num_units, int64_t bin_samples);
+
+    /** Starts binning at the bin holding sample_number, if nothing has been counted or emitted yet */
+    void start(int64_t sample_number);
+
+    /**
+     * Counts a spike. Returns false (and counts it as dropped) if the channel or unit is out of range, or it's too
+     * far ahead of the oldest open bin.
+     */
+    bool add(int channel, int unit, int64_t sample_number);
+
+    /**
+     * Emits, oldest first, every bin that ends at or before end_sample_number, by calling
+     * emit(bin_start_sample_number, counts) with countsPerBin() counts. Returns the number of bins emitted.
+     */
+    template<typename Emit>
+    int64_t emitBinsEndingBy(int64_t end_sample_number, Emit &&emit) {
+        if (!started_) {
+            return 0;
+        }
+        int64_t num_emitted = 0;
+        while ((first_bin_ + 1) * bin_samples_ <= end_sample_number) {
+            emitFirst(emit);
+            num_emitted++;
+        }
+        return num_emitted;
+    }
+
+    /** Emits every open bin, e.g. when acquisition stops; the last one may not have run its full width */
+    template<typename Emit>
+    int64_t emitAll(Emit &&emit) {
+        int64_t num_emitted = 0;
+        while (num_open_ > 0) {
+            emitFirst(emit);
+            num_emitted++;
+        }
+        return num_emitted;
+    }
+
+    int countsPerBin() const {
+        return num_channels_ * num_units_;
+    }
+
+    int64_t binSamples() const {
+        return bin_samples_;
+    }
+
+    /** Spikes counted towards a later bin than their own, since theirs had already been emitted */
+    int64_t numLate() const {
+        return num_late_;
+    }
+
+    /** Spikes not counted at all; see add() */
+    int64_t numDropped() const {
+        return num_dropped_;
+    }
+
+    /** Heap allocations made by add() to open more bins at once than ever before. Safe to call from any thread. */
+    int64_t numAllocations() const {
+        return num_allocations_.load(std::memory_order_relaxed);
+    }
+
+private:
+    template<typename Emit>
+    void emitFirst(Emit &emit) {
+        if (num_open_ == 0) {
+            emit(first_bin_ * bin_samples_, (const uint16_t *) empty_.data());
+        } else {
+            emit(first_bin_ * bin_samples_, (const uint16_t *) open_[head_].data());
+            recycleFirst();
+        }
+        first_bin_++;
+    }
+
+    void recycleFirst();
+
+    const int num_channels_;
+    const int num_units_;
+    const int64_t bin_samples_;
+
+    bool started_;
+    // Bin index of the oldest open bin, or of the next bin to emit if nothing is open.
+    int64_t first_bin_;
+    // A ring of counts, num_open_ of them open starting at head_; the rest are zeroed, ready for later bins.
+    std::vector<std::vector<uint16_t>> open_;
+    size_t head_;
+    size_t num_open_;
+    const std::vector<uint16_t> empty_;
+
+    int64_t num_late_;
+    int64_t num_dropped_;
+    std::atomic<int64_t> num_allocations_;
+};
+
+#endif  // __SPIKEBINNER_H_9B4E2C71__
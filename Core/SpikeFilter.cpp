@@ -0,0 +1,128 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SpikeFilter.h"
+
+#include <cctype>
+#include <cstdlib>
+
+namespace {
+
+/** Parses "a,b-c,..." into bits, all of them below N. An empty (or blank) spec sets *all instead. */
+template<size_t N>
+bool parseList(const std::string &spec, std::bitset<N> *bits, bool *all) {
+    std::bitset<N> parsed;
+    bool any = false;
+    const char *p = spec.c_str();
+    while (true) {
+        while (isspace((unsigned char) *p)) {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        if (!isdigit((unsigned char) *p)) {
+            return false;
+        }
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        p = end;
+        while (isspace((unsigned char) *p)) {
+            p++;
+        }
+        if (*p == '-') {
+            p++;
+            while (isspace((unsigned char) *p)) {
+                p++;
+            }
+            if (!isdigit((unsigned char) *p)) {
+                return false;
+            }
+            last = strtol(p, &end, 10);
+            p = end;
+            while (isspace((unsigned char) *p)) {
+                p++;
+            }
+        }
+        if (first > last || last >= (long) N) {
+            return false;
+        }
+        for (long i = first; i <= last; i++) {
+            parsed.set((size_t) i);
+        }
+        any = true;
+        if (*p == ',') {
+            p++;
+        } else if (*p != '\0') {
+            return false;
+        }
+    }
+    *bits = parsed;
+    *all = !any;
+    return true;
+}
+
+template<size_t N>
+std::string formatList(const std::bitset<N> &bits, bool all) {
+    std::string out;
+    if (all) {
+        return out;
+    }
+    for (size_t i = 0; i < N; i++) {
+        if (!bits[i]) {
+            continue;
+        }
+        size_t last = i;
+        while (last + 1 < N && bits[last + 1]) {
+            last++;
+        }
+        if (!out.empty()) {
+            out.append(1, ',');
+        }
+        out.append(std::to_string(i));
+        if (last > i) {
+            out.append(1, '-').append(std::to_string(last));
+        }
+        i = last;
+    }
+    return out;
+}
+
+}  // namespace
+
+bool SpikeFilter::setChannels(const std::string &spec) {
+    return parseList(spec, &channels_, &all_channels_);
+}
+
+bool SpikeFilter::setUnits(const std::string &spec) {
+    return parseList(spec, &units_, &all_units_);
+}
+
+std::string SpikeFilter::channels() const {
+    return formatList(channels_, all_channels_);
+}
+
+std::string SpikeFilter::units() const {
+    return formatList(units_, all_units_);
+}
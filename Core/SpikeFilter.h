@@ -0,0 +1,90 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SPIKEFILTER_H_6E1D3B90__
+#define __SPIKEFILTER_H_6E1D3B90__
+
+#include <bitset>
+#include <cstdint>
+#include <string>
+
+/**
+
+    Decides which spikes are published, by spike channel index and sorted
+    unit ID, before anything is reserved in the writer queue. Checking a
+    spike is two bitset lookups.
+
+    Channels and units are given as comma-separated indices and inclusive
+    ranges, e.g. "0-31,40,48-63". An empty list lets everything through.
+    Unit 0 is unsorted (noise); dropping unsorted spikes takes precedence
+    over the unit list.
+
+*/
+class SpikeFilter
+{
+public:
+    // Channel indices and unit IDs at or above these can't be listed, so are dropped once a list is set.
+    static constexpr int kMaxChannels = 4096;
+    static constexpr int kMaxUnits = 65536;
+
+    /** Whether a spike on this channel, with this sorted ID, should be published */
+    bool accepts(int channel_index, int sorted_id) const {
+        if (sorted_id == 0 && drop_unsorted_) {
+            return false;
+        }
+        if (!all_channels_ && (channel_index < 0 || channel_index >= kMaxChannels || !channels_[channel_index])) {
+            return false;
+        }
+        return all_units_ || (sorted_id >= 0 && sorted_id < kMaxUnits && units_[sorted_id]);
+    }
+
+    /** True if every spike is accepted */
+    bool acceptsAll() const {
+        return all_channels_ && all_units_ && !drop_unsorted_;
+    }
+
+    /** Returns false (and leaves the filter unchanged) if spec isn't a valid list */
+    bool setChannels(const std::string& spec);
+    bool setUnits(const std::string& spec);
+
+    void setDropUnsorted(bool drop_unsorted) {
+        drop_unsorted_ = drop_unsorted;
+    }
+
+    /** Normalized lists, e.g. "0-3,8"; empty if everything passes */
+    std::string channels() const;
+    std::string units() const;
+
+    bool dropUnsorted() const {
+        return drop_unsorted_;
+    }
+
+private:
+    std::bitset<kMaxChannels> channels_;
+    std::bitset<kMaxUnits> units_;
+    bool all_channels_ = true;
+    bool all_units_ = true;
+    bool drop_unsorted_ = false;
+};
+
+#endif  // __SPIKEFILTER_H_6E1D3B90__
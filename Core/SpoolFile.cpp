@@ -0,0 +1,237 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SpoolFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_WIN32)
+// Otherwise windows.h defines min and max macros, which break std::min and std::max.
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char kMagic[8] = {'R', 'I', 'V', 'S', 'P', 'L', '1', '\0'};
+constexpr size_t kFileHeaderSize = 16;
+constexpr size_t kReadOffsetPosition = 8;
+
+struct RecordHeader {
+    uint64_t num_bytes;
+    int64_t num_samples;
+};
+
+size_t paddedSize(size_t num_bytes) {
+    return (num_bytes + 7) & ~(size_t) 7;
+}
+
+}  // namespace
+
+SpoolFile::SpoolFile(const std::string &path, size_t initial_capacity)
+        : path_(path),
+#if defined(_WIN32)
+          file_(INVALID_HANDLE_VALUE),
+          mapping_(nullptr),
+#else
+          fd_(-1),
+#endif
+          data_(nullptr),
+          capacity_(0),
+          read_offset_(kFileHeaderSize),
+          write_offset_(kFileHeaderSize),
+          pending_samples_(0) {
+#if defined(_WIN32)
+    file_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Couldn't create spool file " + path);
+    }
+#else
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Couldn't create spool file " + path);
+    }
+#endif
+
+    try {
+        resize(std::max(initial_capacity, kFileHeaderSize + sizeof(RecordHeader)));
+    } catch (...) {
+#if defined(_WIN32)
+        CloseHandle(file_);
+        DeleteFileA(path.c_str());
+#else
+        close(fd_);
+        remove(path.c_str());
+#endif
+        throw;
+    }
+
+    memcpy(data_, kMagic, sizeof(kMagic));
+    storeReadOffset();
+    memset(data_ + write_offset_, 0, sizeof(RecordHeader));
+}
+
+SpoolFile::~SpoolFile() {
+    const bool drained = empty();
+    // Keep the end-of-spool marker.
+    const size_t used = write_offset_ + sizeof(RecordHeader);
+    unmap();
+
+#if defined(_WIN32)
+    LARGE_INTEGER size;
+    size.QuadPart = (LONGLONG) used;
+    SetFilePointerEx(file_, size, nullptr, FILE_BEGIN);
+    SetEndOfFile(file_);
+    CloseHandle(file_);
+    if (drained) {
+        DeleteFileA(path_.c_str());
+    }
+#else
+    if (ftruncate(fd_, (off_t) used) != 0) {
+        // Only costs disk space.
+    }
+    close(fd_);
+    if (drained) {
+        remove(path_.c_str());
+    }
+#endif
+}
+
+void SpoolFile::append(const char *data, size_t num_bytes, int64_t num_samples) {
+    if (num_bytes == 0) {
+        return;
+    }
+
+    const size_t record_size = sizeof(RecordHeader) + paddedSize(num_bytes);
+    // Always leave room for the end-of-spool marker after the record.
+    const size_t needed = write_offset_ + record_size + sizeof(RecordHeader);
+    if (needed > capacity_) {
+        resize(std::max(capacity_ * 2, needed));
+    }
+
+    // Write the terminator first so the record only becomes readable once it's complete.
+    memset(data_ + write_offset_ + record_size, 0, sizeof(RecordHeader));
+    memcpy(data_ + write_offset_ + sizeof(RecordHeader), data, num_bytes);
+    RecordHeader header{(uint64_t) num_bytes, num_samples};
+    memcpy(data_ + write_offset_, &header, sizeof(header));
+
+    write_offset_ += record_size;
+    pending_samples_ += num_samples;
+}
+
+bool SpoolFile::peek(const char **data, size_t *num_bytes, int64_t *num_samples) const {
+    if (empty()) {
+        return false;
+    }
+
+    RecordHeader header;
+    memcpy(&header, data_ + read_offset_, sizeof(header));
+    *data = data_ + read_offset_ + sizeof(RecordHeader);
+    *num_bytes = (size_t) header.num_bytes;
+    *num_samples = header.num_samples;
+    return true;
+}
+
+void SpoolFile::pop() {
+    if (empty()) {
+        return;
+    }
+
+    RecordHeader header;
+    memcpy(&header, data_ + read_offset_, sizeof(header));
+    read_offset_ += sizeof(RecordHeader) + paddedSize((size_t) header.num_bytes);
+    pending_samples_ -= header.num_samples;
+
+    if (empty()) {
+        // Start over from the top rather than growing forever.
+        read_offset_ = kFileHeaderSize;
+        write_offset_ = kFileHeaderSize;
+        memset(data_ + write_offset_, 0, sizeof(RecordHeader));
+    }
+    storeReadOffset();
+}
+
+void SpoolFile::storeReadOffset() {
+    uint64_t offset = read_offset_;
+    memcpy(data_ + kReadOffsetPosition, &offset, sizeof(offset));
+}
+
+void SpoolFile::resize(size_t new_capacity) {
+    // Map the bigger file before letting go of the old mapping, so a failure leaves the spool as it was.
+#if defined(_WIN32)
+    // Creating a mapping larger than the file extends the file.
+    void *mapping = CreateFileMappingA(file_, nullptr, PAGE_READWRITE, (DWORD) ((uint64_t) new_capacity >> 32),
+                                       (DWORD) (new_capacity & 0xFFFFFFFFu), nullptr);
+    if (!mapping) {
+        throw std::runtime_error("Couldn't grow spool file " + path_);
+    }
+    char *data = (char *) MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, new_capacity);
+    if (!data) {
+        CloseHandle(mapping);
+        throw std::runtime_error("Couldn't map spool file " + path_);
+    }
+    unmap();
+    mapping_ = mapping;
+#else
+#if defined(__linux__)
+    // Actually reserves the blocks, so a full disk fails here instead of with SIGBUS on a later write.
+    if (posix_fallocate(fd_, 0, (off_t) new_capacity) != 0) {
+#else
+    if (ftruncate(fd_, (off_t) new_capacity) != 0) {
+#endif
+        throw std::runtime_error("Couldn't grow spool file " + path_);
+    }
+    void *mapped = mmap(nullptr, new_capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Couldn't map spool file " + path_);
+    }
+    char *data = (char *) mapped;
+    unmap();
+#endif
+    data_ = data;
+    capacity_ = new_capacity;
+}
+
+void SpoolFile::unmap() {
+    if (!data_) {
+        return;
+    }
+#if defined(_WIN32)
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+    mapping_ = nullptr;
+#else
+    munmap(data_, capacity_);
+#endif
+    data_ = nullptr;
+}
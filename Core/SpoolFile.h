@@ -0,0 +1,120 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SPOOLFILE_H_91E4B6D3__
+#define __SPOOLFILE_H_91E4B6D3__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+
+    An append-only queue of batches in a memory-mapped local file, used by
+    RiverWriterQueue to hold on to data while River can't take it.
+
+    Appending is a memcpy into the mapping (which grows by doubling), so
+    spooling keeps up with the processing thread even when the sink can't.
+    Batches are read back in the order they were appended; once every batch
+    has been read the file is reused from the start.
+
+    File layout, so that a spool left behind (e.g. Redis never came back)
+    can be recovered: a 16-byte header of "RIVSPL1\0" followed by the
+    little-endian uint64 offset of the first batch not yet read, then one
+    record per batch: uint64 num_bytes, int64 num_samples, and the batch's
+    bytes padded to a multiple of 8. A record with num_bytes == 0 marks the
+    end.
+
+    Not thread safe; owned by the writer thread.
+
+*/
+class SpoolFile
+{
+public:
+    /** Creates (or truncates) path. Throws std::runtime_error if it can't be created or mapped. */
+    explicit SpoolFile(const std::string& path, size_t initial_capacity = kDefaultInitialCapacity);
+
+    /** Trims the file to what's been written, and deletes it if every batch has been read. */
+    ~SpoolFile();
+
+    SpoolFile(const SpoolFile&) = delete;
+    SpoolFile& operator=(const SpoolFile&) = delete;
+
+    /** Appends a batch. Throws std::runtime_error if the file can't grow, e.g. the disk is full. */
+    void append(const char* data, size_t num_bytes, int64_t num_samples);
+
+    /** Oldest batch not yet read, if any. data stays valid until the next append() or pop(). */
+    bool peek(const char** data, size_t* num_bytes, int64_t* num_samples) const;
+
+    /** Marks the batch returned by peek() as read */
+    void pop();
+
+    bool empty() const {
+        return read_offset_ == write_offset_;
+    }
+
+    /** Bytes (including record headers) and samples appended but not yet read */
+    size_t pendingBytes() const {
+        return write_offset_ - read_offset_;
+    }
+
+    int64_t pendingSamples() const {
+        return pending_samples_;
+    }
+
+    /** Size of the mapping, and of the file while it's open */
+    size_t capacity() const {
+        return capacity_;
+    }
+
+    const std::string& path() const {
+        return path_;
+    }
+
+    static constexpr size_t kDefaultInitialCapacity = 64 << 20;
+
+private:
+    /** Grows the file and the mapping to at least new_capacity bytes */
+    void resize(size_t new_capacity);
+
+    void unmap();
+
+    void storeReadOffset();
+
+    const std::string path_;
+
+#if defined(_WIN32)
+    void* file_;
+    void* mapping_;
+#else
+    int fd_;
+#endif
+    char* data_;
+    size_t capacity_;
+
+    size_t read_offset_;
+    size_t write_offset_;
+    int64_t pending_samples_;
+};
+
+#endif  // __SPOOLFILE_H_91E4B6D3__
@@ -0,0 +1,158 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SPSCRINGBUFFER_H_3A91C0D2__
+#define __SPSCRINGBUFFER_H_3A91C0D2__
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+/**
+
+    Bounded, lock-free ring buffer for exactly one producer thread and one
+    consumer thread.
+
+    The producer and consumer indices live on separate cache lines, and each
+    side keeps a private copy of the other side's index so that the shared
+    atomics are only re-read when the ring looks full (producer) or empty
+    (consumer). Neither tryPush() nor tryPop() ever blocks or allocates;
+    all slots are allocated up front in the constructor.
+
+    The producer may also evict the oldest element with tryStealOldest(),
+    e.g. to implement a drop-oldest overflow policy. To make that safe, the
+    consumer claims each element with a compare-and-swap, and the slots are
+    atomics: the consumer may read a slot that the producer is stealing and
+    refilling at the same time (the read value is then thrown away when the
+    CAS fails, and it tries again). So T must be trivially copyable, and
+    should be small enough for std::atomic<T> to be lock-free, e.g. a
+    pointer. That retry also makes the ring lock-free rather than wait-free:
+    a consumer racing a producer that keeps stealing could lose every time.
+
+*/
+template <typename T>
+class SpscRingBuffer
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SpscRingBuffer elements must be trivially copyable");
+
+public:
+
+    /** Constructor. Capacity is rounded up to the next power of two. */
+    explicit SpscRingBuffer(size_t capacity)
+            : capacity_(roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity)),
+              mask_(capacity_ - 1),
+              slots_(new std::atomic<T>[capacity_]) {
+    }
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    /** Producer only: copies value into the ring. Returns false if the ring is full. */
+    bool tryPush(const T& value) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head - cached_tail_ >= capacity_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head - cached_tail_ >= capacity_) {
+                return false;
+            }
+        }
+        // Ordered by the release store of head_ below.
+        slots_[head & mask_].store(value, std::memory_order_relaxed);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Consumer only: copies the oldest value into out. Returns false if the ring is empty. */
+    bool tryPop(T& out) {
+        size_t tail = tail_.load(std::memory_order_acquire);
+        while (true) {
+            // >= rather than ==: a steal can move tail past the cached head.
+            if (tail >= cached_head_) {
+                cached_head_ = head_.load(std::memory_order_acquire);
+                if (tail >= cached_head_) {
+                    return false;
+                }
+            }
+            // Read it first and then claim it. If the producer stole it (and maybe refilled the slot) in the
+            // meantime, the CAS fails, and reloads tail.
+            const T value = slots_[tail & mask_].load(std::memory_order_relaxed);
+            if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                out = value;
+                return true;
+            }
+        }
+    }
+
+    /** Producer only: removes the oldest value, racing safely with tryPop(). Returns false if the ring is empty. */
+    bool tryStealOldest(T& out) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        while (tail != head) {
+            const T value = slots_[tail & mask_].load(std::memory_order_relaxed);
+            if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                out = value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** Approximate number of queued elements; exact only when called from a quiescent ring. */
+    size_t size() const {
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        const size_t head = head_.load(std::memory_order_acquire);
+        return head - tail;
+    }
+
+    size_t capacity() const {
+        return capacity_;
+    }
+
+private:
+    // Fixed rather than std::hardware_destructive_interference_size, which isn't stable across compilers.
+    static constexpr size_t kCacheLineSize = 64;
+
+    static size_t roundUpToPowerOfTwo(size_t v) {
+        size_t p = 1;
+        while (p < v) {
+            p <<= 1;
+        }
+        return p;
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    const std::unique_ptr<std::atomic<T>[]> slots_;
+
+    // Written by the producer.
+    alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0;
+
+    // Written by the consumer, or by the producer when stealing.
+    alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0;
+};
+
+#endif  // __SPSCRINGBUFFER_H_3A91C0D2__
@@ -0,0 +1,142 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "BatchSink.h"
+#include "Check.h"
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+void testRiverStreamSinkKeepsItsWriter() {
+    // Like River: a second Initialize() of the same stream throws, so a reconnect must not create another writer.
+    int num_connects = 0;
+    int num_checks = 0;
+    bool reachable = false;
+    RiverStreamSink sink(
+            [&num_connects]() {
+                if (num_connects++ > 0) {
+                    throw std::runtime_error("Stream already exists");
+                }
+                return std::make_unique<river::StreamWriter>(river::RedisConnection("127.0.0.1", 6379, ""));
+            },
+            [&num_checks, &reachable](river::StreamWriter &) {
+                num_checks++;
+                if (!reachable) {
+                    throw std::runtime_error("connection refused");
+                }
+            });
+    CHECK(sink.writer() == nullptr);
+
+    sink.reconnect();
+    river::StreamWriter *writer = sink.writer();
+    CHECK(writer != nullptr);
+    CHECK(num_connects == 1);
+    CHECK(num_checks == 0);
+
+    // Redis went away after the stream was created.
+    bool threw = false;
+    try {
+        sink.reconnect();
+    } catch (const std::exception &) {
+        threw = true;
+    }
+    CHECK(threw);
+
+    reachable = true;
+    sink.reconnect();
+    CHECK(num_connects == 1);
+    CHECK(num_checks == 2);
+    CHECK(sink.writer() == writer);
+}
+
+void testPartialWriteOnlySkipsThatBatch() {
+    const char failed[] = "0123456789abcdef";
+    const char other[] = "fedcba9876543210";
+    PartialWrite partial;
+
+    // The retry, even from a different address (e.g. the spool), skips what got through.
+    partial.failed(failed, 16, 4, 3);
+    std::string copy(failed, 16);
+    CHECK(partial.take(copy.data(), 16, 4) == 3);
+    CHECK(partial.take(copy.data(), 16, 4) == 0);
+
+    // If the failed batch never comes back (its spool append failed too), the next one is written in full.
+    partial.failed(failed, 16, 4, 3);
+    CHECK(partial.take(other, 16, 4) == 0);
+    CHECK(partial.take(failed, 16, 4) == 0);
+
+    partial.failed(failed, 16, 4, 0);
+    CHECK(partial.take(failed, 16, 4) == 0);
+}
+
+}  // namespace
+
+int main() {
+    testRiverStreamSinkKeepsItsWriter();
+    testPartialWriteOnlySkipsThatBatch();
+
+    const char data[] = "0123456789abcdef";
+
+    NullSink null_sink;
+    null_sink.write(data, 16, 2);
+    null_sink.write(data, 8, 1);
+    CHECK(null_sink.numSamples() == 3);
+    CHECK(null_sink.numBytes() == 24);
+    CHECK(null_sink.numBatches() == 2);
+
+    MemorySink memory_sink;
+    memory_sink.write(data, 8, 1);
+    memory_sink.write(data + 8, 8, 1);
+    CHECK(memory_sink.numSamples() == 2);
+    CHECK(memory_sink.batches().size() == 2);
+    CHECK(memory_sink.batches()[0].written_at <= memory_sink.batches()[1].written_at);
+    CHECK(std::string(memory_sink.bytes().data(), 16) == "0123456789abcdef");
+
+    const std::string path = "BatchSinkTest.bin";
+    {
+        FileSink file_sink(path);
+        file_sink.write(data, 16, 2);
+        file_sink.write(data, 4, 1);
+    }
+    FILE *file = fopen(path.c_str(), "rb");
+    CHECK(file != nullptr);
+    std::vector<char> contents(64);
+    size_t n = fread(contents.data(), 1, contents.size(), file);
+    fclose(file);
+    remove(path.c_str());
+    CHECK(n == 20);
+    CHECK(std::string(contents.data(), 20) == "0123456789abcdef0123");
+
+    bool threw = false;
+    try {
+        FileSink bad_sink("no-such-directory/BatchSinkTest.bin");
+    } catch (const std::exception &) {
+        threw = true;
+    }
+    CHECK(threw);
+    return 0;
+}
@@ -0,0 +1,140 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Check.h"
+#include "Int16BlockCodec.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+/** data is channel-major */
+std::vector<int16_t> interleaved(const std::vector<std::vector<int16_t>> &data, int num_samples) {
+    std::vector<int16_t> frames(data.size() * num_samples);
+    for (size_t c = 0; c < data.size(); c++) {
+        for (int t = 0; t < num_samples; t++) {
+            frames[t * data.size() + c] = data[c][t];
+        }
+    }
+    return frames;
+}
+
+/** Encodes and decodes data, checking that it comes back unchanged. Returns the encoded size. */
+size_t roundTrip(const std::vector<std::vector<int16_t>> &data, int num_samples) {
+    const int num_channels = (int) data.size();
+    auto frames = interleaved(data, num_samples);
+    std::vector<char> encoded(maxEncodedInt16BlockSize(num_channels, num_samples) + 8, 0x5A);
+    size_t num_bytes = encodeInt16Block(frames.data(), num_channels, num_samples, 1234567890123, 3, encoded.data());
+    CHECK(num_bytes <= maxEncodedInt16BlockSize(num_channels, num_samples));
+    // Nothing written past the end.
+    CHECK(encoded[num_bytes] == 0x5A);
+
+    Int16BlockHeader header;
+    std::vector<int16_t> values;
+    CHECK(decodeInt16Block(encoded.data(), num_bytes, &header, &values));
+    CHECK(header.num_bytes == num_bytes);
+    CHECK(header.num_samples == (uint32_t) num_samples);
+    CHECK(header.num_channels == (uint32_t) num_channels);
+    CHECK(header.sample_step == 3);
+    CHECK(header.first_sample_number == 1234567890123);
+    for (int c = 0; c < num_channels; c++) {
+        for (int t = 0; t < num_samples; t++) {
+            CHECK(values[(size_t) t * num_channels + c] == data[c][t]);
+        }
+    }
+
+    // Truncated blocks are rejected, and so is anything that doesn't start with the magic number.
+    CHECK(!decodeInt16Block(encoded.data(), num_bytes - 1, &header, &values));
+    CHECK(!decodeInt16Block(encoded.data() + 1, num_bytes - 1, &header, &values));
+    return num_bytes;
+}
+
+void testRoundTripsNoise() {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> dist(-32768, 32767);
+    for (int num_samples: {1, 2, 7, 64, 1000}) {
+        std::vector<std::vector<int16_t>> data(5, std::vector<int16_t>(num_samples));
+        for (auto &channel: data) {
+            for (auto &v: channel) {
+                v = (int16_t) dist(rng);
+            }
+        }
+        roundTrip(data, num_samples);
+    }
+}
+
+void testRoundTripsExtremes() {
+    // Full-scale swings need every bit of a wrapped delta.
+    std::vector<std::vector<int16_t>> data(2, std::vector<int16_t>(100));
+    for (int t = 0; t < 100; t++) {
+        data[0][t] = (t % 2) ? 32767 : -32768;
+        data[1][t] = (t % 3) ? -32768 : 0;
+    }
+    roundTrip(data, 100);
+}
+
+void testConstantChannelTakesNoBits() {
+    std::vector<std::vector<int16_t>> data(3, std::vector<int16_t>(500, -42));
+    size_t num_bytes = roundTrip(data, 500);
+    CHECK(num_bytes == Int16BlockHeader::kSize + 3 * 3);
+}
+
+void testSmoothSignalCompresses() {
+    const int num_samples = 1024;
+    std::mt19937 rng(11);
+    std::normal_distribution<float> noise(0.0f, 4.0f);
+    std::vector<std::vector<int16_t>> data(32, std::vector<int16_t>(num_samples));
+    for (size_t c = 0; c < data.size(); c++) {
+        for (int t = 0; t < num_samples; t++) {
+            data[c][t] = (int16_t) std::lround(800.0 * std::sin(0.01 * t + (double) c) + noise(rng));
+        }
+    }
+    size_t num_bytes = roundTrip(data, num_samples);
+    // Within ~+-40 of the last value, so about 7 bits instead of 16.
+    CHECK(num_bytes * 2 < data.size() * num_samples * sizeof(int16_t));
+}
+
+void testEmptyBlock() {
+    std::vector<char> encoded(maxEncodedInt16BlockSize(4, 0));
+    size_t num_bytes = encodeInt16Block(nullptr, 4, 0, 0, 1, encoded.data());
+    CHECK(memcmp(encoded.data(), "RI16", 4) == 0);
+    Int16BlockHeader header;
+    std::vector<int16_t> values;
+    CHECK(decodeInt16Block(encoded.data(), num_bytes, &header, &values));
+    CHECK(header.num_samples == 0);
+    CHECK(values.empty());
+}
+
+}  // namespace
+
+int main() {
+    testRoundTripsNoise();
+    testRoundTripsExtremes();
+    testConstantChannelTakesNoBits();
+    testSmoothSignalCompresses();
+    testEmptyBlock();
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Check.h"
+#include "Int16Quantizer.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+
+/** Compares the vector kernel against the scalar reference, including saturation and NaNs. */
+void testMatchesScalar(int num_channels, int num_samples, size_t frame_stride) {
+    std::mt19937 rng(num_channels * 1000 + num_samples);
+    std::normal_distribution<float> dist(0.0f, 3000.0f);
+
+    std::vector<std::vector<float>> data(num_channels, std::vector<float>(num_samples));
+    std::vector<const float *> channels(num_channels);
+    std::vector<float> scales(num_channels);
+    for (int c = 0; c < num_channels; c++) {
+        for (auto &v : data[c]) {
+            v = dist(rng);
+        }
+        scales[c] = 1.0f / (0.05f + 0.01f * (float) c);
+        channels[c] = data[c].data();
+    }
+    if (num_samples > 2) {
+        data[0][0] = 1e9f;
+        data[num_channels - 1][1] = -1e9f;
+        data[num_channels / 2][2] = std::numeric_limits<float>::quiet_NaN();
+    }
+
+    std::vector<char> expected(frame_stride * num_samples, 0x5A);
+    std::vector<char> actual(frame_stride * num_samples, 0x5A);
+    int64_t expected_saturated = quantizeToInterleavedInt16Scalar(
+            channels.data(), scales.data(), num_channels, num_samples, expected.data(), frame_stride);
+    int64_t actual_saturated = quantizeToInterleavedInt16(
+            channels.data(), scales.data(), num_channels, num_samples, actual.data(), frame_stride);
+
+    CHECK(expected_saturated == actual_saturated);
+    // Includes the bytes after the last channel, which must be left alone.
+    CHECK(memcmp(expected.data(), actual.data(), expected.size()) == 0);
+}
+
+void testRounding() {
+    const float values[] = {0.5f, 1.5f, -0.5f, -2.5f, 32767.4f, 32767.6f, -32768.6f};
+    const int16_t rounded[] = {0, 2, 0, -2, 32767, 32767, -32768};
+    const float *channel = values;
+    const float scale = 1.0f;
+    const int n = (int) (sizeof(values) / sizeof(values[0]));
+
+    std::vector<int16_t> out(n);
+    int64_t saturated = quantizeToInterleavedInt16(&channel, &scale, 1, n, (char *) out.data(), sizeof(int16_t));
+    CHECK(saturated == 2);
+    for (int i = 0; i < n; i++) {
+        CHECK(out[i] == rounded[i]);
+    }
+}
+
+}  // namespace
+
+int main() {
+    testRounding();
+    for (int num_channels : {1, 7, 8, 16, 33, 384}) {
+        for (int num_samples : {1, 7, 8, 9, 64, 1023}) {
+            testMatchesScalar(num_channels, num_samples, 2 * num_channels);
+            // Room for a trailing sample number.
+            testMatchesScalar(num_channels, num_samples, 2 * num_channels + 8);
+        }
+    }
+    printf("Checked the %s kernel\n", int16QuantizerKernelName());
+    return 0;
+}
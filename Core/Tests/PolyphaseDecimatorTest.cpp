@@ -0,0 +1,114 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Check.h"
+#include "PolyphaseDecimator.h"
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+/** Runs a decimator over per-channel signals in blocks of the given sizes, cycling through them. */
+std::vector<std::vector<float>> decimate(const std::vector<std::vector<float>> &input,
+                                         int factor,
+                                         const std::vector<int> &block_sizes) {
+    const int num_channels = (int) input.size();
+    const int num_samples = (int) input[0].size();
+    PolyphaseDecimator decimator(num_channels, factor);
+
+    std::vector<std::vector<float>> output(num_channels);
+    std::vector<std::vector<float>> block_out(num_channels, std::vector<float>(num_samples));
+    std::vector<const float *> in_ptrs(num_channels);
+    std::vector<float *> out_ptrs(num_channels);
+
+    int offset = 0;
+    for (size_t b = 0; offset < num_samples; b++) {
+        int n = std::min(block_sizes[b % block_sizes.size()], num_samples - offset);
+        for (int c = 0; c < num_channels; c++) {
+            in_ptrs[c] = input[c].data() + offset;
+            out_ptrs[c] = block_out[c].data();
+        }
+        int expected = decimator.numOutputsFor(n);
+        int produced = decimator.process(in_ptrs.data(), n, out_ptrs.data());
+        CHECK(produced == expected);
+        for (int c = 0; c < num_channels; c++) {
+            output[c].insert(output[c].end(), block_out[c].begin(), block_out[c].begin() + produced);
+        }
+        offset += n;
+    }
+    return output;
+}
+
+std::vector<float> sine(int num_samples, double frequency, double sampling_rate) {
+    std::vector<float> out(num_samples);
+    for (int i = 0; i < num_samples; i++) {
+        out[i] = (float) std::sin(2 * kPi * frequency * i / sampling_rate);
+    }
+    return out;
+}
+
+double rmsAfter(const std::vector<float> &values, size_t skip) {
+    double sum = 0;
+    for (size_t i = skip; i < values.size(); i++) {
+        sum += (double) values[i] * values[i];
+    }
+    return std::sqrt(sum / (double) (values.size() - skip));
+}
+
+}  // namespace
+
+int main() {
+    const double rate = 30000;
+    const int factor = 10;
+    const int num_samples = 30000;
+
+    std::vector<std::vector<float>> input = {
+            std::vector<float>(num_samples, 1.0f),
+            sine(num_samples, 100, rate),
+            sine(num_samples, 5000, rate),
+    };
+
+    // Splitting the input differently doesn't change the output.
+    auto whole = decimate(input, factor, {num_samples});
+    auto split = decimate(input, factor, {1, 7, 1024, 333, 10});
+    CHECK(whole[0].size() == (size_t) (num_samples / factor));
+    for (size_t c = 0; c < whole.size(); c++) {
+        CHECK(whole[c].size() == split[c].size());
+        for (size_t i = 0; i < whole[c].size(); i++) {
+            CHECK(std::fabs(whole[c][i] - split[c][i]) < 1e-5f);
+        }
+    }
+
+    // Skip the filter's start-up transient.
+    PolyphaseDecimator reference(1, factor);
+    size_t skip = (size_t) reference.numTaps() / factor + 1;
+
+    // Unity gain at DC, 100 Hz passes, and 5 kHz (above the new 1.5 kHz Nyquist) is attenuated.
+    CHECK(std::fabs(whole[0].back() - 1.0f) < 1e-3f);
+    CHECK(std::fabs(rmsAfter(whole[1], skip) - std::sqrt(0.5)) < 0.01);
+    CHECK(rmsAfter(whole[2], skip) < 1e-3);
+    return 0;
+}
@@ -0,0 +1,67 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Check.h"
+#include "RiverClock.h"
+
+#include <cstddef>
+
+int main() {
+    auto fields = riverClockFields();
+    CHECK(fields.size() == 3);
+    CHECK(fields[0].name == "sample_number");
+    CHECK(fields[1].name == "steady_ns");
+    CHECK(fields[2].name == "system_ns");
+    CHECK(river::StreamSchema(fields).sample_size() == (int) sizeof(RiverClockSample));
+    CHECK(offsetof(RiverClockSample, steady_ns) == 8);
+    CHECK(offsetof(RiverClockSample, system_ns) == 16);
+
+    char buffer[1 + sizeof(RiverClockSample)] = {};
+    packRiverClockSample(buffer + 1, 30000, 123456789, (int64_t{1} << 60) + 5);
+    RiverClockSample sample;
+    memcpy(&sample, buffer + 1, sizeof(RiverClockSample));
+    CHECK(sample.sample_number == 30000);
+    CHECK(sample.steady_ns == 123456789);
+    CHECK(sample.system_ns == (int64_t{1} << 60) + 5);
+    CHECK(buffer[0] == 0);
+
+    // Every block.
+    ClockSampler every_block(0);
+    CHECK(every_block.due(100));
+    CHECK(every_block.due(100));
+    CHECK(every_block.due(101));
+
+    // At most one per 10 ns, starting with the first block.
+    ClockSampler sampler(10);
+    CHECK(sampler.intervalNs() == 10);
+    CHECK(sampler.due(1000));
+    CHECK(!sampler.due(1005));
+    CHECK(!sampler.due(1009));
+    CHECK(sampler.due(1013));
+    // Measured from the last sample taken, not from a fixed grid.
+    CHECK(!sampler.due(1020));
+    CHECK(sampler.due(1023));
+
+    CHECK(ClockSampler(-5).intervalNs() == 0);
+    return 0;
+}
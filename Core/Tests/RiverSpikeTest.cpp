@@ -0,0 +1,52 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Check.h"
+#include "RiverSpike.h"
+
+#include <cstddef>
+
+int main() {
+    auto fields = riverSpikeFields();
+    CHECK(fields.size() == 3);
+    CHECK(fields[0].name == "channel_index");
+    CHECK(fields[1].name == "unit_index");
+    CHECK(fields[2].name == "sample_number");
+    CHECK(river::StreamSchema(fields).sample_size() == (int) sizeof(RiverSpike));
+
+    CHECK(offsetof(RiverSpike, channel_index) == 0);
+    CHECK(offsetof(RiverSpike, unit_index) == 4);
+    CHECK(offsetof(RiverSpike, sample_number) == 8);
+
+    // Packed at an odd offset, as happens after a waveform or in an event batch.
+    char buffer[1 + sizeof(RiverSpike)] = {};
+    packRiverSpike(buffer + 1, 12, -3, (int64_t{1} << 40) + 7);
+
+    RiverSpike spike;
+    memcpy(&spike, buffer + 1, sizeof(RiverSpike));
+    CHECK(spike.channel_index == 12);
+    CHECK(spike.unit_index == -3);
+    CHECK(spike.sample_number == (int64_t{1} << 40) + 7);
+    CHECK(buffer[0] == 0);
+    return 0;
+}
@@ -0,0 +1,475 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Check.h"
+#include "RiverWriterQueue.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+RiverWriterOptions optionsFor(int max_batch_size, int max_slabs, OverflowPolicy policy) {
+    RiverWriterOptions options;
+    options.max_latency_ms = 1000;
+    options.max_batch_size = max_batch_size;
+    options.sample_size = sizeof(int64_t);
+    options.capacity_bytes = (size_t) max_slabs * max_batch_size * sizeof(int64_t);
+    options.overflow_policy = policy;
+    options.block_timeout_ms = 0;
+    return options;
+}
+
+bool enqueueValue(RiverWriterQueue &queue, int64_t value) {
+    return queue.enqueue(reinterpret_cast<const char *>(&value), sizeof(value), 1);
+}
+
+std::vector<int64_t> valuesIn(const MemorySink &sink) {
+    auto bytes = sink.bytes();
+    std::vector<int64_t> values(bytes.size() / sizeof(int64_t));
+    memcpy(values.data(), bytes.data(), values.size() * sizeof(int64_t));
+    return values;
+}
+
+/** A MemorySink that throws while failing is set, like a RiverStreamSink whose Redis went away */
+class FlakySink : public MemorySink {
+public:
+    void write(const char *data, size_t num_bytes, int64_t num_samples) override {
+        attempts.push_back(std::vector<char>(data, data + num_bytes));
+        if (failing) {
+            throw std::runtime_error("connection refused");
+        }
+        MemorySink::write(data, num_bytes, num_samples);
+    }
+
+    void reconnect() override {
+        num_reconnects++;
+        if (failing) {
+            throw std::runtime_error("connection refused");
+        }
+    }
+
+    bool failing = false;
+    int num_reconnects = 0;
+    // Every batch write() was given, including the ones that failed.
+    std::vector<std::vector<char>> attempts;
+};
+
+void testBatchesInOrder() {
+    MemorySink sink;
+    RiverWriterQueue queue(&sink, optionsFor(4, 16, OverflowPolicy::DROP_NEWEST));
+    RiverWriterPool pool({&queue}, 1);
+    pool.start();
+
+    for (int64_t i = 0; i < 10; i++) {
+        CHECK(enqueueValue(queue, i));
+    }
+    queue.publish();
+    pool.stop();
+
+    auto batches = sink.batches();
+    CHECK(batches.size() == 3);
+    CHECK(batches[0].num_samples == 4);
+    CHECK(batches[1].num_samples == 4);
+    CHECK(batches[2].num_samples == 2);
+    CHECK(batches[2].bytes.size() == 2 * sizeof(int64_t));
+
+    auto values = valuesIn(sink);
+    CHECK(values.size() == 10);
+    for (int64_t i = 0; i < 10; i++) {
+        CHECK(values[i] == i);
+    }
+    CHECK(queue.dropCounts().total() == 0);
+
+    auto metrics = queue.metrics();
+    CHECK(metrics.queue_depth == 0);
+    CHECK(metrics.queue_depth_high_water >= 1);
+    CHECK(metrics.bytes_written == 10 * (int64_t) sizeof(int64_t));
+    CHECK(metrics.batches_written == 3);
+    CHECK(metrics.batch_size.count == 3);
+    CHECK(metrics.batch_size.max == 4);
+    CHECK(metrics.write_duration_us.count == 3);
+}
+
+void testReserveInPlace() {
+    MemorySink sink;
+    RiverWriterQueue queue(&sink, optionsFor(8, 4, OverflowPolicy::DROP_NEWEST));
+
+    // A payload of three samples, written straight into the slab.
+    char *dst = queue.reserve(3 * sizeof(int64_t), 3);
+    CHECK(dst != nullptr);
+    for (int64_t i = 0; i < 3; i++) {
+        memcpy(dst + i * sizeof(int64_t), &i, sizeof(i));
+    }
+    queue.commit();
+    queue.publish();
+    queue.writeFilledSlabs();
+
+    CHECK(sink.numSamples() == 3);
+    CHECK(valuesIn(sink) == std::vector<int64_t>({0, 1, 2}));
+
+    // Room for up to four samples, of which only two get used; the next reservation follows straight on.
+    dst = queue.reserve(4 * sizeof(int64_t), 4);
+    CHECK(dst != nullptr);
+    for (int64_t i = 3; i < 5; i++) {
+        memcpy(dst + (i - 3) * sizeof(int64_t), &i, sizeof(i));
+    }
+    queue.commit(2 * sizeof(int64_t), 2);
+    CHECK(enqueueValue(queue, 5));
+    queue.publish();
+    queue.writeFilledSlabs();
+
+    CHECK(sink.numSamples() == 6);
+    CHECK(valuesIn(sink) == std::vector<int64_t>({0, 1, 2, 3, 4, 5}));
+}
+
+void testPublishIfDue() {
+    MemorySink sink;
+    auto options = optionsFor(1024, 4, OverflowPolicy::DROP_NEWEST);
+    options.max_latency_ms = 20;
+    RiverWriterQueue queue(&sink, options);
+
+    // Driven by hand, standing in for the writer thread.
+    CHECK(enqueueValue(queue, 1));
+    queue.publishIfDue();
+    queue.writeFilledSlabs();
+    CHECK(sink.batches().empty());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    queue.publishIfDue();
+    queue.writeFilledSlabs();
+    CHECK(sink.batches().size() == 1);
+
+    // Nothing left to publish.
+    queue.publishIfDue();
+    queue.publish();
+    queue.writeFilledSlabs();
+    CHECK(sink.batches().size() == 1);
+}
+
+void testDropNewest() {
+    MemorySink sink;
+    RiverWriterQueue queue(&sink, optionsFor(2, 2, OverflowPolicy::DROP_NEWEST));
+
+    // Two full slabs that haven't been written yet.
+    for (int64_t i = 0; i < 4; i++) {
+        CHECK(enqueueValue(queue, i));
+    }
+    CHECK(!enqueueValue(queue, 4));
+    CHECK(!enqueueValue(queue, 5));
+    CHECK(queue.dropCounts().newest == 2);
+
+    queue.writeFilledSlabs();
+    CHECK(valuesIn(sink) == std::vector<int64_t>({0, 1, 2, 3}));
+
+    // Room again once the writer has caught up.
+    CHECK(enqueueValue(queue, 6));
+    CHECK(queue.dropCounts().total() == 2);
+}
+
+void testDropOldest() {
+    MemorySink sink;
+    RiverWriterQueue queue(&sink, optionsFor(2, 2, OverflowPolicy::DROP_OLDEST));
+
+    for (int64_t i = 0; i < 6; i++) {
+        CHECK(enqueueValue(queue, i));
+    }
+    queue.publish();
+    queue.writeFilledSlabs();
+
+    CHECK(queue.dropCounts().oldest == 2);
+    CHECK(valuesIn(sink) == std::vector<int64_t>({2, 3, 4, 5}));
+}
+
+void testCapacityCountsBytes() {
+    MemorySink sink;
+    // Room for 8 samples, in batches of up to 4.
+    RiverWriterQueue queue(&sink, optionsFor(4, 2, OverflowPolicy::DROP_NEWEST));
+
+    // Batches published early only take up the samples they hold.
+    for (int64_t i = 0; i < 8; i++) {
+        CHECK(enqueueValue(queue, i));
+        queue.publish();
+    }
+    CHECK(!enqueueValue(queue, 8));
+    CHECK(queue.dropCounts().newest == 1);
+    CHECK(queue.metrics().queue_depth == 8 * (int64_t) sizeof(int64_t));
+    CHECK(queue.metrics().queue_capacity == 8 * (int64_t) sizeof(int64_t));
+
+    queue.writeFilledSlabs();
+    CHECK(queue.metrics().queue_depth == 0);
+
+    // A payload bigger than a batch but within the capacity is queued as is, without allocating.
+    std::vector<int64_t> values = {10, 11, 12, 13, 14, 15};
+    CHECK(queue.enqueue(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(int64_t), 6));
+    // One bigger than the whole capacity never fits.
+    std::vector<int64_t> too_many(9);
+    CHECK(!queue.enqueue(reinterpret_cast<const char *>(too_many.data()), too_many.size() * sizeof(int64_t), 9));
+    CHECK(queue.dropCounts().newest == 10);
+    queue.publish();
+    queue.writeFilledSlabs();
+
+    // Wrapping around the arena many times.
+    for (int64_t i = 0; i < 1000; i++) {
+        CHECK(enqueueValue(queue, 100 + i));
+        if (i % 3 == 0) {
+            queue.publish();
+        }
+        if (i % 5 == 0) {
+            queue.writeFilledSlabs();
+        }
+    }
+    queue.publish();
+    queue.writeFilledSlabs();
+
+    auto written = valuesIn(sink);
+    CHECK(written.size() == 8 + 6 + 1000);
+    for (int64_t i = 0; i < 1000; i++) {
+        CHECK(written[14 + i] == 100 + i);
+    }
+    CHECK(queue.dropCounts().newest == 10);
+}
+
+void testBuffersWhileDisconnected() {
+    FlakySink sink;
+    auto options = optionsFor(2, 16, OverflowPolicy::DROP_NEWEST);
+    options.reconnect_initial_ms = 20;
+    options.reconnect_max_ms = 50;
+    std::vector<std::string> logged;
+    options.log = [&logged](const std::string &message) { logged.push_back(message); };
+    RiverWriterQueue queue(&sink, options);
+
+    sink.failing = true;
+    for (int64_t i = 0; i < 4; i++) {
+        CHECK(enqueueValue(queue, i));
+    }
+    int wait_ms = queue.writeFilledSlabs();
+    CHECK(wait_ms > 0 && wait_ms <= 20);
+    CHECK(!queue.connectionStats().connected);
+
+    // Nothing is tried before the backoff elapses; the batches wait in the queue.
+    CHECK(enqueueValue(queue, 4));
+    CHECK(enqueueValue(queue, 5));
+    CHECK(queue.writeFilledSlabs() > 0);
+    CHECK(sink.num_reconnects == 0);
+
+    // Each failed reconnect doubles the backoff, up to reconnect_max_ms.
+    std::this_thread::sleep_for(std::chrono::milliseconds(25));
+    wait_ms = queue.writeFilledSlabs();
+    CHECK(sink.num_reconnects == 1);
+    CHECK(wait_ms > 20 && wait_ms <= 40);
+    std::this_thread::sleep_for(std::chrono::milliseconds(45));
+    wait_ms = queue.writeFilledSlabs();
+    CHECK(sink.num_reconnects == 2);
+    CHECK(wait_ms > 40 && wait_ms <= 50);
+
+    sink.failing = false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(55));
+    CHECK(queue.writeFilledSlabs() == -1);
+    CHECK(valuesIn(sink) == std::vector<int64_t>({0, 1, 2, 3, 4, 5}));
+
+    auto stats = queue.connectionStats();
+    CHECK(stats.connected);
+    CHECK(stats.reconnect_attempts == 3);
+    CHECK(stats.reconnects == 1);
+    CHECK(stats.current_outage_s == 0);
+    CHECK(stats.total_outage_s >= 0.1);
+    CHECK(stats.longest_outage_s == stats.total_outage_s);
+    CHECK(queue.dropCounts().total() == 0);
+    // Once when the outage started, once when it ended.
+    CHECK(logged.size() == 2);
+
+    // What can't be written by the time the writer stops is lost.
+    sink.failing = true;
+    CHECK(enqueueValue(queue, 6));
+    CHECK(enqueueValue(queue, 7));
+    queue.finish(std::chrono::steady_clock::now());
+    CHECK(queue.dropCounts().failed == 2);
+}
+
+void testRetriesFailedBatchFirst() {
+    // RiverStreamSink relies on this to skip what a failed write got through, with or without a spool.
+    for (bool spooling: {false, true}) {
+        const std::string path = "RiverWriterQueueTest-retry.spool";
+        FlakySink sink;
+        auto options = optionsFor(2, 16, OverflowPolicy::DROP_NEWEST);
+        options.reconnect_initial_ms = 1;
+        if (spooling) {
+            options.spool_path = path;
+        }
+        {
+            RiverWriterQueue queue(&sink, options);
+            sink.failing = true;
+            CHECK(enqueueValue(queue, 0));
+            CHECK(enqueueValue(queue, 1));
+            queue.writeFilledSlabs();
+            CHECK(sink.attempts.size() == 1);
+
+            sink.failing = false;
+            CHECK(enqueueValue(queue, 2));
+            CHECK(enqueueValue(queue, 3));
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            CHECK(queue.writeFilledSlabs() == -1);
+            CHECK(sink.attempts.size() == 3);
+            CHECK(sink.attempts[1] == sink.attempts[0]);
+            CHECK(valuesIn(sink) == std::vector<int64_t>({0, 1, 2, 3}));
+        }
+        std::remove(path.c_str());
+    }
+}
+
+void testSpoolReplaysInOrder() {
+    const std::string path = "RiverWriterQueueTest.spool";
+    FlakySink sink;
+    auto options = optionsFor(2, 16, OverflowPolicy::DROP_NEWEST);
+    options.spool_path = path;
+    options.reconnect_initial_ms = 1000;
+    {
+        RiverWriterQueue queue(&sink, options);
+
+        CHECK(enqueueValue(queue, 0));
+        CHECK(enqueueValue(queue, 1));
+        CHECK(queue.writeFilledSlabs() == -1);
+
+        // Redis goes away: everything goes to the spool, and the writer asks to be called back for a retry.
+        sink.failing = true;
+        for (int64_t i = 2; i < 8; i++) {
+            CHECK(enqueueValue(queue, i));
+        }
+        int wait_ms = queue.writeFilledSlabs();
+        CHECK(wait_ms > 0 && wait_ms <= 1000);
+        CHECK(queue.spoolStats().pending_samples == 6);
+        CHECK(queue.spoolStats().spooled_samples == 6);
+        CHECK(queue.dropCounts().total() == 0);
+
+        // Back again, but the reconnect isn't due yet, so new batches queue up behind the spooled ones.
+        sink.failing = false;
+        CHECK(enqueueValue(queue, 8));
+        CHECK(enqueueValue(queue, 9));
+        queue.writeFilledSlabs();
+        CHECK(valuesIn(sink) == std::vector<int64_t>({0, 1}));
+
+        // finish() doesn't wait for the backoff.
+        queue.finish(std::chrono::steady_clock::time_point::max());
+        CHECK(valuesIn(sink) == std::vector<int64_t>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+        CHECK(queue.spoolStats().pending_samples == 0);
+        CHECK(queue.spoolStats().replayed_samples == 8);
+        CHECK(queue.connectionStats().connected);
+        CHECK(queue.connectionStats().reconnects == 1);
+    }
+
+    // Drained, so nothing left on disk.
+    FILE *file = fopen(path.c_str(), "rb");
+    CHECK(file == nullptr);
+}
+
+void testFinishLeavesSpoolPastDeadline() {
+    const std::string path = "RiverWriterQueueTest-deadline.spool";
+    FlakySink sink;
+    auto options = optionsFor(2, 16, OverflowPolicy::DROP_NEWEST);
+    options.spool_path = path;
+    {
+        RiverWriterQueue queue(&sink, options);
+
+        sink.failing = true;
+        for (int64_t i = 0; i < 4; i++) {
+            CHECK(enqueueValue(queue, i));
+        }
+        queue.writeFilledSlabs();
+        CHECK(queue.spoolStats().pending_samples == 4);
+
+        // Redis is back, but there's no time left to replay: the spool (and whatever was published since) stays put.
+        sink.failing = false;
+        CHECK(enqueueValue(queue, 4));
+        CHECK(enqueueValue(queue, 5));
+        queue.finish(std::chrono::steady_clock::now());
+        CHECK(valuesIn(sink).empty());
+        CHECK(queue.spoolStats().pending_samples == 6);
+        CHECK(queue.spoolStats().replayed_samples == 0);
+        CHECK(queue.dropCounts().total() == 0);
+    }
+
+    FILE *file = fopen(path.c_str(), "rb");
+    CHECK(file != nullptr);
+    if (file) {
+        fclose(file);
+    }
+    std::remove(path.c_str());
+}
+
+void testPoolWithManyQueues() {
+    constexpr int kNumQueues = 5;
+    constexpr int64_t kNumSamples = 100000;
+
+    std::vector<std::unique_ptr<NullSink>> sinks;
+    std::vector<std::unique_ptr<RiverWriterQueue>> queues;
+    std::vector<RiverWriterQueue *> queue_pointers;
+    for (int q = 0; q < kNumQueues; q++) {
+        sinks.push_back(std::make_unique<NullSink>());
+        auto options = optionsFor(256, 8, OverflowPolicy::BLOCK);
+        options.block_timeout_ms = 10000;
+        queues.push_back(std::make_unique<RiverWriterQueue>(sinks.back().get(), options));
+        queue_pointers.push_back(queues.back().get());
+    }
+
+    RiverWriterPool pool(queue_pointers, 2);
+    CHECK(pool.numThreads() == 2);
+    pool.start();
+    for (int64_t i = 0; i < kNumSamples; i++) {
+        for (auto &queue: queues) {
+            CHECK(enqueueValue(*queue, i));
+        }
+    }
+    for (auto &queue: queues) {
+        queue->publish();
+    }
+    pool.stop();
+
+    for (int q = 0; q < kNumQueues; q++) {
+        CHECK(sinks[q]->numSamples() == kNumSamples);
+        CHECK(sinks[q]->numBytes() == kNumSamples * (int64_t) sizeof(int64_t));
+        CHECK(queues[q]->dropCounts().total() == 0);
+    }
+}
+
+}  // namespace
+
+int main() {
+    testBatchesInOrder();
+    testReserveInPlace();
+    testPublishIfDue();
+    testDropNewest();
+    testDropOldest();
+    testCapacityCountsBytes();
+    testBuffersWhileDisconnected();
+    testRetriesFailedBatchFirst();
+    testSpoolReplaysInOrder();
+    testFinishLeavesSpoolPastDeadline();
+    testPoolWithManyQueues();
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Check.h"
+#include "SpikeBinner.h"
+
+#include <vector>
+
+namespace {
+
+struct Bin {
+    int64_t start;
+    std::vector<uint16_t> counts;
+};
+
+struct Collector {
+    std::vector<Bin> *bins;
+    int counts_per_bin;
+
+    void operator()(int64_t start, const uint16_t *counts) const {
+        bins->push_back(Bin{start, std::vector<uint16_t>(counts, counts + counts_per_bin)});
+    }
+};
+
+void testCountsAlignedBins() {
+    // 2 channels x 3 units, bins of 10 samples.
+    SpikeBinner binner(2, 3, 10);
+    std::vector<Bin> bins;
+    Collector collect{&bins, binner.countsPerBin()};
+
+    binner.start(25);
+    CHECK(binner.add(0, 1, 25));
+    CHECK(binner.add(0, 1, 29));
+    CHECK(binner.add(1, 2, 31));
+    CHECK(binner.add(1, 0, 55));
+
+    // Nothing has finished by 29; [20, 30) has by 30.
+    CHECK(binner.emitBinsEndingBy(29, collect) == 0);
+    CHECK(binner.emitBinsEndingBy(30, collect) == 1);
+    CHECK(bins[0].start == 20);
+    CHECK(bins[0].counts == (std::vector<uint16_t>{0, 2, 0, 0, 0, 0}));
+
+    // Empty bins in between are still emitted.
+    CHECK(binner.emitBinsEndingBy(60, collect) == 3);
+    CHECK(bins[1].start == 30);
+    CHECK(bins[1].counts == (std::vector<uint16_t>{0, 0, 0, 0, 0, 1}));
+    CHECK(bins[2].start == 40);
+    CHECK(bins[2].counts == std::vector<uint16_t>(6, 0));
+    CHECK(bins[3].start == 50);
+    CHECK(bins[3].counts == (std::vector<uint16_t>{0, 0, 0, 1, 0, 0}));
+    CHECK(binner.numLate() == 0);
+}
+
+void testLateAndDroppedSpikes() {
+    SpikeBinner binner(1, 2, 10);
+    std::vector<Bin> bins;
+    Collector collect{&bins, binner.countsPerBin()};
+
+    binner.start(0);
+    binner.emitBinsEndingBy(20, collect);
+    // Its bin is gone, so it lands in [20, 30).
+    CHECK(binner.add(0, 1, 15));
+    CHECK(binner.numLate() == 1);
+    CHECK(!binner.add(1, 0, 25));
+    CHECK(!binner.add(0, 2, 25));
+    CHECK(!binner.add(0, 0, 20 + 10 * SpikeBinner::kMaxOpenBins));
+    CHECK(binner.numDropped() == 3);
+
+    CHECK(binner.emitAll(collect) == 1);
+    CHECK(bins.back().start == 20);
+    CHECK(bins.back().counts == (std::vector<uint16_t>{0, 1}));
+}
+
+void testReusesBinsInOrder() {
+    // Many bins open at once, around the ring several times.
+    SpikeBinner binner(1, 1, 4);
+    std::vector<Bin> bins;
+    Collector collect{&bins, binner.countsPerBin()};
+
+    int64_t emitted_until = 0;
+    int64_t allocations_after_warm_up = 0;
+    for (int64_t block = 0; block < 50; block++) {
+        // One spike per sample for block * 7 .. block * 7 + 6, emitting with a lag of 5 samples.
+        for (int64_t s = block * 7; s < block * 7 + 7; s++) {
+            CHECK(binner.add(0, 0, s));
+        }
+        emitted_until = block * 7 + 7 - 5;
+        binner.emitBinsEndingBy(emitted_until, collect);
+        if (block == 10) {
+            allocations_after_warm_up = binner.numAllocations();
+        }
+    }
+    // Once the ring is as big as it needs to be, bins are reused without allocating.
+    CHECK(allocations_after_warm_up > 0);
+    CHECK(binner.numAllocations() == allocations_after_warm_up);
+    binner.emitAll(collect);
+    CHECK(binner.numLate() == 0);
+    for (size_t i = 0; i < bins.size(); i++) {
+        CHECK(bins[i].start == (int64_t) i * 4);
+        // 350 spikes in total; the last bin only gets 2.
+        CHECK(bins[i].counts[0] == (i + 1 < bins.size() ? 4 : 2));
+    }
+    CHECK(bins.size() == 88);
+}
+
+void testSaturates() {
+    SpikeBinner binner(1, 1, 1000000);
+    for (int i = 0; i < 70000; i++) {
+        binner.add(0, 0, 5);
+    }
+    std::vector<Bin> bins;
+    binner.emitAll(Collector{&bins, 1});
+    CHECK(bins.size() == 1);
+    CHECK(bins[0].counts[0] == UINT16_MAX);
+}
+
+}  // namespace
+
+int main() {
+    testCountsAlignedBins();
+    testLateAndDroppedSpikes();
+    testReusesBinsInOrder();
+    testSaturates();
+    return 0;
+}
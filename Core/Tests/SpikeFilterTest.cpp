@@ -0,0 +1,97 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Check.h"
+#include "SpikeFilter.h"
+
+#include <string>
+
+namespace {
+
+void testDefaultAcceptsEverything() {
+    SpikeFilter filter;
+    CHECK(filter.acceptsAll());
+    CHECK(filter.accepts(0, 0));
+    CHECK(filter.accepts(100000, 65535));
+    CHECK(filter.channels().empty());
+    CHECK(filter.units().empty());
+}
+
+void testChannelAndUnitLists() {
+    SpikeFilter filter;
+    CHECK(filter.setChannels("0-3, 8 ,10-11"));
+    CHECK(filter.setUnits("1,2"));
+    CHECK(!filter.acceptsAll());
+    CHECK(filter.channels() == "0-3,8,10-11");
+    CHECK(filter.units() == "1-2");
+
+    CHECK(filter.accepts(0, 1));
+    CHECK(filter.accepts(3, 2));
+    CHECK(filter.accepts(11, 1));
+    CHECK(!filter.accepts(4, 1));
+    CHECK(!filter.accepts(9, 2));
+    CHECK(!filter.accepts(0, 3));
+    CHECK(!filter.accepts(0, 0));
+    CHECK(!filter.accepts(-1, 1));
+    CHECK(!filter.accepts(SpikeFilter::kMaxChannels, 1));
+
+    // Clearing a list lets everything through again.
+    CHECK(filter.setChannels(" "));
+    CHECK(filter.accepts(4000, 1));
+}
+
+void testDropUnsorted() {
+    SpikeFilter filter;
+    filter.setDropUnsorted(true);
+    CHECK(!filter.acceptsAll());
+    CHECK(!filter.accepts(0, 0));
+    CHECK(filter.accepts(0, 1));
+
+    // Takes precedence over a unit list that includes 0.
+    CHECK(filter.setUnits("0-5"));
+    CHECK(!filter.accepts(0, 0));
+    CHECK(filter.accepts(0, 5));
+}
+
+void testInvalidListsAreRejected() {
+    SpikeFilter filter;
+    CHECK(filter.setChannels("1-2"));
+    for (const char *spec: {"a", "1-", "3-1", "1,,2", "-1", "1 2", "4096", "1-5000"}) {
+        CHECK(!filter.setChannels(spec));
+    }
+    // Unchanged by the failures.
+    CHECK(filter.channels() == "1-2");
+    CHECK(!filter.setUnits("65536"));
+    CHECK(filter.setUnits("65535"));
+    CHECK(filter.accepts(1, 65535));
+}
+
+}  // namespace
+
+int main() {
+    testDefaultAcceptsEverything();
+    testChannelAndUnitLists();
+    testDropUnsorted();
+    testInvalidListsAreRejected();
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Check.h"
+#include "SpoolFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool fileExists(const std::string &path) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file) {
+        fclose(file);
+    }
+    return file != nullptr;
+}
+
+void testAppendAndPopInOrder() {
+    const std::string path = "SpoolFileTest-order.spool";
+    {
+        // Small enough that it has to grow a few times.
+        SpoolFile spool(path, 64);
+        CHECK(spool.empty());
+
+        std::vector<int64_t> values(100);
+        for (int64_t i = 0; i < 100; i++) {
+            values[i] = i;
+        }
+        for (int64_t i = 0; i < 100; i += 10) {
+            spool.append(reinterpret_cast<const char *>(&values[i]), 10 * sizeof(int64_t), 10);
+        }
+        CHECK(!spool.empty());
+        CHECK(spool.pendingSamples() == 100);
+        CHECK(spool.capacity() > 64);
+
+        int64_t expected = 0;
+        const char *data;
+        size_t num_bytes;
+        int64_t num_samples;
+        while (spool.peek(&data, &num_bytes, &num_samples)) {
+            CHECK(num_samples == 10);
+            CHECK(num_bytes == 10 * sizeof(int64_t));
+            auto *batch = reinterpret_cast<const int64_t *>(data);
+            for (int64_t i = 0; i < num_samples; i++) {
+                CHECK(batch[i] == expected++);
+            }
+            spool.pop();
+        }
+        CHECK(expected == 100);
+        CHECK(spool.empty());
+        CHECK(spool.pendingBytes() == 0);
+
+        // Reused from the start once drained; odd sizes get padded.
+        spool.append("abc", 3, 1);
+        CHECK(spool.peek(&data, &num_bytes, &num_samples));
+        CHECK(num_bytes == 3);
+        CHECK(std::string(data, 3) == "abc");
+        spool.pop();
+    }
+    // Nothing left to recover, so the file is gone.
+    CHECK(!fileExists(path));
+}
+
+void testLeftoverIsKept() {
+    const std::string path = "SpoolFileTest-leftover.spool";
+    {
+        SpoolFile spool(path, 64);
+        spool.append("01234567", 8, 1);
+        spool.append("89abcdef", 8, 1);
+        spool.pop();
+    }
+    CHECK(fileExists(path));
+
+    // Header, then the read offset pointing past the first record, then both records and the terminator.
+    FILE *file = fopen(path.c_str(), "rb");
+    std::vector<char> contents(256);
+    size_t n = fread(contents.data(), 1, contents.size(), file);
+    fclose(file);
+    remove(path.c_str());
+
+    CHECK(n == 16 + 2 * (16 + 8) + 16);
+    CHECK(std::string(contents.data(), 7) == "RIVSPL1");
+    uint64_t read_offset;
+    memcpy(&read_offset, contents.data() + 8, sizeof(read_offset));
+    CHECK(read_offset == 16 + 16 + 8);
+    CHECK(std::string(contents.data() + read_offset + 16, 8) == "89abcdef");
+}
+
+void testBadPathThrows() {
+    bool threw = false;
+    try {
+        SpoolFile spool("no-such-directory/SpoolFileTest.spool");
+    } catch (const std::exception &) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+}  // namespace
+
+int main() {
+    testAppendAndPopInOrder();
+    testLeftoverIsKept();
+    testBadPathThrows();
+    return 0;
+}
@@ -0,0 +1,139 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Check.h"
+#include "SpscRingBuffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace {
+
+void testFillAndDrain() {
+    SpscRingBuffer<int> ring(5);
+    // Rounded up to a power of two.
+    CHECK(ring.capacity() == 8);
+
+    int value;
+    CHECK(!ring.tryPop(value));
+    for (int i = 0; i < 8; i++) {
+        CHECK(ring.tryPush(i));
+    }
+    CHECK(!ring.tryPush(8));
+    CHECK(ring.size() == 8);
+
+    for (int i = 0; i < 8; i++) {
+        CHECK(ring.tryPop(value));
+        CHECK(value == i);
+    }
+    CHECK(!ring.tryPop(value));
+}
+
+void testStealOldest() {
+    SpscRingBuffer<int> ring(4);
+    for (int i = 0; i < 4; i++) {
+        CHECK(ring.tryPush(i));
+    }
+
+    int value;
+    CHECK(ring.tryStealOldest(value));
+    CHECK(value == 0);
+    CHECK(ring.tryPush(4));
+
+    for (int i = 1; i <= 4; i++) {
+        CHECK(ring.tryPop(value));
+        CHECK(value == i);
+    }
+    CHECK(!ring.tryStealOldest(value));
+}
+
+void testConcurrentOrdering() {
+    constexpr int64_t kNumValues = 200000;
+    SpscRingBuffer<int64_t> ring(64);
+
+    std::thread consumer([&]() {
+        int64_t expected = 0;
+        int64_t value;
+        while (expected < kNumValues) {
+            if (ring.tryPop(value)) {
+                CHECK(value == expected);
+                expected++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    for (int64_t i = 0; i < kNumValues;) {
+        if (ring.tryPush(i)) {
+            i++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+}
+
+void testConcurrentSteal() {
+    constexpr int64_t kNumValues = 200000;
+    SpscRingBuffer<int64_t> ring(8);
+    std::atomic<bool> done(false);
+    int64_t num_popped = 0;
+
+    // Every value comes out exactly once, either popped or stolen, and the consumer still sees them in order.
+    std::thread consumer([&]() {
+        int64_t last = -1;
+        int64_t value;
+        while (!done.load() || ring.size() > 0) {
+            if (ring.tryPop(value)) {
+                CHECK(value > last);
+                last = value;
+                num_popped++;
+            }
+        }
+    });
+
+    int64_t num_stolen = 0;
+    for (int64_t i = 0; i < kNumValues; i++) {
+        int64_t stolen;
+        while (!ring.tryPush(i)) {
+            if (ring.tryStealOldest(stolen)) {
+                num_stolen++;
+            }
+        }
+    }
+    done.store(true);
+    consumer.join();
+    CHECK(num_popped + num_stolen == kNumValues);
+}
+
+}  // namespace
+
+int main() {
+    testFillAndDrain();
+    testStealOldest();
+    testConcurrentOrdering();
+    testConcurrentSteal();
+    return 0;
+}
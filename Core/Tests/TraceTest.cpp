@@ -0,0 +1,103 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Check.h"
+#include "Trace.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::string readFile(const std::string &path) {
+    std::ifstream file(path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+void testNothingRecordedWhenDisabled() {
+    Tracer::clear();
+    Tracer::setEnabled(false);
+    {
+        RIVER_TRACE_SCOPE("disabled");
+    }
+    CHECK(Tracer::numEvents() == 0);
+}
+
+void testRecordsEveryThread() {
+    Tracer::clear();
+    Tracer::setEnabled(true);
+    std::thread other([]() {
+        Tracer::setThreadName("Other");
+        for (int i = 0; i < 10; i++) {
+            RIVER_TRACE_SCOPE("other");
+        }
+    });
+    for (int i = 0; i < 5; i++) {
+        RIVER_TRACE_SCOPE("main");
+    }
+    other.join();
+    Tracer::setEnabled(false);
+    CHECK(Tracer::numEvents() == 15);
+
+    const std::string path = "TraceTest.json";
+    CHECK(Tracer::writeChromeTrace(path));
+    std::string trace = readFile(path);
+    CHECK(trace.find("\"traceEvents\"") != std::string::npos);
+    CHECK(trace.find("\"name\": \"Other\"") != std::string::npos);
+    CHECK(trace.find("\"name\": \"other\", \"ph\": \"X\"") != std::string::npos);
+    CHECK(trace.find("\"name\": \"main\", \"ph\": \"X\"") != std::string::npos);
+    remove(path.c_str());
+
+    // The other thread has exited, so its buffer goes too.
+    Tracer::clear();
+    CHECK(Tracer::numEvents() == 0);
+}
+
+void testRingKeepsNewest() {
+    Tracer::clear();
+    Tracer::setEnabled(true);
+    for (size_t i = 0; i < Tracer::kEventsPerThread + 100; i++) {
+        Tracer::record("event", (int64_t) i, (int64_t) i + 1);
+    }
+    Tracer::setEnabled(false);
+    CHECK(Tracer::numEvents() == Tracer::kEventsPerThread);
+}
+
+void testBadPathFails() {
+    CHECK(!Tracer::writeChromeTrace("no-such-directory/TraceTest.json"));
+}
+
+}  // namespace
+
+int main() {
+    testNothingRecordedWhenDisabled();
+    testRecordsEveryThread();
+    testRingKeepsNewest();
+    testBadPathFails();
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Check.h"
+#include "TtlPayload.h"
+
+#include <cstring>
+
+namespace {
+
+river::StreamSchema eventSchema() {
+    return river::StreamSchema({
+            river::FieldDefinition("trial", river::FieldDefinition::INT32, 4),
+            river::FieldDefinition("position", river::FieldDefinition::DOUBLE, 8),
+            river::FieldDefinition("state", river::FieldDefinition::FIXED_WIDTH_BYTES, 6),
+    });
+}
+
+void testGathersOneValuePerField() {
+    TtlSampleLayout layout;
+    std::vector<TtlMetadataField> metadata = {
+            {TtlMetadataType::UINT32, 1},
+            {TtlMetadataType::DOUBLE, 1},
+            // Any type works for fixed-width bytes, as long as the size matches.
+            {TtlMetadataType::INT16, 3},
+    };
+    CHECK(layout.plan(eventSchema(), metadata) == TtlPayloadStatus::VALID);
+    CHECK(layout.gathersFields());
+    CHECK(layout.samplesPerEvent() == 1);
+    CHECK(layout.eventBytes() == 18);
+
+    int32_t trial = 7;
+    double position = 1.5;
+    int16_t state[3] = {1, -2, 3};
+    const void *values[] = {&trial, &position, state};
+    char sample[18];
+    layout.gather([&values](int i) { return values[i]; }, sample);
+
+    int32_t trial_out;
+    double position_out;
+    int16_t state_out[3];
+    memcpy(&trial_out, sample, 4);
+    memcpy(&position_out, sample + 4, 8);
+    memcpy(state_out, sample + 12, 6);
+    CHECK(trial_out == 7);
+    CHECK(position_out == 1.5);
+    CHECK(state_out[0] == 1 && state_out[1] == -2 && state_out[2] == 3);
+}
+
+void testRejectsMismatchedFields() {
+    TtlSampleLayout layout;
+    int mismatched = 0;
+    // FLOAT where the schema has a DOUBLE.
+    CHECK(layout.plan(eventSchema(),
+                      {{TtlMetadataType::INT32, 1}, {TtlMetadataType::FLOAT, 1}, {TtlMetadataType::UINT8, 6}},
+                      &mismatched) == TtlPayloadStatus::FIELD_MISMATCH);
+    CHECK(mismatched == 1);
+    CHECK(layout.samplesPerEvent() == 0);
+
+    // Same type, wrong number of elements.
+    CHECK(layout.plan(eventSchema(),
+                      {{TtlMetadataType::INT32, 1}, {TtlMetadataType::DOUBLE, 1}, {TtlMetadataType::UINT8, 5}},
+                      &mismatched) == TtlPayloadStatus::FIELD_MISMATCH);
+    CHECK(mismatched == 2);
+
+    CHECK(layout.plan(eventSchema(), {{TtlMetadataType::INT32, 1}, {TtlMetadataType::DOUBLE, 1}})
+          == TtlPayloadStatus::WRONG_METADATA_COUNT);
+    CHECK(layout.plan(eventSchema(), {}) == TtlPayloadStatus::WRONG_METADATA_COUNT);
+
+    river::StreamSchema variable({river::FieldDefinition("blob", river::FieldDefinition::VARIABLE_WIDTH_BYTES, 0)});
+    CHECK(layout.plan(variable, {{TtlMetadataType::UINT8, 8}}, &mismatched) == TtlPayloadStatus::UNSUPPORTED_FIELD);
+    CHECK(mismatched == 0);
+}
+
+void testPackedSamples() {
+    TtlSampleLayout layout;
+    // One binary value holding whole samples, like River Input sends.
+    CHECK(layout.plan(eventSchema(), {{TtlMetadataType::UINT8, 36}}) == TtlPayloadStatus::VALID);
+    CHECK(!layout.gathersFields());
+    CHECK(layout.samplesPerEvent() == 2);
+    CHECK(layout.eventBytes() == 36);
+
+    CHECK(layout.plan(eventSchema(), {{TtlMetadataType::UINT8, 20}}) == TtlPayloadStatus::NOT_MULTIPLE_OF_SAMPLE_SIZE);
+    CHECK(layout.plan(eventSchema(), {{TtlMetadataType::UINT8, 0}}) == TtlPayloadStatus::EMPTY);
+
+    // A schema with one field: a matching value is gathered, anything else has to be packed samples.
+    river::StreamSchema single({river::FieldDefinition("value", river::FieldDefinition::INT64, 8)});
+    CHECK(layout.plan(single, {{TtlMetadataType::INT64, 1}}) == TtlPayloadStatus::VALID);
+    CHECK(layout.gathersFields());
+    CHECK(layout.plan(single, {{TtlMetadataType::UINT8, 16}}) == TtlPayloadStatus::VALID);
+    CHECK(!layout.gathersFields());
+    CHECK(layout.samplesPerEvent() == 2);
+}
+
+}  // namespace
+
+int main() {
+    int64_t num_samples = -1;
+
+    CHECK(validateTtlPayload(1, 64, 16, &num_samples) == TtlPayloadStatus::VALID);
+    CHECK(num_samples == 4);
+
+    CHECK(validateTtlPayload(1, 16, 16, &num_samples) == TtlPayloadStatus::VALID);
+    CHECK(num_samples == 1);
+
+    CHECK(validateTtlPayload(0, 16, 16, &num_samples) == TtlPayloadStatus::WRONG_METADATA_COUNT);
+    CHECK(num_samples == 0);
+    CHECK(validateTtlPayload(2, 16, 16, &num_samples) == TtlPayloadStatus::WRONG_METADATA_COUNT);
+
+    CHECK(validateTtlPayload(1, 0, 16, &num_samples) == TtlPayloadStatus::EMPTY);
+
+    CHECK(validateTtlPayload(1, 24, 16, &num_samples) == TtlPayloadStatus::NOT_MULTIPLE_OF_SAMPLE_SIZE);
+    CHECK(num_samples == 0);
+    // No event schema sample size to divide by.
+    CHECK(validateTtlPayload(1, 16, 0, &num_samples) == TtlPayloadStatus::NOT_MULTIPLE_OF_SAMPLE_SIZE);
+
+    CHECK(describeTtlPayloadStatus(TtlPayloadStatus::EMPTY) != nullptr);
+
+    testGathersOneValuePerField();
+    testRejectsMismatchedFields();
+    testPackedSamples();
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Check.h"
+#include "WriterMetrics.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+void testHistogram() {
+    Log2Histogram histogram;
+    CHECK(histogram.snapshot().percentile(0.5) == 0);
+
+    for (int64_t value = 1; value <= 1000; value++) {
+        histogram.record(value);
+    }
+    histogram.record(0);
+    auto snapshot = histogram.snapshot();
+    CHECK(snapshot.count == 1001);
+    CHECK(snapshot.sum == 500500);
+    CHECK(snapshot.max == 1000);
+    CHECK(snapshot.buckets[0] == 1);
+    // [256, 512) and [512, 1024), capped at the max.
+    CHECK(snapshot.buckets[9] == 256);
+    CHECK(snapshot.buckets[10] == 489);
+
+    // Bounded above, within 2x.
+    int64_t p50 = snapshot.percentile(0.5);
+    CHECK(p50 >= 500 && p50 <= 1000);
+    CHECK(snapshot.percentile(0.99) == 1000);
+    CHECK(snapshot.percentile(0.0) == 0);
+
+    auto merged = snapshot;
+    merged.merge(snapshot);
+    CHECK(merged.count == 2002);
+    CHECK(merged.max == 1000);
+    CHECK(merged.mean() == snapshot.mean());
+}
+
+void testMergeAndRate() {
+    WriterMetrics a;
+    a.queue_depth_high_water = 3;
+    a.queue_capacity = 4;
+    a.bytes_written = 100;
+    WriterMetrics b;
+    b.queue_depth_high_water = 10;
+    b.queue_capacity = 100;
+    b.bytes_written = 50;
+
+    WriterMetrics merged;
+    merged.merge(a);
+    merged.merge(b);
+    CHECK(merged.bytes_written == 150);
+    // 3 / 4 is closer to overflowing than 10 / 100.
+    CHECK(merged.queue_depth_high_water == 3);
+    CHECK(merged.queue_capacity == 4);
+
+    WriterMetrics later = merged;
+    later.taken_at = merged.taken_at + std::chrono::milliseconds(500);
+    later.bytes_written += 1000;
+    CHECK(later.bytesPerSecondSince(merged) == 2000);
+}
+
+void testFilePublisher() {
+    const std::string path = "WriterMetricsTest.json";
+    int64_t bytes_written = 0;
+    MetricsFilePublisher publisher(path, 1000, [&bytes_written]() {
+        WriterMetrics metrics;
+        metrics.taken_at = std::chrono::steady_clock::now();
+        metrics.bytes_written = bytes_written;
+        return metrics;
+    });
+
+    bytes_written = 12345;
+    CHECK(publisher.publish());
+
+    FILE *file = fopen(path.c_str(), "rb");
+    CHECK(file != nullptr);
+    std::vector<char> contents(4096);
+    size_t n = fread(contents.data(), 1, contents.size(), file);
+    fclose(file);
+    remove(path.c_str());
+
+    std::string json(contents.data(), n);
+    CHECK(json.front() == '{');
+    CHECK(json.find("\"bytes_written\": 12345") != std::string::npos);
+    CHECK(json.find("\"flush_latency_us\": {\"count\": 0") != std::string::npos);
+
+    // Failures go to the log, once until a publish works again.
+    std::vector<std::string> logged;
+    MetricsFilePublisher bad_publisher("no-such-directory/WriterMetricsTest.json", 1000, []() {
+        return WriterMetrics();
+    }, [&logged](const std::string &message) { logged.push_back(message); });
+    CHECK(!bad_publisher.publish());
+    CHECK(!bad_publisher.publish());
+    CHECK(logged.size() == 1);
+    CHECK(logged[0].find("no-such-directory") != std::string::npos);
+}
+
+}  // namespace
+
+int main() {
+    testHistogram();
+    testMergeAndRate();
+    testFilePublisher();
+    return 0;
+}
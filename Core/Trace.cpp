@@ -0,0 +1,195 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Tracer::enabled_(false);
+
+namespace {
+
+struct TraceEvent {
+    const char *name;
+    int64_t start_ns;
+    int64_t duration_ns;
+};
+
+/** One thread's ring. Only that thread records; everything else happens under the registry's mutex. */
+struct ThreadBuffer {
+    explicit ThreadBuffer(int tid)
+            : events(new TraceEvent[Tracer::kEventsPerThread]),
+              next(0),
+              name_source(nullptr),
+              tid(tid),
+              exited(false) {
+    }
+
+    std::unique_ptr<TraceEvent[]> events;
+    // Total recorded since the last clear(); the ring holds the last kEventsPerThread of them.
+    std::atomic<uint64_t> next;
+
+    // The pointer passed to setThreadName(), so the name is only copied when it changes.
+    const char *name_source;
+    std::string name;
+    const int tid;
+    std::atomic<bool> exited;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    int next_tid = 1;
+};
+
+Registry& registry() {
+    static Registry registry;
+    return registry;
+}
+
+/** Lets clear() drop a thread's buffer once the thread is gone, while keeping its events until then */
+struct ThreadHandle {
+    ~ThreadHandle() {
+        if (buffer) {
+            buffer->exited.store(true);
+        }
+    }
+
+    std::shared_ptr<ThreadBuffer> buffer;
+};
+
+thread_local ThreadHandle this_thread;
+
+ThreadBuffer& bufferForThisThread() {
+    if (!this_thread.buffer) {
+        auto &r = registry();
+        const std::lock_guard<std::mutex> lock(r.mutex);
+        this_thread.buffer = std::make_shared<ThreadBuffer>(r.next_tid++);
+        r.buffers.push_back(this_thread.buffer);
+    }
+    return *this_thread.buffer;
+}
+
+/** Enough JSON string escaping for thread names */
+std::string escaped(const std::string& s) {
+    std::string out;
+    for (char c: s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        if ((unsigned char) c >= 0x20) {
+            out += c;
+        }
+    }
+    return out;
+}
+
+}  // namespace
+
+void Tracer::setEnabled(bool enabled) {
+    enabled_.store(enabled);
+}
+
+void Tracer::setThreadName(const char *name) {
+    ThreadBuffer &buffer = bufferForThisThread();
+    if (buffer.name_source == name) {
+        return;
+    }
+    const std::lock_guard<std::mutex> lock(registry().mutex);
+    buffer.name_source = name;
+    buffer.name = name;
+}
+
+void Tracer::record(const char *name, int64_t start_ns, int64_t end_ns) {
+    ThreadBuffer &buffer = bufferForThisThread();
+    uint64_t next = buffer.next.load(std::memory_order_relaxed);
+    buffer.events[next % kEventsPerThread] = TraceEvent{name, start_ns, end_ns - start_ns};
+    buffer.next.store(next + 1, std::memory_order_release);
+}
+
+void Tracer::clear() {
+    auto &r = registry();
+    const std::lock_guard<std::mutex> lock(r.mutex);
+    r.buffers.erase(std::remove_if(r.buffers.begin(), r.buffers.end(),
+                                   [](const std::shared_ptr<ThreadBuffer>& buffer) {
+                                       return buffer->exited.load();
+                                   }),
+                    r.buffers.end());
+    for (auto &buffer: r.buffers) {
+        buffer->next.store(0);
+    }
+}
+
+size_t Tracer::numEvents() {
+    auto &r = registry();
+    const std::lock_guard<std::mutex> lock(r.mutex);
+    size_t total = 0;
+    for (const auto &buffer: r.buffers) {
+        total += (size_t) std::min<uint64_t>(buffer->next.load(std::memory_order_acquire), kEventsPerThread);
+    }
+    return total;
+}
+
+bool Tracer::writeChromeTrace(const std::string& path) {
+    auto &r = registry();
+    const std::lock_guard<std::mutex> lock(r.mutex);
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    // Timestamps start from the earliest event held, so the numbers stay readable.
+    int64_t origin_ns = INT64_MAX;
+    for (const auto &buffer: r.buffers) {
+        uint64_t end = buffer->next.load(std::memory_order_acquire);
+        uint64_t begin = end - std::min<uint64_t>(end, kEventsPerThread);
+        for (uint64_t i = begin; i < end; i++) {
+            origin_ns = std::min(origin_ns, buffer->events[i % kEventsPerThread].start_ns);
+        }
+    }
+
+    fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    bool first = true;
+    for (const auto &buffer: r.buffers) {
+        std::string name = buffer->name.empty() ? "Thread " + std::to_string(buffer->tid) : buffer->name;
+        fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                      "\"args\": {\"name\": \"%s\"}}",
+                first ? "" : ",\n", buffer->tid, escaped(name).c_str());
+        first = false;
+
+        uint64_t end = buffer->next.load(std::memory_order_acquire);
+        uint64_t begin = end - std::min<uint64_t>(end, kEventsPerThread);
+        for (uint64_t i = begin; i < end; i++) {
+            const TraceEvent &event = buffer->events[i % kEventsPerThread];
+            fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                    event.name, buffer->tid, (event.start_ns - origin_ns) / 1e3, event.duration_ns / 1e3);
+        }
+    }
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0;
+}
@@ -0,0 +1,131 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __TRACE_H_8C4F1B27__
+#define __TRACE_H_8C4F1B27__
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+
+    Opt-in tracing of the hot paths, exported in the Chrome trace event
+    format (chrome://tracing, or https://ui.perfetto.dev).
+
+    Each thread records into its own fixed-size ring of events, so
+    recording takes no locks and never allocates after a thread's first
+    event; once a ring is full the oldest events are overwritten. When
+    tracing is disabled, a trace scope costs one relaxed atomic load.
+
+    Usage:
+
+        Tracer::clear();
+        Tracer::setEnabled(true);
+        ...
+        {
+            RIVER_TRACE_SCOPE("handleSpike");
+            ...
+        }
+        ...
+        Tracer::setEnabled(false);
+        Tracer::writeChromeTrace("river-output.trace.json");
+
+    Names must be string literals (or otherwise outlive the trace), since
+    only the pointer is recorded.
+
+*/
+class Tracer
+{
+public:
+    static void setEnabled(bool enabled);
+
+    static bool enabled() {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    /** Labels the calling thread in the trace. Only copies name the first time, or if it changed. */
+    static void setThreadName(const char* name);
+
+    /** Records a complete event on the calling thread's ring. Times are steady_clock nanoseconds. */
+    static void record(const char* name, int64_t start_ns, int64_t end_ns);
+
+    /**
+     * Discards every recorded event, and forgets threads that have exited. Call while nothing is recording, e.g.
+     * before acquisition starts.
+     */
+    static void clear();
+
+    /**
+     * Writes every recorded event to path as Chrome trace JSON. Call while nothing is recording, e.g. after
+     * acquisition stops. Returns false if the file can't be written.
+     */
+    static bool writeChromeTrace(const std::string& path);
+
+    /** Number of events currently held, across every thread */
+    static size_t numEvents();
+
+    static int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Events kept per thread.
+    static constexpr size_t kEventsPerThread = 1 << 16;
+
+private:
+    static std::atomic<bool> enabled_;
+};
+
+/** Records the time between its construction and destruction, if tracing was enabled when it was constructed */
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name)
+            : name_(Tracer::enabled() ? name : nullptr),
+              start_ns_(name_ ? Tracer::nowNs() : 0) {
+    }
+
+    ~TraceScope() {
+        if (name_) {
+            Tracer::record(name_, start_ns_, Tracer::nowNs());
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* const name_;
+    const int64_t start_ns_;
+};
+
+#define RIVER_TRACE_CONCAT_INNER(a, b) a##b
+#define RIVER_TRACE_CONCAT(a, b) RIVER_TRACE_CONCAT_INNER(a, b)
+
+/** Traces the rest of the enclosing scope as name */
+#define RIVER_TRACE_SCOPE(name) TraceScope RIVER_TRACE_CONCAT(river_trace_scope_, __LINE__)(name)
+
+#endif  // __TRACE_H_8C4F1B27__
@@ -0,0 +1,174 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "TtlPayload.h"
+
+TtlPayloadStatus validateTtlPayload(int num_metadata_values,
+                                    size_t metadata_size,
+                                    int sample_size,
+                                    int64_t *num_samples) {
+    *num_samples = 0;
+    if (num_metadata_values != 1) {
+        return TtlPayloadStatus::WRONG_METADATA_COUNT;
+    }
+    if (metadata_size == 0) {
+        return TtlPayloadStatus::EMPTY;
+    }
+    if (sample_size <= 0 || metadata_size % (size_t) sample_size != 0) {
+        return TtlPayloadStatus::NOT_MULTIPLE_OF_SAMPLE_SIZE;
+    }
+    *num_samples = (int64_t) (metadata_size / (size_t) sample_size);
+    return TtlPayloadStatus::VALID;
+}
+
+size_t TtlMetadataField::size() const {
+    size_t element_size = 1;
+    switch (type) {
+        case TtlMetadataType::CHAR:
+        case TtlMetadataType::INT8:
+        case TtlMetadataType::UINT8:
+            element_size = 1;
+            break;
+        case TtlMetadataType::INT16:
+        case TtlMetadataType::UINT16:
+            element_size = 2;
+            break;
+        case TtlMetadataType::INT32:
+        case TtlMetadataType::UINT32:
+        case TtlMetadataType::FLOAT:
+            element_size = 4;
+            break;
+        case TtlMetadataType::INT64:
+        case TtlMetadataType::UINT64:
+        case TtlMetadataType::DOUBLE:
+            element_size = 8;
+            break;
+    }
+    return element_size * (size_t) (length > 0 ? length : 0);
+}
+
+namespace {
+
+/** Whether a metadata value can be copied as-is into a field */
+bool matchesField(const TtlMetadataField &value, const river::FieldDefinition &field) {
+    if (value.size() != (size_t) field.size) {
+        return false;
+    }
+    switch (field.type) {
+        case river::FieldDefinition::DOUBLE:
+            return value.type == TtlMetadataType::DOUBLE;
+        case river::FieldDefinition::FLOAT:
+            return value.type == TtlMetadataType::FLOAT;
+        case river::FieldDefinition::INT16:
+            return value.type == TtlMetadataType::INT16 || value.type == TtlMetadataType::UINT16;
+        case river::FieldDefinition::INT32:
+            return value.type == TtlMetadataType::INT32 || value.type == TtlMetadataType::UINT32;
+        case river::FieldDefinition::INT64:
+            return value.type == TtlMetadataType::INT64 || value.type == TtlMetadataType::UINT64;
+        case river::FieldDefinition::FIXED_WIDTH_BYTES:
+            // Raw bytes; only the size has to match.
+            return true;
+        default:
+            return false;
+    }
+}
+
+}  // namespace
+
+TtlPayloadStatus TtlSampleLayout::plan(const river::StreamSchema &schema,
+                                       const std::vector<TtlMetadataField> &metadata,
+                                       int *mismatched_field) {
+    offsets_.clear();
+    sizes_.clear();
+    samples_per_event_ = 0;
+    event_bytes_ = 0;
+    if (mismatched_field) {
+        *mismatched_field = -1;
+    }
+
+    const auto &fields = schema.field_definitions;
+    for (size_t i = 0; i < fields.size(); i++) {
+        if (fields[i].type == river::FieldDefinition::VARIABLE_WIDTH_BYTES) {
+            if (mismatched_field) {
+                *mismatched_field = (int) i;
+            }
+            return TtlPayloadStatus::UNSUPPORTED_FIELD;
+        }
+    }
+
+    if (metadata.size() == fields.size() && !fields.empty()) {
+        int mismatch = -1;
+        for (size_t i = 0; i < fields.size() && mismatch < 0; i++) {
+            if (!matchesField(metadata[i], fields[i])) {
+                mismatch = (int) i;
+            }
+        }
+        if (mismatch < 0) {
+            size_t offset = 0;
+            for (const auto &field: fields) {
+                offsets_.push_back(offset);
+                sizes_.push_back((size_t) field.size);
+                offset += field.size;
+            }
+            samples_per_event_ = 1;
+            event_bytes_ = offset;
+            return TtlPayloadStatus::VALID;
+        }
+        if (metadata.size() != 1) {
+            if (mismatched_field) {
+                *mismatched_field = mismatch;
+            }
+            return TtlPayloadStatus::FIELD_MISMATCH;
+        }
+        // A single value that doesn't match the schema's only field may still be packed samples.
+    } else if (metadata.size() != 1) {
+        return TtlPayloadStatus::WRONG_METADATA_COUNT;
+    }
+
+    int64_t num_samples;
+    TtlPayloadStatus status = validateTtlPayload(1, metadata[0].size(), schema.sample_size(), &num_samples);
+    if (status != TtlPayloadStatus::VALID) {
+        return status;
+    }
+    samples_per_event_ = num_samples;
+    event_bytes_ = metadata[0].size();
+    return TtlPayloadStatus::VALID;
+}
+
+const char *describeTtlPayloadStatus(TtlPayloadStatus status) {
+    switch (status) {
+        case TtlPayloadStatus::VALID:
+            return "valid";
+        case TtlPayloadStatus::WRONG_METADATA_COUNT:
+            return "invalid number of metadata values found";
+        case TtlPayloadStatus::EMPTY:
+            return "metadata was zero sized";
+        case TtlPayloadStatus::NOT_MULTIPLE_OF_SAMPLE_SIZE:
+            return "event metadata size did not evenly divide schema size";
+        case TtlPayloadStatus::FIELD_MISMATCH:
+            return "a metadata value's type or size doesn't match its schema field";
+        case TtlPayloadStatus::UNSUPPORTED_FIELD:
+            return "the event schema has a variable-width field";
+    }
+    return "unknown";
+}
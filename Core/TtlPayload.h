@@ -0,0 +1,127 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __TTLPAYLOAD_H_2F6D93B8__
+#define __TTLPAYLOAD_H_2F6D93B8__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <river/river.h>
+
+/** Why a TTL event's metadata can or can't be written as River samples */
+enum class TtlPayloadStatus {
+    VALID = 0,
+    // Events must carry either one (binary) metadata value, or one per schema field.
+    WRONG_METADATA_COUNT,
+    EMPTY,
+    // The metadata has to hold a whole number of samples.
+    NOT_MULTIPLE_OF_SAMPLE_SIZE,
+    // A metadata value doesn't have its schema field's type or size.
+    FIELD_MISMATCH,
+    // Variable-width fields can't be sent as events.
+    UNSUPPORTED_FIELD,
+};
+
+/** Element type of a TTL event's metadata value; the same as the GUI's MetadataDescriptor::MetadataType */
+enum class TtlMetadataType { CHAR, INT8, UINT8, INT16, UINT16, INT32, UINT32, INT64, UINT64, FLOAT, DOUBLE };
+
+/** One metadata value, as declared by its event channel */
+struct TtlMetadataField {
+    TtlMetadataType type;
+    // Number of elements.
+    int length;
+
+    size_t size() const;
+};
+
+/**
+    Checks a TTL event's metadata against the event schema's sample size. If
+    it's VALID, *num_samples is set to the number of River samples it holds.
+*/
+TtlPayloadStatus validateTtlPayload(int num_metadata_values,
+                                    size_t metadata_size,
+                                    int sample_size,
+                                    int64_t *num_samples);
+
+/** For logging */
+const char *describeTtlPayloadStatus(TtlPayloadStatus status);
+
+/**
+    How events of one TTL event channel become samples of the event schema,
+    worked out once per acquisition so that events don't have to be
+    validated one by one.
+
+    Either the channel has one metadata value per schema field, in schema
+    order and each of its field's type (any type of the same size for
+    fixed-width bytes), which gather() copies into a single sample at the
+    field's offset; or it has one metadata value holding whole samples,
+    packed upstream, which are written as they are.
+*/
+class TtlSampleLayout {
+public:
+    /**
+     * Plans the layout for a channel with the given metadata. If it isn't VALID, the layout is left empty, and
+     * *mismatched_field (if given) is set to the schema field that didn't match, or -1 if none did.
+     */
+    TtlPayloadStatus plan(const river::StreamSchema &schema,
+                          const std::vector<TtlMetadataField> &metadata,
+                          int *mismatched_field = nullptr);
+
+    /** Whether each metadata value is one field, for gather(); otherwise the one value holds whole samples */
+    bool gathersFields() const {
+        return !offsets_.empty();
+    }
+
+    /** Samples each event holds; 1 when gathering fields, 0 if no layout was planned */
+    int64_t samplesPerEvent() const {
+        return samples_per_event_;
+    }
+
+    /** Bytes each event writes */
+    size_t eventBytes() const {
+        return event_bytes_;
+    }
+
+    /**
+     * Copies each metadata value into its field of the sample at dst, which has to have room for eventBytes().
+     * value_at(i) returns a pointer to metadata value i.
+     */
+    template<typename ValueAt>
+    void gather(ValueAt value_at, char *dst) const {
+        for (size_t i = 0; i < offsets_.size(); i++) {
+            memcpy(dst + offsets_[i], value_at((int) i), sizes_[i]);
+        }
+    }
+
+private:
+    // Per field, when gathering.
+    std::vector<size_t> offsets_;
+    std::vector<size_t> sizes_;
+
+    int64_t samples_per_event_ = 0;
+    size_t event_bytes_ = 0;
+};
+
+#endif  // __TTLPAYLOAD_H_2F6D93B8__
@@ -0,0 +1,236 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "WriterMetrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <utility>
+
+double HistogramSnapshot::mean() const {
+    return count > 0 ? (double) sum / count : 0;
+}
+
+int64_t HistogramSnapshot::percentile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    auto rank = (int64_t) (q * (count - 1));
+    int64_t seen = 0;
+    for (int i = 0; i < kNumBuckets; i++) {
+        seen += buckets[i];
+        if (seen > rank) {
+            int64_t upper = i == 0 ? 0 : (int64_t) ((uint64_t(1) << i) - 1);
+            return std::min(upper, max);
+        }
+    }
+    return max;
+}
+
+void HistogramSnapshot::merge(const HistogramSnapshot& other) {
+    for (int i = 0; i < kNumBuckets; i++) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    sum += other.sum;
+    max = std::max(max, other.max);
+}
+
+Log2Histogram::Log2Histogram()
+        : count_(0),
+          sum_(0),
+          max_(0) {
+    for (auto &bucket: buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void Log2Histogram::record(int64_t value) {
+    int bucket = value <= 0 ? 0 : std::min((int) std::bit_width((uint64_t) value),
+                                           HistogramSnapshot::kNumBuckets - 1);
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(std::max<int64_t>(0, value), std::memory_order_relaxed);
+    // Only ever recorded from one thread, so this can't race with another max.
+    if (value > max_.load(std::memory_order_relaxed)) {
+        max_.store(value, std::memory_order_relaxed);
+    }
+}
+
+HistogramSnapshot Log2Histogram::snapshot() const {
+    HistogramSnapshot snapshot;
+    for (int i = 0; i < HistogramSnapshot::kNumBuckets; i++) {
+        snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count = count_.load(std::memory_order_relaxed);
+    snapshot.sum = sum_.load(std::memory_order_relaxed);
+    snapshot.max = max_.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+void WriterMetrics::merge(const WriterMetrics& other) {
+    // The fullest queue is the one that overflows first.
+    if (queue_capacity == 0
+        || other.queue_depth_high_water * queue_capacity > queue_depth_high_water * other.queue_capacity) {
+        queue_depth_high_water = other.queue_depth_high_water;
+        queue_depth = other.queue_depth;
+        queue_capacity = other.queue_capacity;
+    }
+    taken_at = std::max(taken_at, other.taken_at);
+    bytes_written += other.bytes_written;
+    samples_written += other.samples_written;
+    batches_written += other.batches_written;
+    flush_latency_us.merge(other.flush_latency_us);
+    batch_size.merge(other.batch_size);
+    write_duration_us.merge(other.write_duration_us);
+}
+
+double WriterMetrics::bytesPerSecondSince(const WriterMetrics& earlier) const {
+    double seconds = std::chrono::duration<double>(taken_at - earlier.taken_at).count();
+    if (seconds <= 0) {
+        return 0;
+    }
+    return (double) (bytes_written - earlier.bytes_written) / seconds;
+}
+
+namespace {
+
+void appendHistogram(std::string& json, const char *name, const HistogramSnapshot& histogram) {
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+             ", \"%s\": {\"count\": %lld, \"mean\": %.1f, \"p50\": %lld, \"p90\": %lld, \"p99\": %lld, \"max\": %lld}",
+             name,
+             (long long) histogram.count,
+             histogram.mean(),
+             (long long) histogram.percentile(0.5),
+             (long long) histogram.percentile(0.9),
+             (long long) histogram.percentile(0.99),
+             (long long) histogram.max);
+    json += buffer;
+}
+
+}  // namespace
+
+std::string WriterMetrics::toJson(double bytes_per_second) const {
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer),
+             "{\"queue_depth\": %lld, \"queue_depth_high_water\": %lld, \"queue_capacity\": %lld, "
+             "\"bytes_written\": %lld, \"samples_written\": %lld, \"batches_written\": %lld, "
+             "\"bytes_per_second\": %.1f",
+             (long long) queue_depth,
+             (long long) queue_depth_high_water,
+             (long long) queue_capacity,
+             (long long) bytes_written,
+             (long long) samples_written,
+             (long long) batches_written,
+             bytes_per_second);
+    std::string json = buffer;
+    appendHistogram(json, "flush_latency_us", flush_latency_us);
+    appendHistogram(json, "batch_size", batch_size);
+    appendHistogram(json, "write_duration_us", write_duration_us);
+    json += "}\n";
+    return json;
+}
+
+MetricsFilePublisher::MetricsFilePublisher(std::string path, int interval_ms, Collector collect, CoreLogFunction log)
+        : path_(std::move(path)),
+          interval_(std::max(1, interval_ms)),
+          collect_(std::move(collect)),
+          log_(std::move(log)),
+          has_last_(false),
+          failing_(false),
+          should_exit_(false) {
+}
+
+MetricsFilePublisher::~MetricsFilePublisher() {
+    stop();
+}
+
+void MetricsFilePublisher::start() {
+    if (thread_.joinable()) {
+        return;
+    }
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        should_exit_ = false;
+    }
+    thread_ = std::thread([this]() { run(); });
+}
+
+void MetricsFilePublisher::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        should_exit_ = true;
+    }
+    condition_.notify_all();
+    thread_.join();
+    publish();
+}
+
+void MetricsFilePublisher::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!condition_.wait_for(lock, interval_, [this]() { return should_exit_; })) {
+        lock.unlock();
+        publish();
+        lock.lock();
+    }
+}
+
+bool MetricsFilePublisher::publish() {
+    WriterMetrics metrics = collect_();
+    double bytes_per_second = has_last_ ? metrics.bytesPerSecondSince(last_) : 0;
+    last_ = metrics;
+    has_last_ = true;
+
+    std::string json = metrics.toJson(bytes_per_second);
+    std::string tmp_path = path_ + ".tmp";
+    FILE *file = fopen(tmp_path.c_str(), "wb");
+    if (!file) {
+        fail("Couldn't open " + tmp_path + " to write metrics to");
+        return false;
+    }
+    bool ok = fwrite(json.data(), 1, json.size(), file) == json.size();
+    ok = fclose(file) == 0 && ok;
+#if defined(_WIN32)
+    // rename() won't replace an existing file on Windows.
+    remove(path_.c_str());
+#endif
+    if (!ok || rename(tmp_path.c_str(), path_.c_str()) != 0) {
+        fail("Couldn't write metrics to " + path_);
+        remove(tmp_path.c_str());
+        return false;
+    }
+    failing_ = false;
+    return true;
+}
+
+void MetricsFilePublisher::fail(const std::string &message) {
+    if (!failing_ && log_) {
+        log_(message);
+    }
+    failing_ = true;
+}
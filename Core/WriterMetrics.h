@@ -0,0 +1,173 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __WRITERMETRICS_H_5D27A9E4__
+#define __WRITERMETRICS_H_5D27A9E4__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "CoreLog.h"
+
+/** A copy of a Log2Histogram's counts at one point in time */
+struct HistogramSnapshot {
+    static constexpr int kNumBuckets = 48;
+
+    // Bucket 0 counts values <= 0, bucket i > 0 counts values in [2^(i-1), 2^i).
+    std::array<int64_t, kNumBuckets> buckets{};
+    int64_t count = 0;
+    int64_t sum = 0;
+    int64_t max = 0;
+
+    double mean() const;
+
+    /**
+     * Upper bound on the value below which a fraction q of the recorded values fall: the top of the bucket it lands
+     * in (so within 2x), capped at the largest value recorded. 0 if nothing has been recorded.
+     */
+    int64_t percentile(double q) const;
+
+    /** Adds other's counts into these */
+    void merge(const HistogramSnapshot& other);
+};
+
+/**
+
+    Counts of non-negative values in power-of-two buckets, cheap enough to
+    record from the writer thread on every batch: a handful of relaxed atomic
+    adds, no locks. Any thread may take a snapshot(), which may be slightly
+    torn (e.g. count one value ahead of sum) but never goes backwards.
+
+*/
+class Log2Histogram
+{
+public:
+    Log2Histogram();
+
+    void record(int64_t value);
+
+    HistogramSnapshot snapshot() const;
+
+private:
+    std::array<std::atomic<int64_t>, HistogramSnapshot::kNumBuckets> buckets_;
+    std::atomic<int64_t> count_;
+    std::atomic<int64_t> sum_;
+    std::atomic<int64_t> max_;
+};
+
+/** What a RiverWriterQueue (or several, merged) has done so far */
+struct WriterMetrics {
+    // When the snapshot was taken, so that rates can be worked out from two of them.
+    std::chrono::steady_clock::time_point taken_at;
+
+    // In bytes: waiting to be written, the most there have ever been, and the most there can be.
+    int64_t queue_depth = 0;
+    int64_t queue_depth_high_water = 0;
+    int64_t queue_capacity = 0;
+
+    // Written to the sink, including replayed spool batches.
+    int64_t bytes_written = 0;
+    int64_t samples_written = 0;
+    int64_t batches_written = 0;
+
+    // Per batch written straight from the queue: the age of its oldest sample when the write returned (us), its
+    // number of samples, and how long the sink's write() took (us).
+    HistogramSnapshot flush_latency_us;
+    HistogramSnapshot batch_size;
+    HistogramSnapshot write_duration_us;
+
+    /** Sums counts and histograms; keeps the highest high-water mark relative to capacity */
+    void merge(const WriterMetrics& other);
+
+    /** Bytes written per second between earlier and this snapshot */
+    double bytesPerSecondSince(const WriterMetrics& earlier) const;
+
+    /** A single JSON object with every field, plus bytes_per_second and histogram percentiles */
+    std::string toJson(double bytes_per_second) const;
+};
+
+/**
+
+    Every interval, collects WriterMetrics on its own thread and writes them
+    as JSON to a local file, for monitoring to pick up. Each update is
+    written to a temporary file that's then renamed over path, so readers
+    never see half a file.
+
+*/
+class MetricsFilePublisher
+{
+public:
+    using Collector = std::function<WriterMetrics()>;
+
+    /** collect is called from the publishing thread, so must be thread safe; so must log */
+    MetricsFilePublisher(std::string path, int interval_ms, Collector collect, CoreLogFunction log = nullptr);
+
+    /** Stops the thread if it's still running */
+    ~MetricsFilePublisher();
+
+    MetricsFilePublisher(const MetricsFilePublisher&) = delete;
+    MetricsFilePublisher& operator=(const MetricsFilePublisher&) = delete;
+
+    void start();
+
+    /** Publishes one last time, then joins the thread */
+    void stop();
+
+    /** Collects and writes the file now. Returns false (and logs why) if it can't be written. */
+    bool publish();
+
+    const std::string& path() const {
+        return path_;
+    }
+
+private:
+    void run();
+
+    /** Logs message, unless the last publish() failed too */
+    void fail(const std::string& message);
+
+    const std::string path_;
+    const std::chrono::milliseconds interval_;
+    const Collector collect_;
+    const CoreLogFunction log_;
+
+    // Publishing thread only, but publish() may also be called after the thread has stopped.
+    WriterMetrics last_;
+    bool has_last_;
+    // Whether the last publish() failed, so a failure is logged once rather than every interval.
+    bool failing_;
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool should_exit_;
+    std::thread thread_;
+};
+
+#endif  // __WRITERMETRICS_H_5D27A9E4__
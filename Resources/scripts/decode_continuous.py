@@ -0,0 +1,137 @@
+import numpy as np
+import river
+
+# Decodes continuous data that River Output wrote with "compressed" ticked. Each
+# block of continuous data is encoded on its own (see Core/Int16BlockCodec.h for
+# the layout) and split across as many fixed-width samples ("chunks") as it
+# needs, zero-padded to a whole chunk, so every block starts on a chunk with the
+# magic number "RI16". A reader that starts partway through a block (or loses its
+# place) skips chunks until it finds the next one.
+
+BLOCK_MAGIC = 0x36314952
+
+HEADER_DTYPE = np.dtype([
+  ('magic', '<u4'),
+  ('num_bytes', '<u4'),
+  ('num_samples', '<u4'),
+  ('num_channels', '<u4'),
+  ('sample_step', '<i4'),
+  ('first_sample_number', '<i8'),
+])
+
+
+def max_block_bytes(num_channels, num_samples):
+  """Most bytes a block of this size can take, as maxEncodedInt16BlockSize() computes it."""
+  return HEADER_DTYPE.itemsize + num_channels * (3 + (max(num_samples - 1, 0) * 16 + 7) // 8)
+
+
+def decode_block(buf, offset=0):
+  """Decodes the block starting at buf[offset]. Returns (sample_numbers, values, num_bytes),
+  where values is num_samples x num_channels int16, in units of the stream's bit_volts
+  metadata, and num_bytes is the length of the block before padding. Raises ValueError
+  if there's no valid block there."""
+  header = np.frombuffer(buf, dtype=HEADER_DTYPE, count=1, offset=offset)[0]
+  if header['magic'] != BLOCK_MAGIC:
+    raise ValueError('no block at offset %d' % offset)
+  num_samples = int(header['num_samples'])
+  num_channels = int(header['num_channels'])
+  num_deltas = max(num_samples - 1, 0)
+  start = offset + HEADER_DTYPE.itemsize
+  end = offset + int(header['num_bytes'])
+
+  # Check that the channels add up to num_bytes before decoding anything, so that a
+  # false start (the magic number turning up in a block's data) is cheap to reject.
+  pos = start
+  for c in range(num_channels):
+    if end - pos < 3:
+      raise ValueError('malformed block at offset %d' % offset)
+    bit_width = buf[pos + 2]
+    num_packed = (num_deltas * bit_width + 7) // 8
+    if bit_width > 16 or end - pos - 3 < num_packed:
+      raise ValueError('malformed block at offset %d' % offset)
+    pos += 3 + num_packed
+  if pos != end:
+    raise ValueError('malformed block at offset %d' % offset)
+
+  values = np.empty((num_samples, num_channels), dtype=np.int16)
+  pos = start
+  for c in range(num_channels):
+    first = np.frombuffer(buf, dtype='<u2', count=1, offset=pos)
+    bit_width = buf[pos + 2]
+    pos += 3
+
+    num_packed = (num_deltas * bit_width + 7) // 8
+    if bit_width == 0:
+      zigzag = np.zeros(num_deltas, dtype=np.uint16)
+    else:
+      # Least significant bit first, bit_width bits per delta.
+      bits = np.unpackbits(np.frombuffer(buf, dtype=np.uint8, count=num_packed, offset=pos), bitorder='little')
+      bits = bits[:num_deltas * bit_width].reshape(num_deltas, bit_width).astype(np.uint32)
+      zigzag = (bits @ (1 << np.arange(bit_width, dtype=np.uint32))).astype(np.uint16)
+    pos += num_packed
+
+    deltas = (zigzag >> 1) ^ (np.uint16(0) - (zigzag & 1))
+    if num_samples > 0:
+      # Summing in uint16 wraps around just like the encoder's deltas did.
+      values[:, c] = np.cumsum(np.concatenate((first, deltas)), dtype=np.uint16).view(np.int16)
+
+  sample_numbers = header['first_sample_number'] + header['sample_step'] * np.arange(num_samples, dtype=np.int64)
+  return sample_numbers, values, int(header['num_bytes'])
+
+
+def decode_blocks(buf, chunk_bytes):
+  """Decodes every whole block in buf, which holds whole chunks. Chunks that don't start a
+  valid block (e.g. the tail of a block whose start wasn't read) are skipped. Returns the
+  decoded (sample_numbers, values) pairs, the number of bytes used up, padding and skipped
+  chunks included, and the number of chunks skipped."""
+  blocks = []
+  offset = 0
+  skipped = 0
+  while len(buf) - offset >= HEADER_DTYPE.itemsize:
+    header = np.frombuffer(buf, dtype=HEADER_DTYPE, count=1, offset=offset)[0]
+    num_bytes = int(header['num_bytes'])
+    if (header['magic'] != BLOCK_MAGIC or num_bytes < HEADER_DTYPE.itemsize
+        or num_bytes > max_block_bytes(int(header['num_channels']), int(header['num_samples']))):
+      offset += chunk_bytes
+      skipped += 1
+      continue
+    padded = -(-num_bytes // chunk_bytes) * chunk_bytes
+    if len(buf) - offset < padded:
+      # The rest of this block hasn't been read yet.
+      break
+    try:
+      sample_numbers, values, _ = decode_block(buf, offset)
+    except ValueError:
+      # The magic number turned up inside a block's data; keep looking.
+      offset += chunk_bytes
+      skipped += 1
+      continue
+    blocks.append((sample_numbers, values))
+    offset += padded
+  return blocks, offset, skipped
+
+
+r = river.StreamReader(river.RedisConnection("127.0.0.1", 6379))
+r.initialize("Purple-407", 10000)
+
+# Each River sample is one chunk; reading many at once is much faster than one at a time.
+data = r.new_buffer(1024)
+chunk_bytes = data.itemsize
+pending = b''
+
+with r:
+  while True:
+    num_read = r.read(data, 100)
+    if num_read > 0:
+      pending += data[:num_read].tobytes()
+      blocks, consumed, skipped = decode_blocks(pending, chunk_bytes)
+      pending = pending[consumed:]
+      if skipped > 0:
+        print(f"Skipped {skipped} chunks to find the start of a block")
+      for sample_numbers, values in blocks:
+        print(f"{values.shape[0]} samples x {values.shape[1]} channels from sample {sample_numbers[0]}")
+    elif num_read == 0:
+      continue
+    else:
+      print('EOF encountered for stream', r.stream_name)
+      break
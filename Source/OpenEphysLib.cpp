@@ -26,6 +26,7 @@
 #include <PluginInfo.h>
 
 #include "RiverOutput.h"
+#include "RiverInput.h"
 
 #include <string>
 
@@ -38,7 +39,7 @@
 
 using namespace Plugin;
 //Number of plugins defined on the library. Can be of different types (Processors, RecordEngines, etc...)
-#define NUM_PLUGINS 1
+#define NUM_PLUGINS 2
 
 extern "C" EXPORT void getLibInfo(Plugin::LibraryInfo* info)
 {
@@ -66,6 +67,15 @@ extern "C" EXPORT int getPluginInfo(int index, Plugin::PluginInfo* info)
             info->processor.type = Plugin::Processor::SINK; //Type of processor. Can be FilterProcessor, SourceProcessor, SinkProcessor or UtilityProcessor. Specifies where on the processor list will appear
             info->processor.creator = &(Plugin::createProcessor<RiverOutput>); //Class factory pointer. Replace "ExampleProcessor" with the name of your class.
             break;
+        case 1:
+            info->type = Plugin::Type::PROCESSOR;
+            info->processor.name = "River Input";
+            // A filter rather than a source: its events are stamped with the sample numbers of an upstream
+            // datastream, so they line up with the data they were computed from. A source would have no upstream
+            // datastreams, and would have to make up a sample clock of its own.
+            info->processor.type = Plugin::Processor::FILTER;
+            info->processor.creator = &(Plugin::createProcessor<RiverInput>);
+            break;
             
         default:
             return -1;
@@ -0,0 +1,347 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "RiverInput.h"
+#include "RiverInputEditor.h"
+
+RiverInput::RiverInput()
+        : GenericProcessor("River Input"),
+          sample_size_(0),
+          event_channel_(nullptr),
+          line_(0),
+          sample_value_(nullptr),
+          last_samples_read_(0) {
+    addStringParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "stream_name",
+            "River stream name",
+            "",
+            true);
+    addStringParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "redis_connection_hostname",
+            "Hostname, Redis connection",
+            "127.0.0.1",
+            true);
+    addStringParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "redis_connection_password",
+            "Password, Redis connection",
+            "",
+            true);
+    addIntParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "redis_connection_port",
+            "Hostname, Redis port",
+            6379,
+            0,
+            65535,
+            true);
+    addIntParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "max_batch_size",
+            "Max number of samples read from River at once",
+            1024,
+            1,
+            1 << 20,
+            true);
+    addIntParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "ttl_line",
+            "TTL line the events are sent on",
+            0,
+            0,
+            255,
+            true);
+    addIntParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "datastream_id",
+            "ID of the datastream to send events on",
+            0,
+            0,
+            (std::numeric_limits<int32_t>::max)(),
+            true);
+}
+
+RiverInput::~RiverInput()
+{
+    if (reading_thread_) {
+        reading_thread_->stopThread(1000 + RiverReaderThread::kReadTimeoutMs);
+    }
+    if (reader_) {
+        reader_->Stop();
+    }
+}
+
+river::RedisConnection RiverInput::connection(int timeout_seconds) {
+    return river::RedisConnection(
+            redisConnectionHostname(),
+            redisConnectionPort(),
+            redisConnectionPassword(),
+            timeout_seconds);
+}
+
+int RiverInput::readSampleSize() {
+    if (streamName().empty()) {
+        return 0;
+    }
+
+    try {
+        river::StreamReader reader(connection(5));
+        // Only wait briefly; the stream should already exist when the signal chain is built.
+        reader.Initialize(streamName(), 1000);
+        int sample_size = reader.schema().sample_size();
+        reader.Stop();
+        return sample_size;
+    } catch (const std::exception& e) {
+        LOGC("Failed to read River stream ", streamName(), ": ", e.what());
+        return 0;
+    }
+}
+
+/** Called when a processor needs to update its settings */
+void RiverInput::updateSettings()
+{
+    event_channel_ = nullptr;
+    sample_size_ = readSampleSize();
+
+    const DataStream *stream = nullptr;
+    for (const auto *item: getDataStreams()) {
+        if (stream == nullptr || item->getStreamId() == datastream_id()) {
+            stream = item;
+        }
+    }
+
+    isEnabled = sample_size_ > 0 && stream != nullptr;
+    if (!isEnabled) {
+        CoreServices::sendStatusMessage("River Input couldn't read stream " + String(streamName()));
+        return;
+    }
+
+    EventChannel::Settings settings{
+            EventChannel::Type::TTL,
+            "River Input",
+            "Samples read from the River stream " + String(streamName()),
+            "riverinput.sample",
+            getDataStream(stream->getStreamId())
+    };
+    eventChannels.add(new EventChannel(settings));
+    event_channel_ = eventChannels.getLast();
+    event_channel_->addProcessor(processorInfo.get());
+
+    // One raw River sample per event, same as what RiverOutput expects of its events.
+    MetadataDescriptor sample_descriptor(
+            MetadataDescriptor::MetadataType::UINT8,
+            sample_size_,
+            "River sample",
+            "Raw bytes of one sample, laid out according to the stream's schema",
+            "riverinput.sample.bytes");
+    event_channel_->addEventMetadata(sample_descriptor);
+}
+
+AudioProcessorEditor *RiverInput::createEditor() {
+    editor = std::make_unique<RiverInputEditor>(this);
+    return editor.get();
+}
+
+bool RiverInput::startAcquisition()
+{
+    if (!event_channel_) {
+        return false;
+    }
+
+    if (reading_thread_) {
+        // Should've been stopped in stopAcquisition().
+        jassertfalse;
+        reading_thread_->stopThread(1000 + RiverReaderThread::kReadTimeoutMs);
+        reading_thread_.reset();
+    }
+
+    try {
+        reader_ = std::make_unique<river::StreamReader>(connection(5));
+        reader_->Initialize(streamName(), 1000);
+    } catch (const std::exception& e) {
+        LOGC("Failed to open River stream ", streamName(), ": ", e.what());
+        CoreServices::sendStatusMessage("River Input failed to open stream.");
+        reader_.reset();
+        return false;
+    }
+
+    if (reader_->schema().sample_size() != sample_size_) {
+        // The stream was recreated with a different schema since the signal chain was built.
+        CoreServices::sendStatusMessage("River Input stream schema changed; update the signal chain.");
+        reader_->Stop();
+        reader_.reset();
+        return false;
+    }
+
+    line_ = (uint8) ttlLine();
+    // Every event copies its metadata when it's created, so one value is reused for every sample.
+    sample_metadata_ = std::make_unique<MetadataValueArray>();
+    sample_value_ = new MetadataValue(*event_channel_->getEventMetadataDescriptor(0));
+    sample_metadata_->add(sample_value_);
+    last_samples_read_ = 0;
+    reading_thread_ = std::make_unique<RiverReaderThread>(reader_.get(), sample_size_, maxBatchSize(), kNumSlabs);
+    reading_thread_->startThread();
+    LOGC("Reading from River stream ", streamName());
+    return true;
+}
+
+bool RiverInput::stopAcquisition()
+{
+    if (reading_thread_) {
+        reading_thread_->stopThread(1000 + RiverReaderThread::kReadTimeoutMs);
+        last_samples_read_ = reading_thread_->samplesRead();
+        reading_thread_.reset();
+    }
+    if (reader_) {
+        reader_->Stop();
+        reader_.reset();
+    }
+    sample_value_ = nullptr;
+    sample_metadata_.reset();
+    return true;
+}
+
+void RiverInput::process(AudioSampleBuffer &buffer)
+{
+    if (!reading_thread_ || !event_channel_) {
+        return;
+    }
+
+    const int64 sample_number = getFirstSampleNumberForBlock(event_channel_->getStreamId());
+
+    PayloadSlab *slab;
+    while ((slab = reading_thread_->tryTakeBatch()) != nullptr) {
+        const char *sample = slab->data;
+        for (int64_t i = 0; i < slab->num_samples; i++, sample += sample_size_) {
+            sample_value_->setValue(reinterpret_cast<const uint8 *>(sample));
+            // One-shot: the event marks that a sample arrived, so there's no matching OFF event (which would carry
+            // the sample again, and be published twice by a River Output downstream).
+            TTLEventPtr event = TTLEvent::createTTLEvent(event_channel_, sample_number, line_, true,
+                                                         *sample_metadata_);
+            addEvent(event, 0);
+        }
+        reading_thread_->recycle(slab);
+    }
+}
+
+int64_t RiverInput::samplesRead() const {
+    if (reading_thread_) {
+        return reading_thread_->samplesRead();
+    }
+    return last_samples_read_;
+}
+
+/** Called when a parameter is updated*/
+void RiverInput::parameterValueChanged(Parameter* param) {
+    if (!editor) {
+        return;
+    }
+    if (MessageManager::getInstance()->isThisTheMessageThread()) {
+        ((RiverInputEditor *) editor.get())->refreshLabelsFromProcessor();
+        return;
+    }
+
+    // As in RiverOutput: don't make another thread wait on the message thread. process() only reads what was
+    // snapshotted when acquisition started.
+    Component::SafePointer<RiverInputEditor> safe_editor((RiverInputEditor *) editor.get());
+    MessageManager::callAsync([safe_editor]() {
+        if (auto *e = safe_editor.getComponent()) {
+            e->refreshLabelsFromProcessor();
+        }
+    });
+}
+
+RiverReaderThread::RiverReaderThread(river::StreamReader *reader, int sample_size, int max_batch_size, int num_slabs)
+        : juce::Thread("RiverReader"),
+          filled_slabs_(num_slabs),
+          free_slabs_(num_slabs),
+          sample_size_(sample_size),
+          max_batch_size_(max_batch_size),
+          samples_read_(0),
+          end_of_stream_(false),
+          reader_(reader) {
+    slabs_.reserve(num_slabs);
+    for (int i = 0; i < num_slabs; i++) {
+        slabs_.push_back(std::make_unique<PayloadSlab>((size_t) sample_size * max_batch_size));
+        free_slabs_.tryPush(slabs_.back().get());
+    }
+}
+
+void RiverReaderThread::run() {
+    // Held across empty reads; only the processing thread pushes to free_slabs_.
+    PayloadSlab *slab = nullptr;
+    while (!threadShouldExit()) {
+        if (!slab && !free_slabs_.tryPop(slab)) {
+            // The processing thread is behind; let the samples wait in Redis instead.
+            wait(1);
+            continue;
+        }
+
+        int64_t n;
+        try {
+            n = reader_->Read(slab->data, max_batch_size_, kReadTimeoutMs);
+        } catch (const std::exception& e) {
+            LOGC("Failed to read from River: ", e.what());
+            n = -1;
+        }
+
+        if (n < 0) {
+            end_of_stream_ = true;
+            break;
+        }
+        if (n == 0) {
+            continue;
+        }
+
+        slab->num_samples = n;
+        slab->num_bytes = (size_t) n * sample_size_;
+        samples_read_.fetch_add(n, std::memory_order_relaxed);
+        // Can't fail: the ring has room for every slab.
+        filled_slabs_.tryPush(slab);
+        slab = nullptr;
+    }
+}
+
+PayloadSlab *RiverReaderThread::tryTakeBatch() {
+    PayloadSlab *slab;
+    if (filled_slabs_.tryPop(slab)) {
+        return slab;
+    }
+    return nullptr;
+}
+
+void RiverReaderThread::recycle(PayloadSlab *slab) {
+    slab->num_bytes = 0;
+    slab->num_samples = 0;
+    free_slabs_.tryPush(slab);
+}
+
+int64_t RiverReaderThread::samplesRead() const {
+    return samples_read_.load(std::memory_order_relaxed);
+}
+
+bool RiverReaderThread::reachedEndOfStream() const {
+    return end_of_stream_.load();
+}
@@ -0,0 +1,213 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __RIVERINPUT_H_6B0E93A1__
+#define __RIVERINPUT_H_6B0E93A1__
+
+#include <ProcessorHeaders.h>
+#include <river/river.h>
+#include "RiverWriterQueue.h"
+#include "SpscRingBuffer.h"
+
+/**
+
+    Reads a River stream on its own thread, one batch of up to
+    max_batch_size samples per River read, and hands each batch to the
+    processing thread as a PayloadSlab.
+
+    Every slab is allocated up front. If the processing thread falls behind
+    and no slab is free, the thread stops reading until one is recycled;
+    nothing is dropped, since the stream itself buffers in Redis.
+
+*/
+class RiverReaderThread : public Thread
+{
+public:
+
+    /** Constructor */
+    RiverReaderThread(river::StreamReader *reader, int sample_size, int max_batch_size, int num_slabs);
+
+    /** Destructor */
+    ~RiverReaderThread() override = default;
+
+    /** Run thread. Reads until the thread is asked to stop or the stream ends. */
+    void run() override;
+
+    /** Next batch read from River, or nullptr if none is waiting. Processing thread only. */
+    PayloadSlab* tryTakeBatch();
+
+    /** Returns a batch from tryTakeBatch() once its samples have been handled. Processing thread only. */
+    void recycle(PayloadSlab* slab);
+
+    /** Number of samples read from River so far */
+    int64_t samplesRead() const;
+
+    /** Whether the writer has stopped the stream */
+    bool reachedEndOfStream() const;
+
+    // How long each River read waits for new samples, which bounds how long stopping the thread takes.
+    static constexpr int kReadTimeoutMs = 50;
+
+private:
+    // Batches read from River (reader -> processing thread) and batches ready to be reused (processing thread ->
+    // reader).
+    SpscRingBuffer<PayloadSlab*> filled_slabs_;
+    SpscRingBuffer<PayloadSlab*> free_slabs_;
+    std::vector<std::unique_ptr<PayloadSlab>> slabs_;
+
+    const int sample_size_;
+    const int max_batch_size_;
+
+    std::atomic<int64_t> samples_read_;
+    std::atomic<bool> end_of_stream_;
+
+    river::StreamReader* reader_;
+};
+
+/**
+ *  A filter that reads a River stream and injects each sample into the
+ *  signal chain as a TTL event, whose single binary metadata value holds
+ *  the raw sample (the same shape RiverOutput consumes). Events are
+ *  one-shot: each is an ON event on ttlLine(), never followed by an OFF,
+ *  so the line's state carries no meaning; count events instead.
+ *
+ *  The stream must exist when the signal chain is updated, since its
+ *  schema decides the size of the event metadata.
+ *
+    @see GenericProcessor
+ */
+class RiverInput : public GenericProcessor
+{
+public:
+    /** Constructor */
+    RiverInput();
+
+    /** Destructor */
+    ~RiverInput() override;
+
+    /** Reads the stream's schema and adds the event channel that samples are sent on */
+    void updateSettings() override;
+
+    /** Emits every sample read since the last block as a TTL event at the start of this block. */
+    void process(AudioSampleBuffer &buffer) override;
+
+    /** Called immediately prior to the start of data acquisition. */
+    bool startAcquisition() override;
+
+    /** Called immediately after the end of data acquisition. */
+    bool stopAcquisition() override;
+
+    /** Creates the RiverInputEditor. */
+    AudioProcessorEditor *createEditor() override;
+
+    /** Called when a parameter is updated*/
+    void parameterValueChanged(Parameter* param) override;
+
+    //
+    // Non-override methods:
+    //
+    std::string streamName() {
+        return getParameter("stream_name")->getValueAsString().toStdString();
+    }
+
+    void setStreamName(const std::string &streamName) {
+        getParameter("stream_name")->setNextValue(juce::String(streamName));
+    }
+
+    std::string redisConnectionHostname() {
+        return getParameter("redis_connection_hostname")->getValueAsString().toStdString();
+    }
+
+    void setRedisConnectionHostname(const std::string &hostname) {
+        getParameter("redis_connection_hostname")->setNextValue(juce::String(hostname));
+    }
+
+    int redisConnectionPort() {
+        return getParameter("redis_connection_port")->getValue();
+    }
+
+    void setRedisConnectionPort(int port) {
+        getParameter("redis_connection_port")->setNextValue(port);
+    }
+
+    std::string redisConnectionPassword() {
+        return getParameter("redis_connection_password")->getValueAsString().toStdString();
+    }
+
+    void setRedisConnectionPassword(const std::string &password) {
+        getParameter("redis_connection_password")->setNextValue(juce::String(password));
+    }
+
+    /** Max number of samples brought in by a single River read */
+    int maxBatchSize() {
+        return getParameter("max_batch_size")->getValue();
+    }
+
+    /** TTL line the events are sent on */
+    int ttlLine() {
+        return getParameter("ttl_line")->getValue();
+    }
+
+    int datastream_id() {
+        return getParameter("datastream_id")->getValue();
+    }
+
+    /** Number of samples read from River during this (or the last) acquisition */
+    int64_t samplesRead() const;
+
+    /** Sample size of the stream, as of the last updateSettings(); 0 if it couldn't be read */
+    int sampleSize() const {
+        return sample_size_;
+    }
+
+    // Number of batches that can be waiting for the processing thread at once.
+    static constexpr int kNumSlabs = 64;
+
+private:
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RiverInput)
+
+    river::RedisConnection connection(int timeout_seconds);
+
+    /** Looks up the stream's sample size. Returns 0 if the stream can't be read. */
+    int readSampleSize();
+
+    int sample_size_;
+
+    // Created in updateSettings().
+    EventChannel* event_channel_;
+
+    // ttlLine() as of startAcquisition(), so process() doesn't read parameters.
+    uint8 line_;
+
+    // The metadata of every event, reused by process(); sample_value_ is owned by sample_metadata_.
+    std::unique_ptr<MetadataValueArray> sample_metadata_;
+    MetadataValue* sample_value_;
+
+    std::unique_ptr<river::StreamReader> reader_;
+    std::unique_ptr<RiverReaderThread> reading_thread_;
+
+    // Kept after the reading thread is gone.
+    int64_t last_samples_read_;
+};
+
+#endif  // __RIVERINPUT_H_6B0E93A1__
@@ -0,0 +1,105 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "RiverInputEditor.h"
+#include "RiverOutputEditor.h"
+
+RiverInputEditor::RiverInputEditor(GenericProcessor *parentNode)
+        : GenericEditor(parentNode, "River Input") {
+    desiredWidth = 220;
+
+    hostnameLabel = RiverOutputEditor::newStaticLabel("Hostname", 10, 25, 80, 20, this);
+    hostnameLabelValue = RiverOutputEditor::newInputLabel(
+            "hostnameLabelValue", "Set the hostname for River", 15, 42, 80, 18, this);
+    hostnameLabelValue->addListener(this);
+
+    portLabel = RiverOutputEditor::newStaticLabel("Port", 10, 65, 80, 20, this);
+    portLabelValue = RiverOutputEditor::newInputLabel(
+            "hostnamePortValue", "Set the port for River", 15, 82, 60, 18, this);
+    portLabelValue->addListener(this);
+
+    passwordLabel = RiverOutputEditor::newStaticLabel("Password", 105, 25, 100, 20, this);
+    passwordLabelValue = RiverOutputEditor::newInputLabel(
+            "hostnamePasswordValue", "Set the password for River", 110, 42, 100, 18, this);
+    passwordLabelValue->addListener(this);
+
+    streamNameLabel = RiverOutputEditor::newStaticLabel("Stream Name", 105, 65, 100, 20, this);
+    streamNameLabelValue = RiverOutputEditor::newInputLabel(
+            "streamNameLabelValue", "River stream to read from; must already exist", 110, 82, 100, 18, this);
+    streamNameLabelValue->addListener(this);
+
+    samplesReadLabel = RiverOutputEditor::newStaticLabel("Samples Read", 10, 105, 80, 20, this);
+    samplesReadLabelValue = RiverOutputEditor::newStaticLabel("0", 15, 120, 80, 18, this);
+
+    connectButton = new UtilityButton("Connect", titleFont);
+    connectButton->setBounds(110, 108, 100, 20);
+    connectButton->addListener(this);
+    addAndMakeVisible(connectButton);
+
+    refreshLabelsFromProcessor();
+
+    // Just updating the # of samples read, so can update pretty slow
+    startTimer(250);
+}
+
+void RiverInputEditor::buttonClicked(Button *button) {
+    if (button == connectButton) {
+        // Re-reads the stream's schema and rebuilds the event channel.
+        CoreServices::updateSignalChain(this);
+    }
+}
+
+void RiverInputEditor::labelTextChanged(Label *label) {
+    auto river = (RiverInput *) getProcessor();
+    if (label == hostnameLabelValue) {
+        river->setRedisConnectionHostname(label->getText().toStdString());
+    } else if (label == portLabelValue) {
+        int port = label->getText().getIntValue();
+        if (port > 0) {
+            river->setRedisConnectionPort(port);
+            lastPortValue = label->getText().toStdString();
+        } else {
+            label->setText(juce::String(lastPortValue), dontSendNotification);
+        }
+    } else if (label == passwordLabelValue) {
+        river->setRedisConnectionPassword(label->getText().toStdString());
+    } else if (label == streamNameLabelValue) {
+        river->setStreamName(label->getText().toStdString());
+    }
+}
+
+void RiverInputEditor::timerCallback() {
+    auto river = (RiverInput *) getProcessor();
+    samplesReadLabelValue->setText(juce::String(river->samplesRead()), dontSendNotification);
+}
+
+void RiverInputEditor::refreshLabelsFromProcessor() {
+    auto river = (RiverInput *) getProcessor();
+    lastPortValue = std::to_string(river->redisConnectionPort());
+
+    hostnameLabelValue->setText(river->redisConnectionHostname(), dontSendNotification);
+    portLabelValue->setText(lastPortValue, dontSendNotification);
+    passwordLabelValue->setText(river->redisConnectionPassword(), dontSendNotification);
+    streamNameLabelValue->setText(river->streamName(), dontSendNotification);
+    samplesReadLabelValue->setText(juce::String(river->samplesRead()), dontSendNotification);
+}
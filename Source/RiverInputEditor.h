@@ -0,0 +1,81 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __RIVERINPUTEDITOR_H_0D5C7A42__
+#define __RIVERINPUTEDITOR_H_0D5C7A42__
+
+#include <EditorHeaders.h>
+#include "RiverInput.h"
+
+/**
+
+  User interface for the RiverInput processor.
+
+  @see RiverInput
+*/
+class RiverInputEditor : public GenericEditor,
+                         public Label::Listener,
+                         public Button::Listener,
+                         public Timer
+{
+public:
+
+    /** Constructor*/
+    explicit RiverInputEditor(GenericProcessor *parentNode);
+
+    /** Destructor */
+    ~RiverInputEditor() override = default;
+
+    /** UI listeners */
+    void labelTextChanged(Label* label) override;
+    void buttonClicked(Button* button) override;
+
+    /** Updates the number of samples read */
+    void timerCallback() override;
+
+    /** Non-overrides */
+    void refreshLabelsFromProcessor();
+
+private:
+    ScopedPointer<Label> hostnameLabel;
+    ScopedPointer<Label> hostnameLabelValue;
+
+    ScopedPointer<Label> portLabel;
+    ScopedPointer<Label> portLabelValue;
+    std::string lastPortValue;
+
+    ScopedPointer<Label> passwordLabel;
+    ScopedPointer<Label> passwordLabelValue;
+
+    ScopedPointer<Label> streamNameLabel;
+    ScopedPointer<Label> streamNameLabelValue;
+
+    ScopedPointer<Label> samplesReadLabel;
+    ScopedPointer<Label> samplesReadLabelValue;
+
+    ScopedPointer<UtilityButton> connectButton;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RiverInputEditor)
+};
+
+#endif  // __RIVERINPUTEDITOR_H_0D5C7A42__
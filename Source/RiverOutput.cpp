@@ -23,17 +23,73 @@
 
 #include "RiverOutput.h"
 #include "RiverOutputEditor.h"
+#include <algorithm>
 #include <memory>
+#include <new>
 #include <unordered_map>
 #include <chrono>
-#include <thread>
+#include <cmath>
+
+namespace {
+
+/** Grows buffer to at least size, counting it in num_allocations if that takes new memory */
+template<typename T>
+void growBuffer(std::vector<T>& buffer, size_t size, std::atomic<int64_t>& num_allocations) {
+    if (buffer.size() >= size) {
+        return;
+    }
+    if (size > buffer.capacity()) {
+        num_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    buffer.resize(size);
+}
+
+/** Folds one stream's connection stats into stats, as described at RiverOutput::connectionStats() */
+void addConnectionStats(ConnectionStats& stats, const ConnectionStats& stream_stats) {
+    stats.connected = stats.connected && stream_stats.connected;
+    stats.reconnect_attempts += stream_stats.reconnect_attempts;
+    stats.reconnects += stream_stats.reconnects;
+    stats.current_outage_s = std::max(stats.current_outage_s, stream_stats.current_outage_s);
+    stats.total_outage_s = std::max(stats.total_outage_s, stream_stats.total_outage_s);
+    stats.longest_outage_s = std::max(stats.longest_outage_s, stream_stats.longest_outage_s);
+}
+
+TtlMetadataField ttlMetadataField(const MetadataDescriptor& descriptor) {
+    TtlMetadataType type = TtlMetadataType::UINT8;
+    switch (descriptor.getType()) {
+        case MetadataDescriptor::MetadataType::CHAR: type = TtlMetadataType::CHAR; break;
+        case MetadataDescriptor::MetadataType::INT8: type = TtlMetadataType::INT8; break;
+        case MetadataDescriptor::MetadataType::UINT8: type = TtlMetadataType::UINT8; break;
+        case MetadataDescriptor::MetadataType::INT16: type = TtlMetadataType::INT16; break;
+        case MetadataDescriptor::MetadataType::UINT16: type = TtlMetadataType::UINT16; break;
+        case MetadataDescriptor::MetadataType::INT32: type = TtlMetadataType::INT32; break;
+        case MetadataDescriptor::MetadataType::UINT32: type = TtlMetadataType::UINT32; break;
+        case MetadataDescriptor::MetadataType::INT64: type = TtlMetadataType::INT64; break;
+        case MetadataDescriptor::MetadataType::UINT64: type = TtlMetadataType::UINT64; break;
+        case MetadataDescriptor::MetadataType::FLOAT: type = TtlMetadataType::FLOAT; break;
+        case MetadataDescriptor::MetadataType::DOUBLE: type = TtlMetadataType::DOUBLE; break;
+    }
+    return TtlMetadataField{type, (int) descriptor.getLength()};
+}
+
+}  // namespace
 
 RiverOutput::RiverOutput()
         : GenericProcessor("River Output"),
-          spike_schema_({river::FieldDefinition("channel_index", river::FieldDefinition::INT32, 4),
-                         river::FieldDefinition("unit_index", river::FieldDefinition::INT32, 4),
-                         river::FieldDefinition("sample_number", river::FieldDefinition::INT64, 8)
-                        }) {
+          spike_schema_(riverSpikeFields()),
+          include_spike_waveform_(false),
+          spike_waveform_as_int16_(false),
+          spike_waveform_num_electrodes_(0),
+          spike_waveform_num_samples_(0),
+          spike_waveform_bit_volts_(1.0f),
+          spike_waveform_scale_(1.0f),
+          spike_bin_ms_(0),
+          spike_bin_units_(4),
+          consume_continuous_(false),
+          continuous_as_int16_(false),
+          continuous_compressed_(false),
+          continuous_schema_(std::vector<river::FieldDefinition>()),
+          config_(nullptr) {
     addStringParameter(
             Parameter::ParameterScope::GLOBAL_SCOPE,
             "stream_name",
@@ -68,6 +124,52 @@ RiverOutput::RiverOutput()
             0,
             1000,
             true);
+    addIntParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "max_batch_size",
+            "Max number of samples sent to River in a single write",
+            4096,
+            1,
+            1 << 20,
+            true);
+    addIntParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "queue_capacity",
+            "Max amount of data waiting to be written to River, for each stream",
+            kDefaultQueueCapacityBytes,
+            1,
+            (std::numeric_limits<int32_t>::max)(),
+            true);
+    addCategoricalParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "queue_capacity_unit",
+            "Unit of the queue capacity",
+            {"samples", "bytes"},
+            1,
+            true);
+    addCategoricalParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "overflow_policy",
+            "What to do with new data when the queue is full",
+            {"Drop newest", "Drop oldest", "Block"},
+            0,
+            true);
+    addIntParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "overflow_block_timeout_ms",
+            "Max time to wait for room in the queue before dropping data (in ms)",
+            10,
+            0,
+            10000,
+            true);
+    addIntParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "decimation_factor",
+            "Factor to downsample continuous data by before sending it to River",
+            1,
+            1,
+            256,
+            true);
     addIntParameter(
             Parameter::ParameterScope::GLOBAL_SCOPE,
             "datastream_id",
@@ -76,13 +178,55 @@ RiverOutput::RiverOutput()
             0,
             (std::numeric_limits<int32_t>::max)(),
             true);
+    addBooleanParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "publish_all_streams",
+            "Publish every datastream to its own River stream",
+            false,
+            true);
+    addStringParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "stream_name_template",
+            "River stream name per datastream, when publishing all streams",
+            "{stream_name}-{oe_stream}",
+            true);
+    addStringParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "spool_directory",
+            "Directory to spool to while River is unreachable; empty to drop instead",
+            "",
+            true);
+    addStringParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "metrics_file",
+            "JSON file the writer metrics are published to while acquiring; empty to disable",
+            "",
+            true);
+    addStringParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "trace_file",
+            "Chrome trace JSON file written when acquisition stops; empty to disable tracing",
+            "",
+            true);
+    addBooleanParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "publish_clock",
+            "Publish a <stream>.clock stream mapping sample numbers to host time",
+            false,
+            true);
+    addIntParameter(
+            Parameter::ParameterScope::GLOBAL_SCOPE,
+            "clock_interval_ms",
+            "Min time between clock samples; 0 sends one every block",
+            0,
+            0,
+            3600000,
+            true);
 }
 
 RiverOutput::~RiverOutput()
 {
-    if (writer_) {
-        writer_->Stop();
-    }
+    clearOutputs();
 }
 
 bool RiverOutput::testConnection()
@@ -135,10 +279,273 @@ void RiverOutput::updateSettings()
     setDatastreamId(combobox_id);
     ((RiverOutputEditor *) editor.get())->refreshDatastreams(getDataStreams());
 
-    stream_id_to_stream_names.clear();
-    for (const auto &item: getDataStreams()) {
-        stream_id_to_stream_names[item->getStreamId()] = item->getName().toStdString();
+    updateSpikeSchema();
+    updateContinuousSchema();
+    ((RiverOutputEditor *) editor.get())->refreshSchemaFromProcessor();
+}
+
+void RiverOutput::updateSpikeSchema() {
+    auto fields = riverSpikeFields();
+
+    // Spike channels may differ in shape (e.g. tetrodes next to single electrodes), so size the waveform for the
+    // largest and zero-pad the rest.
+    spike_waveform_num_electrodes_ = 0;
+    spike_waveform_num_samples_ = 0;
+    spike_waveform_bit_volts_ = 1.0f;
+    for (int i = 0; i < spikeChannels.size(); i++) {
+        const auto *spike_channel = getSpikeChannel(i);
+        spike_waveform_num_electrodes_ = std::max(spike_waveform_num_electrodes_, (int) spike_channel->getNumChannels());
+        spike_waveform_num_samples_ = std::max(spike_waveform_num_samples_, (int) spike_channel->getTotalSamples());
+        if (i == 0 && !spike_channel->getSourceChannels().isEmpty()) {
+            spike_waveform_bit_volts_ = spike_channel->getSourceChannels()[0]->getBitVolts();
+        }
+    }
+    spike_waveform_scale_ = spike_waveform_bit_volts_ > 0 ? 1.0f / spike_waveform_bit_volts_ : 1.0f;
+
+    if (include_spike_waveform_ && spikeWaveformBytes() > 0) {
+        fields.emplace_back("waveform", river::FieldDefinition::FIXED_WIDTH_BYTES, (int) spikeWaveformBytes());
+    }
+    if (spike_bin_ms_ > 0) {
+        // At least one count, so that the field isn't empty.
+        int num_counts = std::max(1, (int) spikeChannels.size() * spike_bin_units_);
+        fields = {
+                river::FieldDefinition("bin_start_sample_number", river::FieldDefinition::INT64, 8),
+                river::FieldDefinition("counts", river::FieldDefinition::FIXED_WIDTH_BYTES,
+                                       num_counts * (int) sizeof(uint16_t)),
+        };
+    }
+    spike_schema_ = river::StreamSchema(fields);
+}
+
+size_t RiverOutput::spikeWaveformBytes() const {
+    size_t value_size = spike_waveform_as_int16_ ? sizeof(int16_t) : sizeof(float);
+    return (size_t) spike_waveform_num_electrodes_ * spike_waveform_num_samples_ * value_size;
+}
+
+int64_t RiverOutput::writeSpikeWaveform(const RiverOutputConfig &config, const Spike &spike, char *dst) {
+    const SpikeChannel *spike_channel = spike.getChannelInfo();
+    const int total_samples = spike_channel->getTotalSamples();
+    const int num_electrodes = std::min((int) spike_channel->getNumChannels(), config.spike_waveform_num_electrodes);
+    const int num_samples = std::min(total_samples, config.spike_waveform_num_samples);
+    if (num_electrodes < config.spike_waveform_num_electrodes || num_samples < config.spike_waveform_num_samples) {
+        memset(dst, 0, config.spike_waveform_bytes);
+    }
+
+    // Same electrode-major layout as the Spike buffer, so each electrode is one contiguous copy.
+    int64_t saturated = 0;
+    const float *data = spike.getDataPointer();
+    for (int e = 0; e < num_electrodes; e++) {
+        const float *src = data + (size_t) e * total_samples;
+        if (config.spike_waveform_as_int16) {
+            char *electrode_dst = dst + (size_t) e * config.spike_waveform_num_samples * sizeof(int16_t);
+            saturated += quantizeToInterleavedInt16(
+                    &src, &config.spike_waveform_scale, 1, num_samples, electrode_dst, sizeof(int16_t));
+        } else {
+            memcpy(dst + (size_t) e * config.spike_waveform_num_samples * sizeof(float),
+                   src,
+                   num_samples * sizeof(float));
+        }
+    }
+    return saturated;
+}
+
+void RiverOutput::updateContinuousSchema() {
+    continuous_schema_ = continuousSchemaFor(selectedDataStream(), nullptr);
+}
+
+const DataStream *RiverOutput::selectedDataStream() {
+    for (const auto *stream: getDataStreams()) {
+        if (stream->getStreamId() == datastream_id()) {
+            return stream;
+        }
+    }
+    return nullptr;
+}
+
+river::StreamSchema RiverOutput::continuousSchemaFor(const DataStream *stream, RiverStreamOutput *output) const {
+    std::vector<river::FieldDefinition> fields;
+    if (output) {
+        output->channel_indices.clear();
+        output->bit_volts.clear();
+        output->scales.clear();
+    }
+
+    if (stream) {
+        for (const auto *channel: stream->getContinuousChannels()) {
+            if (continuous_as_int16_) {
+                fields.emplace_back(channel->getName().toStdString(), river::FieldDefinition::INT16, 2);
+            } else {
+                fields.emplace_back(channel->getName().toStdString(), river::FieldDefinition::FLOAT, 4);
+            }
+            if (output) {
+                float bit_volts = channel->getBitVolts();
+                output->channel_indices.push_back(channel->getGlobalIndex());
+                output->bit_volts.push_back(bit_volts);
+                output->scales.push_back(bit_volts > 0 ? 1.0f / bit_volts : 1.0f);
+            }
+        }
+    }
+    fields.emplace_back("sample_number", river::FieldDefinition::INT64, 8);
+    if (continuous_compressed_) {
+        // Channel names go in the stream's metadata instead.
+        fields = {river::FieldDefinition("encoded_block", river::FieldDefinition::FIXED_WIDTH_BYTES,
+                                         kEncodedChunkBytes)};
+    }
+
+    if (output) {
+        output->channel_pointers.resize(output->channel_indices.size());
+    }
+    return river::StreamSchema(fields);
+}
+
+river::StreamSchema RiverOutput::schemaFor(const DataStream *stream) const {
+    if (consume_continuous_) {
+        return continuousSchemaFor(stream, nullptr);
+    }
+    if (event_schema_) {
+        return *event_schema_;
+    }
+    return spike_schema_;
+}
+
+std::string RiverOutput::riverStreamNameFor(const DataStream *stream) {
+    String oe_stream = stream->getName();
+    for (auto c: {' ', '\t', '\n'}) {
+        oe_stream = oe_stream.replaceCharacter(c, '_');
+    }
+    return String(streamNameTemplate())
+            .replace("{stream_name}", String(streamName()))
+            .replace("{oe_stream}", oe_stream)
+            .replace("{oe_stream_id}", String(stream->getStreamId()))
+            .toStdString();
+}
+
+bool RiverOutput::openOutput(RiverStreamOutput &output,
+                             const river::RedisConnection &connection,
+                             const river::StreamSchema &schema,
+                             const std::unordered_map<std::string, std::string> &metadata,
+                             bool *unreachable) {
+    // If latency or batch size are nonpositive, write everything synchronously.
+    if (maxLatencyMs() > 0) {
+        RiverWriterOptions options;
+        options.max_latency_ms = maxLatencyMs();
+        options.max_batch_size = maxBatchSize();
+        options.sample_size = schema.sample_size();
+        // The queue's memory is allocated up front, and in samples a wide continuous stream adds up quickly.
+        options.capacity_bytes = (size_t) queueCapacity() * (queueCapacityInBytes() ? 1 : options.sample_size);
+        if (options.capacity_bytes > kMaxQueueCapacityBytes) {
+            LOGC("River Output's write queue for ", output.name, " is limited to ", kMaxQueueCapacityBytes >> 20,
+                 " MB instead of ", options.capacity_bytes >> 20, " MB.");
+            options.capacity_bytes = kMaxQueueCapacityBytes;
+        }
+        options.overflow_policy = overflowPolicy();
+        options.block_timeout_ms = overflowBlockTimeoutMs();
+        options.log = [name = output.name](const std::string &message) { LOGC(name, ": ", message); };
+        if (!spoolDirectory().empty()) {
+            // Unique per acquisition, so a spool left behind by an earlier run isn't overwritten.
+            options.spool_path = File(spoolDirectory())
+                    .getChildFile(String(output.name) + "-" + Time::getCurrentTime().formatted("%Y%m%d-%H%M%S")
+                                  + ".spool")
+                    .getFullPathName()
+                    .toStdString();
+        }
+
+        // If Redis can't be reached yet, the writer thread keeps trying (backing off) while the queue fills up. After
+        // an outage, it waits the same way until the writer can read the stream's metadata again.
+        output.sink = std::make_unique<RiverStreamSink>(
+                [connection, name = output.name, schema, metadata]() {
+                    auto writer = std::make_unique<river::StreamWriter>(connection);
+                    writer->Initialize(name, schema, metadata);
+                    return writer;
+                },
+                [](river::StreamWriter &writer) { writer.Metadata(); });
+        // Before creating the stream, so that a failure here doesn't leave an empty stream behind.
+        try {
+            output.queue = std::make_unique<RiverWriterQueue>(output.sink.get(), options);
+        } catch (const std::bad_alloc &) {
+            LOGE("River Output couldn't allocate a ", options.capacity_bytes >> 20, " MB write queue for ",
+                 output.name, ".");
+            CoreServices::sendStatusMessage("River Output: not enough memory for the write queue.");
+            return false;
+        }
+        try {
+            output.sink->reconnect();
+            LOGD("Created StreamWriter for ", output.name);
+        } catch (const std::exception& e) {
+            LOGC("Failed to create River stream ", output.name, ", will keep retrying: ", e.what());
+            *unreachable = true;
+        }
+        return true;
+    }
+
+    // No writer thread to retry on, so this has to work now.
+    try {
+        output.writer = std::make_unique<river::StreamWriter>(connection);
+        output.writer->Initialize(output.name, schema, metadata);
+    } catch (const std::exception& e) {
+        LOGC("Failed to connect to Redis: ", e.what());
+        CoreServices::sendStatusMessage("Failed to connect to Redis.");
+        return false;
+    }
+    LOGD("Created StreamWriter for ", output.name);
+    return true;
+}
+
+std::unique_ptr<RiverOutputConfig> RiverOutput::buildConfig() const {
+    auto config = std::make_unique<RiverOutputConfig>();
+    if (consume_continuous_) {
+        config->input = RiverOutputConfig::Input::CONTINUOUS;
+    } else if (event_schema_) {
+        config->input = RiverOutputConfig::Input::EVENTS;
+    }
+
+    for (const auto &output: outputs_) {
+        config->outputs.push_back(output.get());
+        config->clocks = config->clocks || output->clock;
+        if (output->stream_id >= config->outputs_by_stream_id.size()) {
+            config->outputs_by_stream_id.resize(output->stream_id + 1, nullptr);
+        }
+        config->outputs_by_stream_id[output->stream_id] = output.get();
+    }
+
+    config->continuous_as_int16 = continuous_as_int16_;
+    config->continuous_compressed = continuous_compressed_;
+
+    config->spike_sample_size = spike_schema_.sample_size();
+    if (include_spike_waveform_ && spike_bin_ms_ <= 0) {
+        config->spike_waveform_bytes = spikeWaveformBytes();
+    }
+    config->spike_waveform_as_int16 = spike_waveform_as_int16_;
+    config->spike_waveform_num_electrodes = spike_waveform_num_electrodes_;
+    config->spike_waveform_num_samples = spike_waveform_num_samples_;
+    config->spike_waveform_scale = spike_waveform_scale_;
+    config->spike_filter = spike_filter_;
+    if (spike_bin_ms_ > 0 && spikeChannels.size() > 0) {
+        config->spike_bin_lag_samples = getSpikeChannel(0)->getPostPeakSamples();
+    }
+    return config;
+}
+
+void RiverOutput::clearOutputs() {
+    // Processing has stopped, so nothing is still reading the old snapshot.
+    config_.store(nullptr, std::memory_order_release);
+    owned_config_.reset();
+
+    // Reads the queues, so has to go first.
+    metrics_publisher_.reset();
+    if (writer_pool_) {
+        writer_pool_->stop();
+        writer_pool_.reset();
+    }
+    for (auto &output: outputs_) {
+        for (auto *stream_output: {output.get(), output->clock.get()}) {
+            if (auto *writer = stream_output ? stream_output->riverWriter() : nullptr) {
+                // No effect if a stopped writer is stopped again.
+                writer->Stop();
+            }
+        }
     }
+    outputs_.clear();
 }
 
 
@@ -150,63 +557,135 @@ AudioProcessorEditor *RiverOutput::createEditor() {
 
 void RiverOutput::handleSpike(SpikePtr spike)
 {
+    RIVER_TRACE_SCOPE("RiverOutput::handleSpike");
+    const RiverOutputConfig *config = config_.load(std::memory_order_acquire);
+    if (!config) {
+        return;
+    }
+    // Likewise spikes, whose sample numbers are only comparable to the ones of their own datastream.
+    RiverStreamOutput *output = config->outputFor(spike->getStreamId());
+    if (!output) {
+        return;
+    }
+    if (!config->spike_filter.accepts(spike->getChannelIndex(), spike->getSortedId())) {
+        output->num_filtered.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (output->binner) {
+        output->binner->add(spike->getChannelIndex(), spike->getSortedId(), spike->getSampleNumber());
+        return;
+    }
 
-    RiverSpike river_spike;
-    int channel_index = spike->getChannelIndex();
-
-    river_spike.channel_index = channel_index;
-    river_spike.sample_number = spike->getSampleNumber();
+    // Write straight into the writer's slab memory (or a preallocated frame when writing synchronously) so
+    // nothing is allocated or copied twice, waveform included.
+    char *dst;
+    if (output->queue) {
+        dst = output->queue->reserve(config->spike_sample_size, 1);
+        if (!dst) {
+            return;
+        }
+    } else {
+        dst = output->frames.data();
+    }
 
     // TODO: 0-index option for unit index
-    river_spike.unit_index = spike->getSortedId();
-
-    if (writing_thread_) {
-        QueuedEvent event;
-        event.raw_data.resize(sizeof(RiverSpike));
-        memcpy(event.raw_data.data(), &river_spike, sizeof(RiverSpike));
-        event.num_samples = 1;
-        writing_thread_->enqueue(event);
+    packRiverSpike(dst, spike->getChannelIndex(), spike->getSortedId(), spike->getSampleNumber());
+
+    if (config->spike_waveform_bytes > 0) {
+        int64_t saturated = writeSpikeWaveform(*config, *spike, dst + sizeof(RiverSpike));
+        if (saturated > 0) {
+            output->num_saturated += saturated;
+        }
+    }
+
+    if (output->queue) {
+        output->queue->commit();
     } else {
-        writer_->WriteBytes(reinterpret_cast<const char *>(&river_spike), 1);
+        RIVER_TRACE_SCOPE("StreamWriter::WriteBytes");
+        output->writer->WriteBytes(dst, 1);
     }
 }
 
 void RiverOutput::handleTTLEvent(TTLEventPtr event) {
-    int stream_id = datastream_id();
-    auto stream_name = stream_id_to_stream_names[stream_id];
-    if (event->getStreamId() != stream_id) {
-        return;
-    }
-
-    if (event->getMetadataValueCount() != 1) {
-        LOGD("Ignoring event received in RiverOutput since invalid number of metadata values found.");
+    RIVER_TRACE_SCOPE("RiverOutput::handleTTLEvent");
+    const RiverOutputConfig *config = config_.load(std::memory_order_acquire);
+    if (!config) {
         return;
     }
-    auto event_metadata_size = event->getChannelInfo()->getTotalEventMetadataSize();
-    if (event_metadata_size == 0) {
-        LOGD("Ignoring event received in RiverOutput since metadata was zero sized.");
+    // When publishing a single stream, this only listens to events on the selected datastream.
+    RiverStreamOutput *output = config->outputFor(event->getStreamId());
+    if (!output) {
         return;
     }
-    if (event_metadata_size % event_schema_->sample_size() != 0) {
-        LOGD("Ignoring event received in RiverOutput since event metadata size did not evenly divide schema size.");
+
+    // Checked against the event schema when acquisition started; channels that didn't fit have no layout.
+    const TtlSampleLayout *layout = config->eventLayoutFor(event->getChannelInfo());
+    if (!layout) {
         return;
     }
 
     LOGD("Processing TTL for event at sample", event->getSampleNumber());
 
-    // Assume that the binary data in the event matches the sample size exactly. If it doesn't, crashes will happen!
-    int num_samples = (int) (event_metadata_size / event_schema_->sample_size());
-    auto ptr = event->getMetadataValue(0)->getRawValuePointer();
+    if (!layout->gathersFields()) {
+        // Already whole samples, copied straight from the event into slab memory; the writer thread writes the slab
+        // as it is, so that's the only copy before River serializes the batch (see EventPayloadBenchmark).
+        auto ptr = reinterpret_cast<const char *>(event->getMetadataValue(0)->getRawValuePointer());
+        if (output->queue) {
+            output->queue->enqueue(ptr, layout->eventBytes(), layout->samplesPerEvent());
+        } else {
+            RIVER_TRACE_SCOPE("StreamWriter::WriteBytes");
+            output->writer->WriteBytes(ptr, layout->samplesPerEvent());
+        }
+        return;
+    }
+
+    // One field per metadata value, gathered straight into the writer's slab memory (or a preallocated frame when
+    // writing synchronously).
+    char *dst;
+    if (output->queue) {
+        dst = output->queue->reserve(layout->eventBytes(), 1);
+        if (!dst) {
+            return;
+        }
+    } else {
+        dst = output->frames.data();
+    }
+    layout->gather([&event](int i) { return event->getMetadataValue(i)->getRawValuePointer(); }, dst);
 
-    if (writing_thread_) {
-        QueuedEvent queuedEvent;
-        queuedEvent.raw_data.resize(event_metadata_size);
-        memcpy(queuedEvent.raw_data.data(), ptr, event_metadata_size);
-        queuedEvent.num_samples = num_samples;
-        writing_thread_->enqueue(queuedEvent);
+    if (output->queue) {
+        output->queue->commit();
     } else {
-        writer_->WriteBytes(reinterpret_cast<const char *>(ptr), num_samples);
+        RIVER_TRACE_SCOPE("StreamWriter::WriteBytes");
+        output->writer->WriteBytes(dst, 1);
+    }
+}
+
+std::vector<RiverOutputConfig::EventLayout> RiverOutput::planEventLayouts(bool publishing_all_streams) {
+    std::vector<RiverOutputConfig::EventLayout> layouts;
+    for (const auto *channel: eventChannels) {
+        if (channel->getType() != EventChannel::Type::TTL
+            || (!publishing_all_streams && channel->getStreamId() != datastream_id())) {
+            continue;
+        }
+
+        std::vector<TtlMetadataField> metadata;
+        for (int i = 0; i < channel->getEventMetadataCount(); i++) {
+            metadata.push_back(ttlMetadataField(*channel->getEventMetadataDescriptor(i)));
+        }
+        RiverOutputConfig::EventLayout event_layout{channel, TtlSampleLayout()};
+        int mismatched_field;
+        TtlPayloadStatus status = event_layout.layout.plan(*event_schema_, metadata, &mismatched_field);
+        if (status != TtlPayloadStatus::VALID) {
+            std::string field = mismatched_field >= 0
+                                ? " (field " + event_schema_->field_definitions[mismatched_field].name + ")"
+                                : "";
+            LOGC("River Output will ignore events from ", channel->getName(), " since ",
+                 describeTtlPayloadStatus(status), field, ".");
+            continue;
+        }
+        layouts.push_back(std::move(event_layout));
     }
+    return layouts;
 }
 
 bool RiverOutput::startAcquisition()
@@ -217,17 +696,87 @@ bool RiverOutput::startAcquisition()
         return false;
     }
 
-    if (writing_thread_) {
+    if (writer_pool_) {
         // This shouldn't really happen since any threads should've been stopped in stopAcquisition()... but handle
         // it anyways.
         jassertfalse;
-        writing_thread_->stopThread(1000 + maxLatencyMs());
-        writing_thread_.reset();
     }
-    if (writer_) {
-        // Should already be stopped, but no effect if a stopped writer is stopped again.
-        writer_->Stop();
-        writer_.reset();
+    clearOutputs();
+    last_drop_counts_ = DropCounts();
+    last_spool_stats_ = SpoolStats();
+    last_connection_stats_ = ConnectionStats();
+    last_writer_metrics_ = WriterMetrics();
+    const bool publishing_all_streams = publishAllStreams();
+
+    // Spikes and events don't strictly need a datastream when publishing a single stream, so this may hold nullptr.
+    std::vector<const DataStream *> streams;
+    if (publishing_all_streams) {
+        for (const auto *stream: getDataStreams()) {
+            streams.push_back(stream);
+        }
+    } else {
+        streams.push_back(selectedDataStream());
+    }
+
+    // Metadata shared by every stream.
+    std::unordered_map<std::string, std::string> base_metadata;
+    if (!shouldConsumeContinuous() && shouldConsumeSpikes())
+    {
+        if (spikeChannels.size() == 0) {
+            // Can't consume spikes if there are no spike channels.
+            CoreServices::sendStatusMessage("River Output has no spike channels.");
+            return false;
+        }
+
+        if (!publishing_all_streams) {
+            const uint16 stream_id = streams.front() ? streams.front()->getStreamId() : (uint16) datastream_id();
+            for (int i = 0; i < spikeChannels.size(); i++) {
+                if (getSpikeChannel(i)->getStreamId() != stream_id) {
+                    LOGC("River Output only publishes spikes from the selected datastream; tick All streams to "
+                         "publish the spike channels on other datastreams too.");
+                    break;
+                }
+            }
+        }
+
+        // Assume that all spike channels have the same details.
+        auto spike_channel = getSpikeChannel(0);
+        base_metadata["prepeak_samples"] = std::to_string(spike_channel->getPrePeakSamples());
+        base_metadata["postpeak_samples"] = std::to_string(spike_channel->getPostPeakSamples());
+        base_metadata["sampling_rate"] = std::to_string(CoreServices::getGlobalSampleRate());
+
+        updateSpikeSchema();
+        if (spike_bin_ms_ > 0) {
+            base_metadata["spike_bin_ms"] = std::to_string(spike_bin_ms_);
+            base_metadata["num_spike_channels"] = std::to_string(spikeChannels.size());
+            base_metadata["num_units"] = std::to_string(spike_bin_units_);
+            base_metadata["counts_dtype"] = "uint16";
+            base_metadata["counts_layout"] = "spike_channel * num_units + unit";
+        } else if (include_spike_waveform_) {
+            // waveform is num_electrodes x num_samples, electrode-major, zero-padded for smaller spike channels.
+            base_metadata["waveform_num_electrodes"] = std::to_string(spike_waveform_num_electrodes_);
+            base_metadata["waveform_num_samples"] = std::to_string(spike_waveform_num_samples_);
+            base_metadata["waveform_dtype"] = spike_waveform_as_int16_ ? "int16" : "float32";
+            if (spike_waveform_as_int16_) {
+                base_metadata["waveform_bit_volts"] = std::to_string(spike_waveform_bit_volts_);
+            }
+        }
+
+        if (!spike_filter_.acceptsAll()) {
+            // Empty lists mean every channel (or unit).
+            base_metadata["spike_channel_filter"] = spike_filter_.channels();
+            base_metadata["spike_unit_filter"] = spike_filter_.units();
+            base_metadata["drop_unsorted_spikes"] = spike_filter_.dropUnsorted() ? "true" : "false";
+        }
+    }
+
+    std::vector<RiverOutputConfig::EventLayout> event_layouts;
+    if (!shouldConsumeContinuous() && event_schema_) {
+        event_layouts = planEventLayouts(publishing_all_streams);
+        if (event_layouts.empty()) {
+            CoreServices::sendStatusMessage("River Output has no event channels matching the event schema.");
+            return false;
+        }
     }
 
     river::RedisConnection connection(
@@ -237,53 +786,174 @@ bool RiverOutput::startAcquisition()
             // TODO: allow for configurable timeout
             5);
 
-      LOGD("River Output Connection: ", redisConnectionHostname(), ":", redisConnectionPort());
-
-      try {
-          writer_ = std::make_unique<river::StreamWriter>(connection);
-      } catch (const std::exception& e) {
-          LOGC("Failed to connect to Redis: ", e.what());
-          CoreServices::sendStatusMessage("Failed to connect to Redis.");
-          CoreServices::setAcquisitionStatus(false);
-          isEnabled = false;
-          CoreServices::updateSignalChain(this->getEditor());
-          return false;
-      }
-
-      LOGD("Created StreamWriter.");
-
-      std::unordered_map<std::string, std::string> metadata;
-
-      if (shouldConsumeSpikes())
-      {
-          if (spikeChannels.size() == 0) {
-              // Can't consume spikes if there are no spike channels.
-              CoreServices::sendStatusMessage("River Output has no spike channels.");
-              return false;
-          }
-
-          // Assume that all spike channels have the same details.
-          auto spike_channel = getSpikeChannel(0);
-          metadata["prepeak_samples"] = std::to_string(spike_channel->getPrePeakSamples());
-          metadata["postpeak_samples"] = std::to_string(spike_channel->getPostPeakSamples());
-          metadata["sampling_rate"] = std::to_string(CoreServices::getGlobalSampleRate());
-      }
-
-     LOGD("Initialized StreamWriter.");
-     writer_->Initialize(sn, getSchema(), metadata);
+    LOGD("River Output Connection: ", redisConnectionHostname(), ":", redisConnectionPort());
+
+    bool unreachable = false;
+    for (const auto *stream: streams) {
+        auto output = std::make_unique<RiverStreamOutput>();
+        output->stream_id = stream ? stream->getStreamId() : (uint16) datastream_id();
+        output->name = publishing_all_streams ? riverStreamNameFor(stream) : sn;
+
+        auto metadata = base_metadata;
+        river::StreamSchema schema = schemaFor(stream);
+        if (shouldConsumeSpikes() && spike_bin_ms_ > 0) {
+            double sample_rate = stream ? stream->getSampleRate() : CoreServices::getGlobalSampleRate();
+            auto bin_samples = std::max<int64_t>(1, std::llround(sample_rate * spike_bin_ms_ / 1000.0));
+            output->binner = std::make_unique<SpikeBinner>((int) spikeChannels.size(), spike_bin_units_, bin_samples);
+            metadata["spike_bin_samples"] = std::to_string(bin_samples);
+        }
+        if (shouldConsumeContinuous())
+        {
+            schema = continuousSchemaFor(stream, output.get());
+            if (output->channel_indices.empty()) {
+                if (publishing_all_streams) {
+                    LOGC("River Output skipping datastream ", stream->getName(), " since it has no continuous channels.");
+                    continue;
+                }
+                CoreServices::sendStatusMessage("River Output has no continuous channels to stream.");
+                clearOutputs();
+                return false;
+            }
+            float sample_rate = stream->getSampleRate();
+            metadata["sampling_rate"] = std::to_string(sample_rate);
+            metadata["num_channels"] = std::to_string(output->channel_indices.size());
+
+            if (decimationFactor() > 1) {
+                size_t num_channels = output->channel_indices.size();
+                output->decimator = std::make_unique<PolyphaseDecimator>((int) num_channels, decimationFactor());
+                output->decimated_planes.assign(num_channels, std::vector<float>());
+                output->decimated_pointers.assign(num_channels, nullptr);
+
+                // sampling_rate is what's actually in the stream; sample_number still counts input samples.
+                metadata["sampling_rate"] = std::to_string(sample_rate / output->decimator->factor());
+                metadata["input_sampling_rate"] = std::to_string(sample_rate);
+                metadata["decimation_factor"] = std::to_string(output->decimator->factor());
+                metadata["decimation_filter"] = output->decimator->description(sample_rate);
+                metadata["decimation_group_delay_samples"] =
+                        std::to_string(output->decimator->groupDelaySamples());
+            }
+            if (continuous_compressed_) {
+                std::string channel_names;
+                for (const auto *channel: stream->getContinuousChannels()) {
+                    channel_names += (channel_names.empty() ? "" : ",") + channel->getName().toStdString();
+                }
+                metadata["encoding"] = "delta_zigzag_bitpack_int16";
+                metadata["encoded_chunk_bytes"] = std::to_string(kEncodedChunkBytes);
+                metadata["channel_names"] = channel_names;
+            }
+            if (continuous_as_int16_ || continuous_compressed_) {
+                // Readers multiply by these to get back to the original units.
+                std::string bit_volts;
+                for (size_t c = 0; c < output->bit_volts.size(); c++) {
+                    bit_volts += (c > 0 ? "," : "") + std::to_string(output->bit_volts[c]);
+                }
+                metadata["bit_volts"] = bit_volts;
+            }
+        }
+        if (stream) {
+            metadata["oe_stream_name"] = stream->getName().toStdString();
+        }
+
+        if (!openOutput(*output, connection, schema, metadata, &unreachable)) {
+            clearOutputs();
+            return false;
+        }
+        if (!output->queue) {
+            if (shouldConsumeSpikes()) {
+                // Spikes (or bins) are written one at a time from here.
+                output->frames.resize(spike_schema_.sample_size());
+            } else if (event_schema_) {
+                // Gathered events, likewise.
+                output->frames.resize(event_schema_->sample_size());
+            }
+        }
+
+        if (publishClock() && !stream) {
+            LOGC("River Output isn't publishing a clock stream for ", output->name, " since it has no datastream.");
+        } else if (publishClock()) {
+            auto clock = std::make_unique<RiverStreamOutput>();
+            clock->stream_id = output->stream_id;
+            clock->name = output->name + kClockStreamSuffix;
+            std::unordered_map<std::string, std::string> clock_metadata;
+            clock_metadata["river_stream"] = output->name;
+            clock_metadata["oe_stream_name"] = stream->getName().toStdString();
+            clock_metadata["sampling_rate"] = std::to_string(stream->getSampleRate());
+            clock_metadata["clock_interval_ms"] = std::to_string(clockIntervalMs());
+            // The clocks are read as each block starts being processed, once all of its samples have arrived.
+            clock_metadata["sample_number_reference"] = "one past the block's last sample";
+            clock_metadata["steady_clock"] = "std::chrono::steady_clock, ns";
+            clock_metadata["system_clock"] = "ns since the Unix epoch";
+            if (!openOutput(*clock, connection, river::StreamSchema(riverClockFields()), clock_metadata,
+                            &unreachable)) {
+                clearOutputs();
+                return false;
+            }
+            if (!clock->queue) {
+                clock->frames.resize(sizeof(RiverClockSample));
+            }
+            output->clock = std::move(clock);
+            output->clock_sampler = std::make_unique<ClockSampler>((int64_t) clockIntervalMs() * 1000000);
+        }
+
+        outputs_.push_back(std::move(output));
+    }
+
+    if (outputs_.empty()) {
+        CoreServices::sendStatusMessage("River Output has no datastreams to publish.");
+        return false;
+    }
+    if (unreachable) {
+        CoreServices::sendStatusMessage("River Output can't reach Redis yet; queueing until it can.");
+    }
+
+    auto config = buildConfig();
+    config->event_layouts = std::move(event_layouts);
+    owned_config_ = std::move(config);
+    config_.store(owned_config_.get(), std::memory_order_release);
+
+    // Before the writer threads start, so they're traced from the beginning.
+    if (!traceFile().empty()) {
+        Tracer::clear();
+        Tracer::setEnabled(true);
+    }
 
     if (editor) {
         // GenericEditor#enable isn't marked as virtual, so need to *upcast* to VisualizerEditor :(
         ((VisualizerEditor *) (editor.get()))->enable();
     }
 
-    // If latency or batch size are nonpositive, write everything synchronously.
     if (maxLatencyMs() > 0) {
-        writing_thread_ = std::make_unique<RiverWriterThread>(writer_.get(), maxLatencyMs());
-        writing_thread_->startThread();
-        LOGC("Writing to River asynchronously with stream name ", sn);
+        // Clock streams are written by the same threads, but aren't part of the metrics.
+        std::vector<RiverWriterQueue *> queues;
+        std::vector<RiverWriterQueue *> all_queues;
+        for (auto &output: outputs_) {
+            queues.push_back(output->queue.get());
+            all_queues.push_back(output->queue.get());
+            if (output->clock) {
+                all_queues.push_back(output->clock->queue.get());
+            }
+        }
+        writer_pool_ = std::make_unique<RiverWriterPool>(
+                all_queues, RiverWriterPool::defaultNumThreads((int) queues.size()));
+        writer_pool_->start();
+        LOGC("Writing ", outputs_.size(), " stream(s) to River asynchronously on ", writer_pool_->numThreads(),
+             " thread(s), starting with stream name ", outputs_.front()->name);
+
+        if (!metricsFile().empty()) {
+            metrics_publisher_ = std::make_unique<MetricsFilePublisher>(
+                    metricsFile(), kMetricsIntervalMs, [queues]() {
+                        WriterMetrics metrics;
+                        for (const auto *queue: queues) {
+                            metrics.merge(queue->metrics());
+                        }
+                        return metrics;
+                    }, [](const std::string &message) { LOGC(message); });
+            metrics_publisher_->start();
+            LOGC("Publishing River Output metrics to ", metricsFile());
+        }
     } else {
-        LOGC("Writing to River synchronously with stream name ", sn);
+        LOGC("Writing ", outputs_.size(), " stream(s) to River synchronously, starting with stream name ",
+             outputs_.front()->name);
     }
 
     return true;
@@ -292,14 +962,135 @@ bool RiverOutput::startAcquisition()
 
 bool RiverOutput::stopAcquisition()
 {
-    if (writing_thread_) {
-        writing_thread_->stopThread(1000 + maxLatencyMs());
-        writing_thread_.reset();
+    // No more spikes are coming, so whatever's left in the bins is final.
+    if (owned_config_) {
+        writeSpikeBins(*owned_config_, true);
+    }
+
+    if (writer_pool_) {
+        // process() is no longer being called, so hand off whatever was written since the last block.
+        for (auto &output: outputs_) {
+            output->queue->publish();
+            if (output->clock) {
+                output->clock->queue->publish();
+            }
+        }
+        writer_pool_->stop();
+        last_writer_metrics_ = writerMetrics();
+        writer_pool_.reset();
+    }
+    if (metrics_publisher_) {
+        // Once more, now that everything has been written.
+        metrics_publisher_->stop();
+        metrics_publisher_.reset();
     }
+    if (Tracer::enabled()) {
+        // Every traced thread has stopped recording by now.
+        Tracer::setEnabled(false);
+        if (Tracer::writeChromeTrace(traceFile())) {
+            LOGC("Wrote ", Tracer::numEvents(), " trace events to ", traceFile());
+        } else {
+            LOGC("Failed to write the trace to ", traceFile());
+        }
+    }
+
+    last_drop_counts_ = DropCounts();
+    last_spool_stats_ = SpoolStats();
+    last_connection_stats_ = ConnectionStats();
+    for (auto &output: outputs_) {
+        if (output->clock) {
+            if (output->clock->queue) {
+                int64_t clock_drops = output->clock->queue->dropCounts().total();
+                if (clock_drops > 0) {
+                    LOGC("River Output dropped ", clock_drops, " clock samples for ", output->clock->name, ".");
+                }
+                output->clock->queue.reset();
+            }
+            if (auto *clock_writer = output->clock->riverWriter()) {
+                clock_writer->Stop();
+            }
+        }
+
+        DropCounts drops;
+        SpoolStats spool;
+        ConnectionStats connection;
+        if (output->queue) {
+            drops = output->queue->dropCounts();
+            spool = output->queue->spoolStats();
+            connection = output->queue->connectionStats();
+            output->queue.reset();
+        }
+        last_drop_counts_.newest += drops.newest;
+        last_drop_counts_.oldest += drops.oldest;
+        last_drop_counts_.timed_out += drops.timed_out;
+        last_drop_counts_.failed += drops.failed;
+        last_spool_stats_.pending_samples += spool.pending_samples;
+        last_spool_stats_.pending_bytes += spool.pending_bytes;
+        last_spool_stats_.spooled_samples += spool.spooled_samples;
+        last_spool_stats_.replayed_samples += spool.replayed_samples;
+        addConnectionStats(last_connection_stats_, connection);
+        if (drops.total() > 0) {
+            LOGC("River Output dropped ", drops.total(), " samples for ", output->name,
+                 " because the write queue was full or River was unreachable.");
+        }
+        if (output->encoded_bytes > 0) {
+            LOGC("River Output compressed ", output->name, " ", (double) output->raw_bytes.load()
+                 / (double) output->encoded_bytes.load(), "x; median encode time ",
+                 output->encode_time_ns.snapshot().percentile(0.5) / 1000, " us per block.");
+        }
+        if (spool.pending_samples > 0) {
+            LOGC("River Output couldn't replay ", spool.pending_samples, " spooled samples for ", output->name,
+                 "; they're kept in ", spoolDirectory());
+        }
+        if (connection.reconnects > 0 || !connection.connected) {
+            LOGC("River Output lost its connection to Redis for ", output->name, " ", connection.reconnects
+                 + (connection.connected ? 0 : 1), " time(s), for ", connection.total_outage_s, " s in total.");
+        }
 
-    if (writer_) {
-        writer_->Stop();
-        // Don't clear the writer just yet so that totalSamplesWritten() (and maybe
+        river::StreamWriter *writer = output->riverWriter();
+        if (!writer) {
+            LOGC("River Output never reached Redis to create ", output->name, ".");
+            continue;
+        }
+        try {
+            auto metadata = writer->Metadata();
+            metadata["dropped_samples_newest"] = std::to_string(drops.newest);
+            metadata["dropped_samples_oldest"] = std::to_string(drops.oldest);
+            metadata["dropped_samples_timed_out"] = std::to_string(drops.timed_out);
+            metadata["dropped_samples_failed"] = std::to_string(drops.failed);
+            if (spool.spooled_samples > 0) {
+                metadata["spooled_samples"] = std::to_string(spool.spooled_samples);
+                metadata["unreplayed_spooled_samples"] = std::to_string(spool.pending_samples);
+            }
+            if (connection.reconnect_attempts > 0) {
+                metadata["reconnects"] = std::to_string(connection.reconnects);
+                metadata["outage_total_s"] = std::to_string(connection.total_outage_s);
+                metadata["outage_longest_s"] = std::to_string(connection.longest_outage_s);
+            }
+            if (output->binner) {
+                metadata["late_binned_spikes"] = std::to_string(output->binner->numLate());
+                metadata["dropped_binned_spikes"] = std::to_string(output->binner->numDropped());
+            }
+            if (owned_config_->input == RiverOutputConfig::Input::SPIKES && !owned_config_->spike_filter.acceptsAll()) {
+                metadata["filtered_spikes"] = std::to_string(output->num_filtered.load());
+            }
+            if (output->encoded_bytes > 0) {
+                metadata["compression_ratio"] = std::to_string(
+                        (double) output->raw_bytes.load() / (double) output->encoded_bytes.load());
+            }
+            const auto input = owned_config_->input;
+            if ((input == RiverOutputConfig::Input::CONTINUOUS
+                 && (owned_config_->continuous_as_int16 || owned_config_->continuous_compressed))
+                || (input == RiverOutputConfig::Input::SPIKES && owned_config_->spike_waveform_bytes > 0
+                    && owned_config_->spike_waveform_as_int16)) {
+                metadata["saturated_values"] = std::to_string(output->num_saturated.load());
+            }
+            writer->SetMetadata(metadata);
+        } catch (const std::exception& e) {
+            LOGC("Failed to write drop counts to River metadata: ", e.what());
+        }
+        writer->Stop();
+        // Don't clear the outputs just yet so that totalSamplesWritten() (and maybe
         // other methods) stay valid.
     }
 
@@ -314,8 +1105,287 @@ bool RiverOutput::stopAcquisition()
 
 void RiverOutput::process(AudioSampleBuffer &buffer)
 {
-    if (writer_) {
-        checkForEvents(shouldConsumeSpikes());
+    const RiverOutputConfig *config = config_.load(std::memory_order_acquire);
+    if (!config) {
+        return;
+    }
+    if (Tracer::enabled()) {
+        Tracer::setThreadName("Processing");
+    }
+    RIVER_TRACE_SCOPE("RiverOutput::process");
+
+    if (config->clocks) {
+        writeClockSamples(*config);
+    }
+
+    if (config->input == RiverOutputConfig::Input::CONTINUOUS) {
+        for (auto *output: config->outputs) {
+            RIVER_TRACE_SCOPE("RiverOutput::writeContinuousBlock");
+            writeContinuousBlock(*config, buffer, *output);
+
+            // Each block is its own batch, so there's no reason to hold onto it.
+            if (output->queue) {
+                output->queue->publish();
+            }
+        }
+        return;
+    }
+
+    for (auto *output: config->outputs) {
+        if (output->binner) {
+            // Bins line up with sample numbers, starting from the first block's.
+            output->binner->start(getFirstSampleNumberForBlock(output->stream_id));
+        }
+    }
+
+    {
+        RIVER_TRACE_SCOPE("RiverOutput::checkForEvents");
+        checkForEvents(config->input == RiverOutputConfig::Input::SPIKES);
+    }
+    writeSpikeBins(*config, false);
+
+    // Keep filling the current batches across blocks until their oldest sample is due.
+    for (auto *output: config->outputs) {
+        if (output->queue) {
+            output->queue->publishIfDue();
+        }
+    }
+}
+
+void RiverOutput::writeClockSamples(const RiverOutputConfig &config) {
+    // Read once, so every stream's sample lines up with the same instant.
+    const int64_t steady_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    const int64_t system_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+
+    for (auto *output: config.outputs) {
+        if (!output->clock || !output->clock_sampler->due(steady_ns)) {
+            continue;
+        }
+        RiverStreamOutput &clock = *output->clock;
+        const int64 sample_number = getFirstSampleNumberForBlock(output->stream_id)
+                                    + getNumSamplesInBlock(output->stream_id);
+
+        char *dst;
+        if (clock.queue) {
+            dst = clock.queue->reserve(sizeof(RiverClockSample), 1);
+            if (!dst) {
+                continue;
+            }
+        } else {
+            dst = clock.frames.data();
+        }
+        packRiverClockSample(dst, sample_number, steady_ns, system_ns);
+        if (clock.queue) {
+            clock.queue->commit();
+            // Few and far between, so there's nothing to batch them with.
+            clock.queue->publish();
+        } else {
+            RIVER_TRACE_SCOPE("StreamWriter::WriteBytes");
+            clock.writer->WriteBytes(dst, 1);
+        }
+    }
+}
+
+void RiverOutput::writeSpikeBins(const RiverOutputConfig &config, bool all) {
+    for (auto *output: config.outputs) {
+        if (!output->binner) {
+            continue;
+        }
+        auto write = [this, &config, output](int64_t bin_start_sample_number, const uint16_t *counts) {
+            writeSpikeBin(config, *output, bin_start_sample_number, counts);
+        };
+
+        int64_t num_bins;
+        if (all) {
+            num_bins = output->binner->emitAll(write);
+        } else {
+            // Any spike still to come has its peak at least lag samples before the end of this block.
+            int64_t end = getFirstSampleNumberForBlock(output->stream_id) + getNumSamplesInBlock(output->stream_id);
+            num_bins = output->binner->emitBinsEndingBy(end - config.spike_bin_lag_samples, write);
+        }
+        // Decoders want each bin as soon as it's done, rather than batched with the next.
+        if (num_bins > 0 && output->queue) {
+            output->queue->publish();
+        }
+    }
+}
+
+void RiverOutput::writeSpikeBin(const RiverOutputConfig &config,
+                                RiverStreamOutput &output,
+                                int64_t bin_start_sample_number,
+                                const uint16_t *counts) {
+    char *dst;
+    if (output.queue) {
+        dst = output.queue->reserve(config.spike_sample_size, 1);
+        if (!dst) {
+            return;
+        }
+    } else {
+        dst = output.frames.data();
+    }
+
+    memcpy(dst, &bin_start_sample_number, sizeof(int64_t));
+    // The spike schema was sized for exactly this many counts when acquisition started.
+    memcpy(dst + sizeof(int64_t), counts, output.binner->countsPerBin() * sizeof(uint16_t));
+
+    if (output.queue) {
+        output.queue->commit();
+    } else {
+        RIVER_TRACE_SCOPE("StreamWriter::WriteBytes");
+        output.writer->WriteBytes(dst, 1);
+    }
+}
+
+void RiverOutput::writeContinuousBlock(const RiverOutputConfig &config,
+                                       const AudioSampleBuffer &buffer,
+                                       RiverStreamOutput &output) {
+    const uint16 stream_id = output.stream_id;
+    const int num_input_samples = getNumSamplesInBlock(stream_id);
+    if (num_input_samples <= 0) {
+        return;
+    }
+    const int64 first_sample_number = getFirstSampleNumberForBlock(stream_id);
+
+    const size_t num_channels = output.channel_indices.size();
+    for (size_t c = 0; c < num_channels; c++) {
+        output.channel_pointers[c] = buffer.getReadPointer(output.channel_indices[c]);
+    }
+
+    // Sample numbers of the frames written below are first_sample_number + first_offset + t * sample_step.
+    int num_samples = num_input_samples;
+    int64 first_offset = 0;
+    int sample_step = 1;
+    const float *const *planes = output.channel_pointers.data();
+    if (output.decimator) {
+        // Always run the filter, even if nothing comes out of this block, so that its history stays continuous.
+        first_offset = output.decimator->nextOutputOffset();
+        sample_step = output.decimator->factor();
+        num_samples = output.decimator->numOutputsFor(num_input_samples);
+        if (num_samples > output.decimated_length) {
+            output.decimated_length = num_samples;
+            for (size_t c = 0; c < num_channels; c++) {
+                growBuffer(output.decimated_planes[c], (size_t) output.decimated_length, output.num_allocations);
+                output.decimated_pointers[c] = output.decimated_planes[c].data();
+            }
+        }
+        output.decimator->process(output.channel_pointers.data(), num_input_samples, output.decimated_pointers.data());
+        planes = output.decimated_pointers.data();
+        if (num_samples == 0) {
+            return;
+        }
+    }
+
+    if (config.continuous_compressed) {
+        writeEncodedBlock(output, planes, num_samples, first_sample_number + first_offset, sample_step);
+        return;
+    }
+
+    const size_t value_size = config.continuous_as_int16 ? sizeof(int16_t) : sizeof(float);
+    const size_t frame_size = num_channels * value_size + sizeof(int64_t);
+    const size_t num_bytes = frame_size * num_samples;
+
+    char *dst;
+    if (output.queue) {
+        dst = output.queue->reserve(num_bytes, num_samples);
+        if (!dst) {
+            return;
+        }
+    } else {
+        growBuffer(output.frames, num_bytes, output.num_allocations);
+        dst = output.frames.data();
+    }
+
+    if (config.continuous_as_int16) {
+        int64_t saturated = quantizeToInterleavedInt16(planes,
+                                                       output.scales.data(),
+                                                       (int) num_channels,
+                                                       num_samples,
+                                                       dst,
+                                                       frame_size);
+        if (saturated > 0) {
+            output.num_saturated += saturated;
+        }
+    } else {
+        // Planar -> interleaved. Reading across channels for each sample keeps the writes sequential, which is
+        // what matters for a frame that may be thousands of bytes wide.
+        for (int t = 0; t < num_samples; t++) {
+            auto *frame = reinterpret_cast<float *>(dst + frame_size * t);
+            for (size_t c = 0; c < num_channels; c++) {
+                frame[c] = planes[c][t];
+            }
+        }
+    }
+    for (int t = 0; t < num_samples; t++) {
+        int64_t sample_number = first_sample_number + first_offset + (int64) t * sample_step;
+        memcpy(dst + frame_size * t + num_channels * value_size, &sample_number, sizeof(int64_t));
+    }
+
+    if (output.queue) {
+        output.queue->commit();
+    } else {
+        RIVER_TRACE_SCOPE("StreamWriter::WriteBytes");
+        output.writer->WriteBytes(dst, num_samples);
+    }
+}
+
+void RiverOutput::writeEncodedBlock(RiverStreamOutput &output,
+                                    const float *const *planes,
+                                    int num_samples,
+                                    int64 first_sample_number,
+                                    int sample_step) {
+    const int num_channels = (int) output.channel_indices.size();
+
+    // Encoded straight into the queue: room for the largest the block could get, of which only the chunks it
+    // actually takes are committed.
+    const size_t max_bytes = maxEncodedInt16BlockSize(num_channels, num_samples);
+    const int64_t max_chunks = (int64_t) ((max_bytes + kEncodedChunkBytes - 1) / kEncodedChunkBytes);
+    char *encoded;
+    if (output.queue) {
+        encoded = output.queue->reserve((size_t) max_chunks * kEncodedChunkBytes, max_chunks);
+        if (!encoded) {
+            return;
+        }
+    } else {
+        growBuffer(output.frames, (size_t) max_chunks * kEncodedChunkBytes, output.num_allocations);
+        encoded = output.frames.data();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    // Only grows, like the decimated planes.
+    growBuffer(output.int16_frames, (size_t) num_channels * num_samples, output.num_allocations);
+    int64_t saturated = quantizeToInterleavedInt16(planes,
+                                                   output.scales.data(),
+                                                   num_channels,
+                                                   num_samples,
+                                                   reinterpret_cast<char *>(output.int16_frames.data()),
+                                                   num_channels * sizeof(int16_t));
+    if (saturated > 0) {
+        output.num_saturated += saturated;
+    }
+
+    const size_t num_bytes = encodeInt16Block(output.int16_frames.data(),
+                                              num_channels,
+                                              num_samples,
+                                              first_sample_number,
+                                              sample_step,
+                                              encoded);
+    const int64_t num_chunks = (int64_t) ((num_bytes + kEncodedChunkBytes - 1) / kEncodedChunkBytes);
+    const size_t padded_bytes = (size_t) num_chunks * kEncodedChunkBytes;
+    memset(encoded + num_bytes, 0, padded_bytes - num_bytes);
+
+    output.raw_bytes.fetch_add((int64_t) num_samples * (num_channels * sizeof(int16_t) + sizeof(int64_t)),
+                               std::memory_order_relaxed);
+    output.encoded_bytes.fetch_add((int64_t) padded_bytes, std::memory_order_relaxed);
+    output.encode_time_ns.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+
+    if (output.queue) {
+        output.queue->commit(padded_bytes, num_chunks);
+    } else {
+        RIVER_TRACE_SCOPE("StreamWriter::WriteBytes");
+        output.writer->WriteBytes(encoded, num_chunks);
     }
 }
 
@@ -328,11 +1398,95 @@ int RiverOutput::datastream_id() {
 }
 
 int64_t RiverOutput::totalSamplesWritten() const {
-    if (writer_) {
-        return writer_->total_samples_written();
-    } else {
-        return 0;
+    int64_t total = 0;
+    for (const auto &output: outputs_) {
+        // A sink's writer starts counting from zero again each time it reconnects.
+        if (output->sink) {
+            total += output->sink->samplesWritten();
+        } else if (output->writer) {
+            total += output->writer->total_samples_written();
+        }
+    }
+    return total;
+}
+
+DropCounts RiverOutput::dropCounts() const {
+    if (!writer_pool_) {
+        return last_drop_counts_;
+    }
+
+    DropCounts counts;
+    for (const auto &output: outputs_) {
+        auto drops = output->queue->dropCounts();
+        counts.newest += drops.newest;
+        counts.oldest += drops.oldest;
+        counts.timed_out += drops.timed_out;
+        counts.failed += drops.failed;
+    }
+    return counts;
+}
+
+SpoolStats RiverOutput::spoolStats() const {
+    if (!writer_pool_) {
+        return last_spool_stats_;
+    }
+
+    SpoolStats stats;
+    for (const auto &output: outputs_) {
+        auto spool = output->queue->spoolStats();
+        stats.pending_samples += spool.pending_samples;
+        stats.pending_bytes += spool.pending_bytes;
+        stats.spooled_samples += spool.spooled_samples;
+        stats.replayed_samples += spool.replayed_samples;
+    }
+    return stats;
+}
+
+WriterMetrics RiverOutput::writerMetrics() const {
+    if (!writer_pool_) {
+        return last_writer_metrics_;
     }
+
+    WriterMetrics metrics;
+    for (const auto &output: outputs_) {
+        metrics.merge(output->queue->metrics());
+    }
+    return metrics;
+}
+
+ConnectionStats RiverOutput::connectionStats() const {
+    if (!writer_pool_) {
+        return last_connection_stats_;
+    }
+
+    ConnectionStats stats;
+    for (const auto &output: outputs_) {
+        addConnectionStats(stats, output->queue->connectionStats());
+    }
+    return stats;
+}
+
+double RiverOutput::processingAllocationsPerSecond() {
+    int64_t num_allocations = 0;
+    for (const auto &output: outputs_) {
+        num_allocations += output->num_allocations.load(std::memory_order_relaxed);
+        if (output->binner) {
+            num_allocations += output->binner->numAllocations();
+        }
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed = now - last_allocation_check_;
+    if (elapsed.count() >= 1.0) {
+        // The counts start over with each acquisition's outputs.
+        int64_t new_allocations = num_allocations >= last_num_allocations_
+                                  ? num_allocations - last_num_allocations_
+                                  : num_allocations;
+        allocations_per_second_ = (double) new_allocations / elapsed.count();
+        last_num_allocations_ = num_allocations;
+        last_allocation_check_ = now;
+    }
+    return allocations_per_second_;
 }
 
 std::string RiverOutput::redisConnectionHostname() {
@@ -365,6 +1519,11 @@ void RiverOutput::saveCustomParametersToXml(XmlElement *parentElement) {
     mainNode->setAttribute("port", redisConnectionPort());
     mainNode->setAttribute("password", redisConnectionPassword());
     mainNode->setAttribute("max_latency_ms", maxLatencyMs());
+    mainNode->setAttribute("max_batch_size", maxBatchSize());
+    mainNode->setAttribute("queue_capacity", queueCapacity());
+    mainNode->setAttribute("queue_capacity_in_bytes", queueCapacityInBytes());
+    mainNode->setAttribute("overflow_policy", (int) overflowPolicy());
+    mainNode->setAttribute("overflow_block_timeout_ms", overflowBlockTimeoutMs());
     mainNode->setAttribute("stream_name", streamName());
     mainNode->setAttribute("datastream_id", datastream_id());
 
@@ -372,6 +1531,24 @@ void RiverOutput::saveCustomParametersToXml(XmlElement *parentElement) {
         std::string event_schema_json = event_schema_->ToJson();
         mainNode->setAttribute("event_schema_json", event_schema_json);
     }
+    mainNode->setAttribute("consume_continuous", consume_continuous_);
+    mainNode->setAttribute("continuous_as_int16", continuous_as_int16_);
+    mainNode->setAttribute("continuous_compressed", continuous_compressed_);
+    mainNode->setAttribute("decimation_factor", decimationFactor());
+    mainNode->setAttribute("publish_all_streams", publishAllStreams());
+    mainNode->setAttribute("stream_name_template", streamNameTemplate());
+    mainNode->setAttribute("spool_directory", spoolDirectory());
+    mainNode->setAttribute("metrics_file", metricsFile());
+    mainNode->setAttribute("trace_file", traceFile());
+    mainNode->setAttribute("publish_clock", publishClock());
+    mainNode->setAttribute("clock_interval_ms", clockIntervalMs());
+    mainNode->setAttribute("include_spike_waveform", include_spike_waveform_);
+    mainNode->setAttribute("spike_waveform_as_int16", spike_waveform_as_int16_);
+    mainNode->setAttribute("spike_channel_filter", spike_filter_.channels());
+    mainNode->setAttribute("spike_unit_filter", spike_filter_.units());
+    mainNode->setAttribute("drop_unsorted_spikes", spike_filter_.dropUnsorted());
+    mainNode->setAttribute("spike_bin_ms", spike_bin_ms_);
+    mainNode->setAttribute("spike_bin_units", spike_bin_units_);
 }
 
 void RiverOutput::loadCustomParametersFromXml(XmlElement* xml) {
@@ -387,9 +1564,45 @@ void RiverOutput::loadCustomParametersFromXml(XmlElement* xml) {
         if (mainNode->hasAttribute("max_latency_ms")) {
             setMaxLatencyMs(mainNode->getIntAttribute("max_latency_ms"));
         }
+        if (mainNode->hasAttribute("max_batch_size")) {
+            setMaxBatchSize(mainNode->getIntAttribute("max_batch_size"));
+        }
+        if (mainNode->hasAttribute("queue_capacity")) {
+            setQueueCapacity(mainNode->getIntAttribute("queue_capacity"));
+        }
+        if (mainNode->hasAttribute("queue_capacity_in_bytes")) {
+            setQueueCapacityInBytes(mainNode->getBoolAttribute("queue_capacity_in_bytes"));
+        }
+        if (mainNode->hasAttribute("overflow_policy")) {
+            setOverflowPolicy((OverflowPolicy) mainNode->getIntAttribute("overflow_policy"));
+        }
+        if (mainNode->hasAttribute("overflow_block_timeout_ms")) {
+            setOverflowBlockTimeoutMs(mainNode->getIntAttribute("overflow_block_timeout_ms"));
+        }
         if (mainNode->hasAttribute("stream_name")) {
             setStreamName(mainNode->getStringAttribute("stream_name").toStdString());
         }
+        if (mainNode->hasAttribute("publish_all_streams")) {
+            setPublishAllStreams(mainNode->getBoolAttribute("publish_all_streams"));
+        }
+        if (mainNode->hasAttribute("stream_name_template")) {
+            setStreamNameTemplate(mainNode->getStringAttribute("stream_name_template").toStdString());
+        }
+        if (mainNode->hasAttribute("spool_directory")) {
+            setSpoolDirectory(mainNode->getStringAttribute("spool_directory").toStdString());
+        }
+        if (mainNode->hasAttribute("metrics_file")) {
+            setMetricsFile(mainNode->getStringAttribute("metrics_file").toStdString());
+        }
+        if (mainNode->hasAttribute("trace_file")) {
+            setTraceFile(mainNode->getStringAttribute("trace_file").toStdString());
+        }
+        if (mainNode->hasAttribute("publish_clock")) {
+            setPublishClock(mainNode->getBoolAttribute("publish_clock"));
+        }
+        if (mainNode->hasAttribute("clock_interval_ms")) {
+            setClockIntervalMs(mainNode->getIntAttribute("clock_interval_ms"));
+        }
         if (mainNode->hasAttribute("datastream_id")) {
             setDatastreamId(mainNode->getIntAttribute("datastream_id"));
         }
@@ -406,6 +1619,23 @@ void RiverOutput::loadCustomParametersFromXml(XmlElement* xml) {
         } else {
             clearEventSchema();
         }
+        setContinuousAsInt16(mainNode->getBoolAttribute("continuous_as_int16", false));
+        setContinuousCompressed(mainNode->getBoolAttribute("continuous_compressed", false));
+        setIncludeSpikeWaveform(mainNode->getBoolAttribute("include_spike_waveform", false));
+        setSpikeWaveformAsInt16(mainNode->getBoolAttribute("spike_waveform_as_int16", false));
+        if (!setSpikeChannelFilter(mainNode->getStringAttribute("spike_channel_filter").toStdString())) {
+            LOGC("Ignoring invalid spike channel filter: ", mainNode->getStringAttribute("spike_channel_filter"));
+        }
+        if (!setSpikeUnitFilter(mainNode->getStringAttribute("spike_unit_filter").toStdString())) {
+            LOGC("Ignoring invalid spike unit filter: ", mainNode->getStringAttribute("spike_unit_filter"));
+        }
+        setDropUnsortedSpikes(mainNode->getBoolAttribute("drop_unsorted_spikes", false));
+        setSpikeBinUnits(mainNode->getIntAttribute("spike_bin_units", 4));
+        setSpikeBinMs(mainNode->getIntAttribute("spike_bin_ms", 0));
+        if (mainNode->hasAttribute("decimation_factor")) {
+            setDecimationFactor(mainNode->getIntAttribute("decimation_factor"));
+        }
+        setConsumeContinuous(mainNode->getBoolAttribute("consume_continuous", false));
     }
 
     ((RiverOutputEditor *) editor.get())->refreshSchemaFromProcessor();
@@ -425,65 +1655,156 @@ void RiverOutput::clearEventSchema() {
 }
 
 bool RiverOutput::shouldConsumeSpikes() const {
-    return !event_schema_;
+    return !consume_continuous_ && !event_schema_;
 }
 
-river::StreamSchema RiverOutput::getSchema() const {
-    if (event_schema_) {
-        return *event_schema_;
-    }
-    return spike_schema_;
+void RiverOutput::setConsumeContinuous(bool consumeContinuous) {
+    consume_continuous_ = consumeContinuous;
+    ((RiverOutputEditor *) editor.get())->refreshSchemaFromProcessor();
 }
 
-/** Called when a parameter is updated*/
-void RiverOutput::parameterValueChanged(Parameter* param) {
-    if (editor) {
-        const MessageManagerLock mm;
-        ((RiverOutputEditor *) editor.get())->refreshLabelsFromProcessor();
+bool RiverOutput::shouldConsumeContinuous() const {
+    return consume_continuous_;
+}
+
+void RiverOutput::setContinuousAsInt16(bool asInt16) {
+    continuous_as_int16_ = asInt16;
+    updateContinuousSchema();
+    ((RiverOutputEditor *) editor.get())->refreshSchemaFromProcessor();
+}
+
+bool RiverOutput::continuousAsInt16() const {
+    return continuous_as_int16_;
+}
+
+void RiverOutput::setContinuousCompressed(bool compressed) {
+    continuous_compressed_ = compressed;
+    updateContinuousSchema();
+    ((RiverOutputEditor *) editor.get())->refreshSchemaFromProcessor();
+}
+
+bool RiverOutput::continuousCompressed() const {
+    return continuous_compressed_;
+}
+
+ContinuousEncodingStats RiverOutput::continuousEncodingStats() const {
+    ContinuousEncodingStats stats;
+    for (const auto &output: outputs_) {
+        stats.raw_bytes += output->raw_bytes.load(std::memory_order_relaxed);
+        stats.encoded_bytes += output->encoded_bytes.load(std::memory_order_relaxed);
+        stats.encode_time_ns.merge(output->encode_time_ns.snapshot());
     }
+    return stats;
 }
 
-RiverWriterThread::RiverWriterThread(river::StreamWriter *writer, int batch_period_ms)
-        : juce::Thread("RiverWriter") {
-    writer_ = writer;
-    batch_period_ms_ = batch_period_ms;
+void RiverOutput::setIncludeSpikeWaveform(bool includeWaveform) {
+    include_spike_waveform_ = includeWaveform;
+    updateSpikeSchema();
+    ((RiverOutputEditor *) editor.get())->refreshSchemaFromProcessor();
 }
 
-void RiverWriterThread::run() {
-    while (!threadShouldExit()) {
-        auto start = std::chrono::high_resolution_clock::now();
+bool RiverOutput::includeSpikeWaveform() const {
+    return include_spike_waveform_;
+}
 
-        // Send all events that are queued up
-        while (true) {
-            QueuedEvent event;
+void RiverOutput::setSpikeWaveformAsInt16(bool asInt16) {
+    spike_waveform_as_int16_ = asInt16;
+    updateSpikeSchema();
+    ((RiverOutputEditor *) editor.get())->refreshSchemaFromProcessor();
+}
 
-            // Only hold the lock while manipulating the queue, but not while sending via River
-            {
-                const std::lock_guard<std::mutex> lock(queue_mutex_);
-                if (queued_events_.empty()) {
-                    break;
-                }
-                event = queued_events_.front();
-                queued_events_.pop();
-            }
-            writer_->WriteBytes(event.raw_data.data(), event.num_samples);
-        }
+bool RiverOutput::spikeWaveformAsInt16() const {
+    return spike_waveform_as_int16_;
+}
 
-        // Check again pre-emptively so we can bail before sleeping
-        if (threadShouldExit()) {
-            break;
-        }
+bool RiverOutput::setSpikeChannelFilter(const std::string &spec) {
+    return spike_filter_.setChannels(spec);
+}
+
+bool RiverOutput::setSpikeUnitFilter(const std::string &spec) {
+    return spike_filter_.setUnits(spec);
+}
+
+void RiverOutput::setDropUnsortedSpikes(bool dropUnsorted) {
+    spike_filter_.setDropUnsorted(dropUnsorted);
+}
+
+const SpikeFilter &RiverOutput::spikeFilter() const {
+    return spike_filter_;
+}
+
+void RiverOutput::setSpikeBinMs(int binMs) {
+    spike_bin_ms_ = std::max(0, binMs);
+    updateSpikeSchema();
+    ((RiverOutputEditor *) editor.get())->refreshSchemaFromProcessor();
+}
+
+int RiverOutput::spikeBinMs() const {
+    return spike_bin_ms_;
+}
+
+void RiverOutput::setSpikeBinUnits(int numUnits) {
+    spike_bin_units_ = std::max(1, numUnits);
+    updateSpikeSchema();
+    ((RiverOutputEditor *) editor.get())->refreshSchemaFromProcessor();
+}
+
+int RiverOutput::spikeBinUnits() const {
+    return spike_bin_units_;
+}
+
+int64_t RiverOutput::spikesFiltered() const {
+    int64_t total = 0;
+    for (const auto &output: outputs_) {
+        total += output->num_filtered.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+int64_t RiverOutput::continuousValuesSaturated() const {
+    int64_t total = 0;
+    for (const auto &output: outputs_) {
+        total += output->num_saturated.load(std::memory_order_relaxed);
+    }
+    return total;
+}
 
-        // TODO: should be able to wake up here if someone clicks "stop" while this is sleeping
-        std::this_thread::sleep_until(start + std::chrono::milliseconds(batch_period_ms_));
+river::StreamSchema RiverOutput::getSchema() const {
+    if (consume_continuous_) {
+        return continuous_schema_;
+    }
+    if (event_schema_) {
+        return *event_schema_;
     }
+    return spike_schema_;
 }
 
-void RiverWriterThread::enqueue(const QueuedEvent& event) {
-    if (event.num_samples == 0) {
+/** Called when a parameter is updated*/
+void RiverOutput::parameterValueChanged(Parameter* param) {
+    if (param->getName() == "datastream_id" && !CoreServices::getAcquisitionStatus()) {
+        updateContinuousSchema();
+    }
+    if (!editor) {
+        return;
+    }
+    const bool refresh_schema = param->getName() == "datastream_id" && shouldConsumeContinuous();
+    if (MessageManager::getInstance()->isThisTheMessageThread()) {
+        ((RiverOutputEditor *) editor.get())->refreshLabelsFromProcessor();
+        if (refresh_schema) {
+            ((RiverOutputEditor *) editor.get())->refreshSchemaFromProcessor();
+        }
         return;
     }
 
-    const std::lock_guard<std::mutex> lock(queue_mutex_);
-    queued_events_.push(event);
+    // Changed from another thread (e.g. the processing thread, during acquisition), which shouldn't wait on the
+    // message thread; refresh the editor from there later instead. The running acquisition only sees its config.
+    Component::SafePointer<RiverOutputEditor> safe_editor((RiverOutputEditor *) editor.get());
+    MessageManager::callAsync([safe_editor, refresh_schema]() {
+        if (auto *e = safe_editor.getComponent()) {
+            e->refreshLabelsFromProcessor();
+            if (refresh_schema) {
+                e->refreshSchemaFromProcessor();
+            }
+        }
+    });
 }
@@ -26,40 +26,153 @@
 
 #include <ProcessorHeaders.h>
 #include <river/river.h>
+#include <chrono>
+#include "RiverWriterQueue.h"
+#include "RiverSpike.h"
+#include "SpikeFilter.h"
+#include "SpikeBinner.h"
+#include "RiverClock.h"
+#include "TtlPayload.h"
+#include "Int16Quantizer.h"
+#include "Int16BlockCodec.h"
+#include "PolyphaseDecimator.h"
+#include "Trace.h"
+
+/** One Open Ephys DataStream being published to one River stream */
+struct RiverStreamOutput {
+    uint16 stream_id = 0;
+
+    // River stream name.
+    std::string name;
+
+    // Only set when writing synchronously.
+    std::unique_ptr<river::StreamWriter> writer;
+
+    // Only set when writing asynchronously; the queue writes to River through the sink, which creates the stream's
+    // writer once Redis can be reached.
+    std::unique_ptr<RiverStreamSink> sink;
+    std::unique_ptr<RiverWriterQueue> queue;
+
+    /** nullptr if writing asynchronously and Redis hasn't been reached yet */
+    river::StreamWriter* riverWriter() const {
+        return sink ? sink->writer() : writer.get();
+    }
 
-typedef struct {
-    std::vector<char> raw_data;
-    int num_samples;
-} QueuedEvent;
-
-/** 
-
-    Writes data to the Redis database inside a thread
-
-*/
-class RiverWriterThread : public Thread 
-{
-public:
-
-    /** Constructor */
-    RiverWriterThread(river::StreamWriter *writer, int batch_period_ms);
-
-	/** Destructor */
-    ~RiverWriterThread() override = default;
-
-    /** Run thread */
-    void run() override;
-
-    /** Adds bytes to the writing queue */
-    void enqueue(const QueuedEvent& event);
+    // Values clipped by int16 export (continuous or spike waveforms). Written by process(), read by the editor.
+    std::atomic<int64_t> num_saturated{0};
+
+    // Spikes the spike filter kept out of the stream.
+    std::atomic<int64_t> num_filtered{0};
+
+    // Times process() allocated to grow one of the buffers below, e.g. for a bigger block than before. Read by the
+    // editor.
+    std::atomic<int64_t> num_allocations{0};
+
+    // Set if spikes are sent as binned counts instead. Processing thread only, until acquisition stops.
+    std::unique_ptr<SpikeBinner> binner;
+
+    // Continuous export only. Buffer indices of the stream's channels in schema order, their read pointers for the
+    // current block, and per-channel bitVolts and 1 / bitVolts (for int16). Sized on the message thread so
+    // process() doesn't allocate.
+    std::vector<int> channel_indices;
+    std::vector<const float*> channel_pointers;
+    std::vector<float> bit_volts;
+    std::vector<float> scales;
+
+    // Set if decimating. Its output planes are sized by the processing thread, which only allocates when a block
+    // yields more outputs than any before it.
+    std::unique_ptr<PolyphaseDecimator> decimator;
+    std::vector<std::vector<float>> decimated_planes;
+    std::vector<float*> decimated_pointers;
+    int decimated_length = 0;
+
+    // Compressed continuous export only: the block quantized to int16 frames, sized by the processing thread like
+    // the decimated planes, and how well encoding has done so far.
+    std::vector<int16_t> int16_frames;
+    std::atomic<int64_t> raw_bytes{0};
+    std::atomic<int64_t> encoded_bytes{0};
+    Log2Histogram encode_time_ns;
+
+    // Used to interleave frames, or encode blocks, when writing synchronously.
+    std::vector<char> frames;
+
+    // Set if publishing a clock stream alongside (see RiverOutput::publishClock()): its own output, and which
+    // blocks it samples. The sampler is processing thread only, until acquisition stops.
+    std::unique_ptr<RiverStreamOutput> clock;
+    std::unique_ptr<ClockSampler> clock_sampler;
+};
 
-private:
-    std::queue<QueuedEvent> queued_events_;
-    std::mutex queue_mutex_;
+/** How well compressed continuous export is doing, summed across every stream */
+struct ContinuousEncodingStats {
+    // The blocks as uncompressed int16 frames, and as encoded chunks (padding included).
+    int64_t raw_bytes = 0;
+    int64_t encoded_bytes = 0;
+    // Per block, quantization included.
+    HistogramSnapshot encode_time_ns;
+
+    /** Raw bytes per encoded byte; 0 before anything has been encoded */
+    double ratio() const {
+        return encoded_bytes > 0 ? (double) raw_bytes / (double) encoded_bytes : 0.0;
+    }
+};
 
-    int batch_period_ms_;
+/**
+ * Every setting process(), handleSpike() and handleTTLEvent() depend on, fixed for one acquisition. Built on the
+ * message thread when acquisition starts and published through an atomic pointer, so the processing thread reads
+ * settings without locks, parameter lookups or allocation, and never sees a half-applied change.
+ */
+struct RiverOutputConfig {
+    enum class Input { SPIKES, EVENTS, CONTINUOUS };
+    Input input = Input::SPIKES;
+
+    // Every output, and the outputs indexed by DataStream ID, nullptr for DataStreams that aren't published. When
+    // publishing a single stream, that's every DataStream but the selected one: its sample numbers are the only
+    // ones that line up with its bins and clock.
+    std::vector<RiverStreamOutput*> outputs;
+    std::vector<RiverStreamOutput*> outputs_by_stream_id;
+    // Whether any output has a clock stream.
+    bool clocks = false;
+
+    bool continuous_as_int16 = false;
+    bool continuous_compressed = false;
+
+    // Per TTL event channel whose metadata fits the event schema, planned when acquisition starts. Events from
+    // any other channel are ignored.
+    struct EventLayout {
+        const EventChannel* channel;
+        TtlSampleLayout layout;
+    };
+    std::vector<EventLayout> event_layouts;
+
+    // Size of one spike sample (or bin), and how waveforms are laid out in it; waveform_bytes is 0 if they aren't
+    // sent.
+    size_t spike_sample_size = 0;
+    size_t spike_waveform_bytes = 0;
+    bool spike_waveform_as_int16 = false;
+    int spike_waveform_num_electrodes = 0;
+    int spike_waveform_num_samples = 0;
+    float spike_waveform_scale = 1.0f;
+
+    SpikeFilter spike_filter;
+    // Bins are sent once the block being processed is this many samples past their end, since spikes are only
+    // detected once their whole waveform has been seen.
+    int64_t spike_bin_lag_samples = 0;
+
+    /** Where data from a DataStream goes, or nullptr if it isn't being published */
+    RiverStreamOutput* outputFor(uint16 stream_id) const {
+        return stream_id < outputs_by_stream_id.size() ? outputs_by_stream_id[stream_id] : nullptr;
+    }
 
-    river::StreamWriter* writer_;
+    /** How an event channel's events are written, or nullptr if they aren't */
+    const TtlSampleLayout* eventLayoutFor(const EventChannel* channel) const {
+        // Only a handful of channels, so a scan beats hashing.
+        for (const auto& event_layout: event_layouts) {
+            if (event_layout.channel == channel) {
+                return &event_layout.layout;
+            }
+        }
+        return nullptr;
+    }
 };
 
 /**
@@ -125,10 +238,89 @@ public:
     void clearEventSchema();
     bool shouldConsumeSpikes() const;
 
+    /** Streams the selected datastream's continuous channels instead of spikes or events, if set */
+    void setConsumeContinuous(bool consumeContinuous);
+    bool shouldConsumeContinuous() const;
+
+    /** Exports continuous channels as int16 (scaled by 1 / bitVolts) instead of float, halving bandwidth */
+    void setContinuousAsInt16(bool asInt16);
+    bool continuousAsInt16() const;
+
+    /**
+     * Quantizes continuous channels to int16 and compresses each block losslessly (see encodeInt16Block()) into a
+     * run of kEncodedChunkBytes-wide samples, instead of one sample per frame. Takes precedence over
+     * continuousAsInt16().
+     */
+    void setContinuousCompressed(bool compressed);
+    bool continuousCompressed() const;
+
+    /** During this (or the last) acquisition; all zero unless compressing */
+    ContinuousEncodingStats continuousEncodingStats() const;
+
+    // Width of each sample of a compressed continuous stream. Encoded blocks start on a sample and are zero-padded
+    // to a whole number of them.
+    static constexpr int kEncodedChunkBytes = 256;
+
+    // Each stream's write queue is allocated up front: 64 MB unless set otherwise, and never more than 1 GB.
+    static constexpr int kDefaultQueueCapacityBytes = 64 << 20;
+    static constexpr size_t kMaxQueueCapacityBytes = (size_t) 1 << 30;
+
+    /** Appends each spike's waveform (all electrodes of its SpikeChannel) to the spike schema, if set */
+    void setIncludeSpikeWaveform(bool includeWaveform);
+    bool includeSpikeWaveform() const;
+
+    /** Quantizes spike waveforms to int16 (scaled by 1 / bitVolts) instead of sending them as float */
+    void setSpikeWaveformAsInt16(bool asInt16);
+    bool spikeWaveformAsInt16() const;
+
+    /**
+     * Which spikes are published, by spike channel index and unit; see SpikeFilter. The list setters return false
+     * (leaving the filter as it was) if spec isn't valid. Changes apply from the next acquisition.
+     */
+    bool setSpikeChannelFilter(const std::string& spec);
+    bool setSpikeUnitFilter(const std::string& spec);
+    void setDropUnsortedSpikes(bool dropUnsorted);
+    const SpikeFilter& spikeFilter() const;
+
+    /** Number of spikes kept out by the spike filter during this (or the last) acquisition */
+    int64_t spikesFiltered() const;
+
+    /**
+     * If positive, spikes are counted per (spike channel, unit) in bins of this many ms, aligned to sample numbers,
+     * and each bin is sent as one sample (see updateSpikeSchema()) instead of one sample per spike.
+     */
+    void setSpikeBinMs(int binMs);
+    int spikeBinMs() const;
+
+    /** Units counted per spike channel when binning, from 0 (unsorted); spikes of higher units are dropped */
+    void setSpikeBinUnits(int numUnits);
+    int spikeBinUnits() const;
+
+    /** Number of values (continuous or waveform) clipped to the int16 range during this (or the last) acquisition */
+    int64_t continuousValuesSaturated() const;
+
     river::StreamSchema getSchema() const;
 
     std::string streamName();
     int64_t totalSamplesWritten() const;
+    /**
+     * Rate over the last second at which the processing thread allocated memory, binned spike counts included;
+     * 0 in steady state. Message thread only.
+     */
+    double processingAllocationsPerSecond();
+    DropCounts dropCounts() const;
+
+    /** Summed across every stream, during this (or the last) acquisition */
+    SpoolStats spoolStats() const;
+
+    /**
+     * Across every stream, during this (or the last) acquisition. Reconnect counts are summed; since the streams
+     * share one Redis server, outage durations are those of the worst-off stream.
+     */
+    ConnectionStats connectionStats() const;
+
+    /** Merged across every stream (see WriterMetrics::merge()), during this (or the last) acquisition */
+    WriterMetrics writerMetrics() const;
 
     int maxBatchSize() {
         return getParameter("max_batch_size")->getValue();
@@ -157,25 +349,255 @@ public:
         return getParameter("max_latency_ms")->setNextValue(maxLatencyMs);
     }
 
+    /** Queue capacity, in units of queueCapacityInBytes() ? bytes : samples */
+    int queueCapacity() {
+        return getParameter("queue_capacity")->getValue();
+    }
+
+    void setQueueCapacity(int queueCapacity) {
+        getParameter("queue_capacity")->setNextValue(queueCapacity);
+    }
+
+    bool queueCapacityInBytes() {
+        return (int) getParameter("queue_capacity_unit")->getValue() == 1;
+    }
+
+    void setQueueCapacityInBytes(bool inBytes) {
+        getParameter("queue_capacity_unit")->setNextValue(inBytes ? 1 : 0);
+    }
+
+    OverflowPolicy overflowPolicy() {
+        return (OverflowPolicy) (int) getParameter("overflow_policy")->getValue();
+    }
+
+    void setOverflowPolicy(OverflowPolicy policy) {
+        getParameter("overflow_policy")->setNextValue((int) policy);
+    }
+
+    int overflowBlockTimeoutMs() {
+        return getParameter("overflow_block_timeout_ms")->getValue();
+    }
+
+    void setOverflowBlockTimeoutMs(int timeoutMs) {
+        getParameter("overflow_block_timeout_ms")->setNextValue(timeoutMs);
+    }
+
+    /** Continuous data is low-pass filtered and downsampled by this factor; 1 disables decimation */
+    int decimationFactor() {
+        return getParameter("decimation_factor")->getValue();
+    }
+
+    void setDecimationFactor(int factor) {
+        getParameter("decimation_factor")->setNextValue(factor);
+    }
+
+    /**
+     * Where to spool batches while River can't take them, one file per River stream; empty disables spooling, so
+     * those batches are dropped. Only used when writing asynchronously.
+     */
+    std::string spoolDirectory() {
+        return getParameter("spool_directory")->getValueAsString().toStdString();
+    }
+
+    void setSpoolDirectory(const std::string &directory) {
+        getParameter("spool_directory")->setNextValue(juce::String(directory));
+    }
+
+    /** Local file that writerMetrics() are published to as JSON every second while acquiring; empty disables */
+    std::string metricsFile() {
+        return getParameter("metrics_file")->getValueAsString().toStdString();
+    }
+
+    void setMetricsFile(const std::string &path) {
+        getParameter("metrics_file")->setNextValue(juce::String(path));
+    }
+
+    // How often the metrics file is updated.
+    static constexpr int kMetricsIntervalMs = 1000;
+
+    /**
+     * If set, the processing and writer threads are traced during acquisition (see Tracer), and the trace is
+     * written to this file in Chrome trace format when acquisition stops; empty disables tracing.
+     */
+    std::string traceFile() {
+        return getParameter("trace_file")->getValueAsString().toStdString();
+    }
+
+    void setTraceFile(const std::string &path) {
+        getParameter("trace_file")->setNextValue(juce::String(path));
+    }
+
+    /**
+     * If set, each River stream gets a companion stream named "<stream>.clock" of RiverClockSample, mapping the
+     * DataStream's sample numbers to the host's steady and system clocks, so consumers can timestamp samples by
+     * interpolating.
+     */
+    bool publishClock() {
+        return getParameter("publish_clock")->getValue();
+    }
+
+    void setPublishClock(bool publish) {
+        getParameter("publish_clock")->setNextValue(publish);
+    }
+
+    /** At most one clock sample per this many ms; 0 sends one every block */
+    int clockIntervalMs() {
+        return getParameter("clock_interval_ms")->getValue();
+    }
+
+    void setClockIntervalMs(int intervalMs) {
+        getParameter("clock_interval_ms")->setNextValue(intervalMs);
+    }
+
+    // Appended to a River stream's name to name its clock stream.
+    static constexpr const char* kClockStreamSuffix = ".clock";
+
+    /** Publishes every DataStream to its own River stream, named by streamNameTemplate(), if set */
+    bool publishAllStreams() {
+        return getParameter("publish_all_streams")->getValue();
+    }
+
+    void setPublishAllStreams(bool publishAll) {
+        getParameter("publish_all_streams")->setNextValue(publishAll);
+    }
+
+    /** River stream name per DataStream when publishing all streams; see riverStreamNameFor() */
+    std::string streamNameTemplate() {
+        return getParameter("stream_name_template")->getValueAsString().toStdString();
+    }
+
+    void setStreamNameTemplate(const std::string &nameTemplate) {
+        getParameter("stream_name_template")->setNextValue(juce::String(nameTemplate));
+    }
+
+    /**
+     * Expands {stream_name} (the River stream name), {oe_stream} (the DataStream's name, whitespace replaced with
+     * underscores) and {oe_stream_id} in streamNameTemplate().
+     */
+    std::string riverStreamNameFor(const DataStream* stream);
+
 private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RiverOutput)
 
-    // For writing spikes to River. Ensure it's packed so that padding doesn't mess up the size of the struct.
-    typedef struct {
-        int32_t channel_index;
-        int32_t unit_index;
-        int64_t sample_number;
-    } __attribute__((__packed__)) RiverSpike;
+    // RiverSpike, optionally followed by a fixed-width waveform field. When binning, bin_start_sample_number and a
+    // fixed-width field of uint16 counts, spike channel-major (counts[channel * spike_bin_units_ + unit]).
+    river::StreamSchema spike_schema_;
+
+    /** Regenerates spike_schema_ and the waveform dimensions from the spike channels */
+    void updateSpikeSchema();
+
+    /** Size of the waveform field, 0 if there are no spike channels */
+    size_t spikeWaveformBytes() const;
+
+    /** Copies (or quantizes) a spike's waveform into its slot in the spike frame. Returns the number of values
+     * clipped to int16. */
+    static int64_t writeSpikeWaveform(const RiverOutputConfig& config, const Spike& spike, char* dst);
 
-    const river::StreamSchema spike_schema_;
+    bool include_spike_waveform_;
+    bool spike_waveform_as_int16_;
+    int spike_waveform_num_electrodes_;
+    int spike_waveform_num_samples_;
+    float spike_waveform_bit_volts_;
+    float spike_waveform_scale_;
+
+    // As edited; handleSpike() uses the copy in the config.
+    SpikeFilter spike_filter_;
+
+    // Binned spike counts; spike_bin_ms_ <= 0 disables binning.
+    int spike_bin_ms_;
+    int spike_bin_units_;
+
+    /** Sends one bin of spike counts */
+    void writeSpikeBin(const RiverOutputConfig& config,
+                       RiverStreamOutput& output,
+                       int64_t bin_start_sample_number,
+                       const uint16_t* counts);
+
+    /** Sends every bin of every output that's ready (or all of them, once acquisition has stopped) */
+    void writeSpikeBins(const RiverOutputConfig& config, bool all);
 
     // If this is set, then we should listen to events, not spikes.
     std::shared_ptr<river::StreamSchema> event_schema_;
 
-    std::unique_ptr<river::StreamWriter> writer_;
-    std::unique_ptr<RiverWriterThread> writing_thread_;
-
-    std::unordered_map<int, std::string> stream_id_to_stream_names;
+    // If set, takes precedence over spikes/events: one float (or int16) field per continuous channel, then
+    // sample_number.
+    bool consume_continuous_;
+    bool continuous_as_int16_;
+    bool continuous_compressed_;
+    river::StreamSchema continuous_schema_;
+
+    /** The DataStream matching datastream_id(), or nullptr */
+    const DataStream* selectedDataStream();
+
+    /** Regenerates continuous_schema_ from the selected datastream */
+    void updateContinuousSchema();
+
+    /** Schema for a DataStream's continuous channels. Also fills in output's channel lookups, if given. */
+    river::StreamSchema continuousSchemaFor(const DataStream* stream, RiverStreamOutput* output) const;
+
+    /** Schema for a DataStream, depending on the input type */
+    river::StreamSchema schemaFor(const DataStream* stream) const;
+
+    /** Interleaves a DataStream's channels for this block into frames and queues them */
+    void writeContinuousBlock(const RiverOutputConfig& config,
+                              const AudioSampleBuffer& buffer,
+                              RiverStreamOutput& output);
+
+    /** Quantizes and encodes one block of planar samples, and queues (or writes) it as chunks */
+    void writeEncodedBlock(RiverStreamOutput& output,
+                           const float* const* planes,
+                           int num_samples,
+                           int64 first_sample_number,
+                           int sample_step);
+
+    /**
+     * Plans how each TTL event channel's events become samples of the event schema (see TtlSampleLayout), only
+     * for the selected datastream unless publishing all streams. Channels that don't fit are logged and left out.
+     */
+    std::vector<RiverOutputConfig::EventLayout> planEventLayouts(bool publishing_all_streams);
+
+    /**
+     * Creates output's River stream: through a sink and queue when writing asynchronously, which keep retrying
+     * (setting *unreachable) if Redis can't be reached yet, or else a writer, which has to connect now. Returns
+     * false, after telling the user why, if the writer can't connect or the queue can't be allocated.
+     */
+    bool openOutput(RiverStreamOutput& output,
+                    const river::RedisConnection& connection,
+                    const river::StreamSchema& schema,
+                    const std::unordered_map<std::string, std::string>& metadata,
+                    bool* unreachable);
+
+    /** Sends a clock sample for every output whose clock stream is due one this block */
+    void writeClockSamples(const RiverOutputConfig& config);
+
+    /** Snapshots the settings for the outputs just created; see RiverOutputConfig */
+    std::unique_ptr<RiverOutputConfig> buildConfig() const;
+
+    /** Stops and clears every output */
+    void clearOutputs();
+
+    // One per published DataStream, for the current (or last) acquisition. Kept after stopping so that
+    // totalSamplesWritten() (and maybe other methods) stay valid.
+    std::vector<std::unique_ptr<RiverStreamOutput>> outputs_;
+
+    // The current (or last) acquisition's settings. config_ is what the processing thread loads; it's only
+    // republished (and the old snapshot freed) once processing has stopped, in clearOutputs().
+    std::unique_ptr<const RiverOutputConfig> owned_config_;
+    std::atomic<const RiverOutputConfig*> config_;
+
+    std::unique_ptr<RiverWriterPool> writer_pool_;
+    std::unique_ptr<MetricsFilePublisher> metrics_publisher_;
+
+    // Drop counts, spool and connection stats and metrics of the last acquisition, kept around after the writer pool is gone.
+    DropCounts last_drop_counts_;
+    SpoolStats last_spool_stats_;
+    ConnectionStats last_connection_stats_;
+    WriterMetrics last_writer_metrics_;
+
+    // For processingAllocationsPerSecond(). Message thread only.
+    int64_t last_num_allocations_ = 0;
+    std::chrono::steady_clock::time_point last_allocation_check_;
+    double allocations_per_second_ = 0;
 };
 
 
@@ -24,6 +24,17 @@
 #include "RiverOutputEditor.h"
 #include "SchemaListBox.h"
 
+namespace {
+
+/** "p50 / p99 / max" of a histogram of microseconds, in ms */
+juce::String percentilesInMs(const HistogramSnapshot& histogram) {
+    return juce::String(histogram.percentile(0.5) / 1000.0, 1) + " / "
+           + juce::String(histogram.percentile(0.99) / 1000.0, 1) + " / "
+           + juce::String(histogram.max / 1000.0, 1);
+}
+
+}  // namespace
+
 RiverOutputEditor::RiverOutputEditor(GenericProcessor *parentNode)
         : VisualizerEditor(parentNode, "River Output", 220) {
 
@@ -86,18 +97,126 @@ RiverOutputEditor::RiverOutputEditor(GenericProcessor *parentNode)
     inputTypeSpikeButton->addListener(this);
     optionsPanel->addAndMakeVisible(inputTypeSpikeButton);
 
+    /* -------- Radio group #1: Continuous --------- */
+
+    inputTypeContinuousButton = new ToggleButton("Continuous");
+    inputTypeContinuousButton->setRadioGroupId(inputTypeRadioId, dontSendNotification);
+    inputTypeContinuousButton->setBounds(xPos + 160, yPos, 150, C_TEXT_HT);
+    inputTypeContinuousButton->setToggleState(false, dontSendNotification);
+    inputTypeContinuousButton->setTooltip("Emit the selected OpenEphys stream's continuous data to River, "
+                                          "one field per channel");
+    inputTypeContinuousButton->addListener(this);
+    optionsPanel->addAndMakeVisible(inputTypeContinuousButton);
+
     /* -------- Radio group #1: Events (with TTL Schema) --------- */
 
     yPos += 40;
 
     inputTypeEventButton = new ToggleButton("Events");
     inputTypeEventButton->setRadioGroupId(inputTypeRadioId, dontSendNotification);
-    inputTypeEventButton->setBounds(xPos, yPos, 340, C_TEXT_HT);
+    inputTypeEventButton->setBounds(xPos, yPos, 150, C_TEXT_HT);
     inputTypeEventButton->setToggleState(false, dontSendNotification);
     inputTypeEventButton->setTooltip("Emit custom events to River with a given schema");
     inputTypeEventButton->addListener(this);
     optionsPanel->addAndMakeVisible(inputTypeEventButton);
 
+    // Not part of the radio group; only applies to Continuous.
+    continuousAsInt16Button = new ToggleButton("as int16");
+    continuousAsInt16Button->setBounds(xPos + 180, yPos, 130, C_TEXT_HT);
+    continuousAsInt16Button->setToggleState(false, dontSendNotification);
+    continuousAsInt16Button->setTooltip("Export continuous data as int16 scaled by each channel's bit volts, "
+                                        "instead of float. Halves the bandwidth; out of range values saturate.");
+    continuousAsInt16Button->addListener(this);
+    optionsPanel->addAndMakeVisible(continuousAsInt16Button);
+
+    continuousCompressedButton = new ToggleButton("compressed");
+    continuousCompressedButton->setBounds(xPos + 300, yPos, 130, C_TEXT_HT);
+    continuousCompressedButton->setToggleState(false, dontSendNotification);
+    continuousCompressedButton->setTooltip("Quantize continuous data to int16 and compress each block losslessly "
+                                           "(delta + zigzag + bit packing per channel). Decode it with "
+                                           "Resources/scripts/decode_continuous.py.");
+    continuousCompressedButton->addListener(this);
+    optionsPanel->addAndMakeVisible(continuousCompressedButton);
+
+    /* -------- Spike waveform options --------- */
+
+    yPos += 40;
+
+    spikeWaveformButton = new ToggleButton("Spike waveforms");
+    spikeWaveformButton->setBounds(xPos, yPos, 170, C_TEXT_HT);
+    spikeWaveformButton->setToggleState(false, dontSendNotification);
+    spikeWaveformButton->setTooltip("Include each spike's waveform, all electrodes of its spike channel, "
+                                    "as a fixed-width field in the spike schema");
+    spikeWaveformButton->addListener(this);
+    optionsPanel->addAndMakeVisible(spikeWaveformButton);
+
+    spikeWaveformAsInt16Button = new ToggleButton("as int16");
+    spikeWaveformAsInt16Button->setBounds(xPos + 180, yPos, 130, C_TEXT_HT);
+    spikeWaveformAsInt16Button->setToggleState(false, dontSendNotification);
+    spikeWaveformAsInt16Button->setTooltip("Quantize spike waveforms to int16, scaled by the bit volts of the "
+                                           "spike channel's first electrode, instead of sending them as float.");
+    spikeWaveformAsInt16Button->addListener(this);
+    optionsPanel->addAndMakeVisible(spikeWaveformAsInt16Button);
+
+    /* -------- Spike filter --------- */
+
+    yPos += 40;
+
+    spikeChannelFilterLabel = newStaticLabel("Spike Channels", xPos, yPos, 150, C_TEXT_HT, optionsPanel);
+    spikeChannelFilterLabelValue = newInputLabel("spikeChannelFilterLabelValue",
+                                                 "Only publish spikes on these spike channel indices, e.g. "
+                                                 "0-31,40. Leave empty for every channel.",
+                                                 xPos,
+                                                 yPos + LABEL_VALUE_GAP,
+                                                 150,
+                                                 C_TEXT_HT,
+                                                 optionsPanel);
+    spikeChannelFilterLabelValue->addListener(this);
+
+    spikeUnitFilterLabel = newStaticLabel("Spike Units", xPos + 160, yPos, 150, C_TEXT_HT, optionsPanel);
+    spikeUnitFilterLabelValue = newInputLabel("spikeUnitFilterLabelValue",
+                                              "Only publish spikes sorted into these units, e.g. 1-4. Leave empty "
+                                              "for every unit.",
+                                              xPos + 160,
+                                              yPos + LABEL_VALUE_GAP,
+                                              100,
+                                              C_TEXT_HT,
+                                              optionsPanel);
+    spikeUnitFilterLabelValue->addListener(this);
+
+    dropUnsortedSpikesButton = new ToggleButton("Drop unsorted");
+    dropUnsortedSpikesButton->setBounds(xPos + 270, yPos + LABEL_VALUE_GAP, 130, C_TEXT_HT);
+    dropUnsortedSpikesButton->setToggleState(false, dontSendNotification);
+    dropUnsortedSpikesButton->setTooltip("Don't publish unsorted spikes (unit 0), even if the unit list has 0.");
+    dropUnsortedSpikesButton->addListener(this);
+    optionsPanel->addAndMakeVisible(dropUnsortedSpikesButton);
+
+    yPos += 60;
+
+    spikeBinMsLabel = newStaticLabel("Spike Bin (ms)", xPos, yPos, 150, C_TEXT_HT, optionsPanel);
+    spikeBinMsLabelValue = newInputLabel("spikeBinMsLabelValue",
+                                         "Send spike counts per spike channel and unit in bins of this many ms, "
+                                         "one sample per bin, instead of every spike. 0 sends every spike.",
+                                         xPos,
+                                         yPos + LABEL_VALUE_GAP,
+                                         100,
+                                         C_TEXT_HT,
+                                         optionsPanel);
+    spikeBinMsLabelValue->addListener(this);
+
+    spikeBinUnitsLabel = newStaticLabel("Units per Channel", xPos + 160, yPos, 150, C_TEXT_HT, optionsPanel);
+    spikeBinUnitsLabelValue = newInputLabel("spikeBinUnitsLabelValue",
+                                            "Units counted per spike channel when binning, starting from unit 0 "
+                                            "(unsorted). Spikes of higher units are dropped.",
+                                            xPos + 160,
+                                            yPos + LABEL_VALUE_GAP,
+                                            100,
+                                            C_TEXT_HT,
+                                            optionsPanel);
+    spikeBinUnitsLabelValue->addListener(this);
+
+    yPos += 20;
+
     yPos += 60;
 
     xPos = LEFT_EDGE;
@@ -153,6 +272,17 @@ RiverOutputEditor::RiverOutputEditor(GenericProcessor *parentNode)
                                              optionsPanel);
     asyncLatencyMsLabelValue->addListener(this);
 
+    xPos += asyncLatencyMsLabel->getBounds().getWidth() + 20;
+    maxBatchSizeLabel = newStaticLabel("Max Batch Size", xPos, yPos, 140, C_TEXT_HT, optionsPanel);
+    maxBatchSizeLabelValue = newInputLabel("maxBatchSizeLabelValue",
+                                           "Maximum number of samples sent to River in a single write.",
+                                           xPos,
+                                           yPos + LABEL_VALUE_GAP,
+                                           100,
+                                           C_TEXT_HT,
+                                           optionsPanel);
+    maxBatchSizeLabelValue->addListener(this);
+
     xPos = LEFT_EDGE;
     yPos += 60;
     schemaList = new SchemaListBox();
@@ -172,6 +302,18 @@ RiverOutputEditor::RiverOutputEditor(GenericProcessor *parentNode)
                                           18,
                                           optionsPanel);
     streamNameLabelValue->addListener(this);
+
+    streamNameTemplateLabel = newStaticLabel("Name Template", xPos + 210, yPos, 150, 20, optionsPanel);
+    streamNameTemplateLabelValue = newInputLabel("streamNameTemplateLabelValue",
+                                                 "River stream name for each datastream when publishing all "
+                                                 "streams. {stream_name} is the stream name, {oe_stream} the "
+                                                 "datastream's name and {oe_stream_id} its ID.",
+                                                 xPos + 210,
+                                                 yPos + LABEL_VALUE_GAP,
+                                                 200,
+                                                 18,
+                                                 optionsPanel);
+    streamNameTemplateLabelValue->addListener(this);
     yPos += 60;
 
     // Dropdown for which stream to watch
@@ -182,6 +324,13 @@ RiverOutputEditor::RiverOutputEditor(GenericProcessor *parentNode)
     oeStreamNameComboBox->addListener(this);
     optionsPanel->addAndMakeVisible(oeStreamNameComboBox);
 
+    publishAllStreamsButton = new ToggleButton("All streams");
+    publishAllStreamsButton->setBounds(xPos + 110, yPos + LABEL_VALUE_GAP, 150, C_TEXT_HT);
+    publishAllStreamsButton->setTooltip("Publish every OpenEphys stream to its own River stream, named by the "
+                                        "name template, instead of only the selected one");
+    publishAllStreamsButton->addListener(this);
+    optionsPanel->addAndMakeVisible(publishAllStreamsButton);
+
     yPos += 60;
     totalSamplesWrittenLabel = newStaticLabel("Samples Written", xPos, yPos, 150, 20, optionsPanel);
     totalSamplesWrittenLabelValue = newStaticLabel("0",
@@ -191,6 +340,223 @@ RiverOutputEditor::RiverOutputEditor(GenericProcessor *parentNode)
                                                    18,
                                                    optionsPanel);
 
+    samplesDroppedLabel = newStaticLabel("Samples Dropped", xPos + 160, yPos, 150, 20, optionsPanel);
+    samplesDroppedLabel->setTooltip("Samples dropped because the queue was full (newest / oldest / block timed out), "
+                                    "or River was unreachable and they couldn't be spooled");
+    samplesDroppedLabelValue = newStaticLabel("0 / 0 / 0 / 0",
+                                              xPos + 160,
+                                              yPos + LABEL_VALUE_GAP,
+                                              160,
+                                              18,
+                                              optionsPanel);
+
+    yPos += 60;
+    allocationsPerSecondLabel = newStaticLabel("Allocations/s", xPos, yPos, 150, 20, optionsPanel);
+    allocationsPerSecondLabel->setTooltip(
+            "Rate at which the processing thread allocates memory, e.g. for a bigger block than before; "
+            "0 in steady state");
+    allocationsPerSecondLabelValue = newStaticLabel("0",
+                                                    xPos,
+                                                    yPos + LABEL_VALUE_GAP,
+                                                    120,
+                                                    18,
+                                                    optionsPanel);
+
+    valuesSaturatedLabel = newStaticLabel("Values Saturated", xPos + 160, yPos, 150, 20, optionsPanel);
+    valuesSaturatedLabel->setTooltip("Continuous or spike waveform values clipped to the int16 range, when exporting as int16");
+    valuesSaturatedLabelValue = newStaticLabel("0",
+                                               xPos + 160,
+                                               yPos + LABEL_VALUE_GAP,
+                                               120,
+                                               18,
+                                               optionsPanel);
+
+    yPos += 60;
+    spooledLabel = newStaticLabel("Spooled", xPos, yPos, 150, 20, optionsPanel);
+    spooledLabel->setTooltip("Data written to the spool directory while River was unreachable: "
+                             "waiting to be replayed, and samples replayed / spooled");
+    spooledLabelValue = newStaticLabel("0.0 MB, 0 / 0",
+                                       xPos,
+                                       yPos + LABEL_VALUE_GAP,
+                                       150,
+                                       18,
+                                       optionsPanel);
+
+    reconnectsLabel = newStaticLabel("Reconnects", xPos + 160, yPos, 150, 20, optionsPanel);
+    reconnectsLabel->setTooltip("Times the connection to Redis came back after being lost, and the total time "
+                                "without one. The writer retries with exponential backoff.");
+    reconnectsLabelValue = newStaticLabel("0",
+                                          xPos + 160,
+                                          yPos + LABEL_VALUE_GAP,
+                                          160,
+                                          18,
+                                          optionsPanel);
+
+    yPos += 60;
+    queueDepthLabel = newStaticLabel("Queue Depth", xPos, yPos, 150, 20, optionsPanel);
+    queueDepthLabel->setTooltip("Bytes waiting to be written: now / most so far / capacity, for the fullest stream");
+    queueDepthLabelValue = newStaticLabel("0 / 0 / 0",
+                                          xPos,
+                                          yPos + LABEL_VALUE_GAP,
+                                          150,
+                                          18,
+                                          optionsPanel);
+
+    throughputLabel = newStaticLabel("Throughput", xPos + 160, yPos, 150, 20, optionsPanel);
+    throughputLabel->setTooltip("Bytes written to River per second, across every stream");
+    throughputLabelValue = newStaticLabel("0.00 MB/s",
+                                          xPos + 160,
+                                          yPos + LABEL_VALUE_GAP,
+                                          150,
+                                          18,
+                                          optionsPanel);
+
+    yPos += 60;
+    flushLatencyLabel = newStaticLabel("Flush Latency (ms)", xPos, yPos, 150, 20, optionsPanel);
+    flushLatencyLabel->setTooltip("Age of each batch's oldest sample once written to River: p50 / p99 / max");
+    flushLatencyLabelValue = newStaticLabel("0 / 0 / 0",
+                                            xPos,
+                                            yPos + LABEL_VALUE_GAP,
+                                            150,
+                                            18,
+                                            optionsPanel);
+
+    writeDurationLabel = newStaticLabel("Write Time (ms)", xPos + 160, yPos, 150, 20, optionsPanel);
+    writeDurationLabel->setTooltip("Time each River write takes: p50 / p99 / max");
+    writeDurationLabelValue = newStaticLabel("0 / 0 / 0",
+                                             xPos + 160,
+                                             yPos + LABEL_VALUE_GAP,
+                                             150,
+                                             18,
+                                             optionsPanel);
+
+    yPos += 60;
+    batchSizeLabel = newStaticLabel("Batch Size", xPos, yPos, 150, 20, optionsPanel);
+    batchSizeLabel->setTooltip("Samples per River write: p50 / p99 / max");
+    batchSizeLabelValue = newStaticLabel("0 / 0 / 0",
+                                         xPos,
+                                         yPos + LABEL_VALUE_GAP,
+                                         150,
+                                         18,
+                                         optionsPanel);
+
+    metricsFileLabel = newStaticLabel("Metrics File", xPos + 160, yPos, 150, C_TEXT_HT, optionsPanel);
+    metricsFileLabelValue = newInputLabel("metricsFileLabelValue",
+                                          "JSON file these metrics are written to every second while acquiring, "
+                                          "for monitoring. Leave empty to disable.",
+                                          xPos + 160,
+                                          yPos + LABEL_VALUE_GAP,
+                                          200,
+                                          C_TEXT_HT,
+                                          optionsPanel);
+    metricsFileLabelValue->addListener(this);
+
+    yPos += 60;
+    traceFileLabel = newStaticLabel("Trace File", xPos, yPos, 150, C_TEXT_HT, optionsPanel);
+    traceFileLabelValue = newInputLabel("traceFileLabelValue",
+                                        "Chrome trace JSON file the processing and writer threads' timings are "
+                                        "written to when acquisition stops. Leave empty to disable tracing.",
+                                        xPos,
+                                        yPos + LABEL_VALUE_GAP,
+                                        200,
+                                        C_TEXT_HT,
+                                        optionsPanel);
+    traceFileLabelValue->addListener(this);
+
+    compressionLabel = newStaticLabel("Compression", xPos + 160, yPos, 150, 20, optionsPanel);
+    compressionLabel->setTooltip("Compressed continuous data: how many times smaller than int16 frames, and the "
+                                 "median time to encode a block");
+    compressionLabelValue = newStaticLabel("-",
+                                           xPos + 160,
+                                           yPos + LABEL_VALUE_GAP,
+                                           150,
+                                           18,
+                                           optionsPanel);
+
+    yPos += 60;
+    queueCapacityLabel = newStaticLabel("Queue Capacity", xPos, yPos, 150, C_TEXT_HT, optionsPanel);
+    queueCapacityLabelValue = newInputLabel("queueCapacityLabelValue",
+                                            "Max amount of data waiting to be written to River before the overflow "
+                                            "policy kicks in.",
+                                            xPos,
+                                            yPos + LABEL_VALUE_GAP,
+                                            100,
+                                            C_TEXT_HT,
+                                            optionsPanel);
+    queueCapacityLabelValue->addListener(this);
+    queueCapacityUnitComboBox = new ComboBox("Queue Capacity Unit");
+    queueCapacityUnitComboBox->setBounds(xPos + 110, yPos + LABEL_VALUE_GAP, 90, C_TEXT_HT);
+    queueCapacityUnitComboBox->addItem("samples", 1);
+    queueCapacityUnitComboBox->addItem("bytes", 2);
+    queueCapacityUnitComboBox->addListener(this);
+    optionsPanel->addAndMakeVisible(queueCapacityUnitComboBox);
+
+    yPos += 60;
+    overflowPolicyLabel = newStaticLabel("Overflow Policy", xPos, yPos, 150, C_TEXT_HT, optionsPanel);
+    overflowPolicyComboBox = new ComboBox("Overflow Policy");
+    overflowPolicyComboBox->setBounds(xPos, yPos + LABEL_VALUE_GAP, 120, C_TEXT_HT);
+    // Item IDs are OverflowPolicy + 1, since 0 isn't a valid ID.
+    overflowPolicyComboBox->addItem("Drop newest", (int) OverflowPolicy::DROP_NEWEST + 1);
+    overflowPolicyComboBox->addItem("Drop oldest", (int) OverflowPolicy::DROP_OLDEST + 1);
+    overflowPolicyComboBox->addItem("Block", (int) OverflowPolicy::BLOCK + 1);
+    overflowPolicyComboBox->setTooltip("What to do with new data when the queue is full. "
+                                       "Block stalls the signal chain for up to the block timeout.");
+    overflowPolicyComboBox->addListener(this);
+    optionsPanel->addAndMakeVisible(overflowPolicyComboBox);
+
+    overflowBlockTimeoutMsLabel = newStaticLabel("Block Timeout (ms)", xPos + 160, yPos, 150, C_TEXT_HT, optionsPanel);
+    overflowBlockTimeoutMsLabelValue = newInputLabel("overflowBlockTimeoutMsLabelValue",
+                                                     "Max time to wait for room in the queue before dropping data, "
+                                                     "when the overflow policy is Block.",
+                                                     xPos + 160,
+                                                     yPos + LABEL_VALUE_GAP,
+                                                     100,
+                                                     C_TEXT_HT,
+                                                     optionsPanel);
+    overflowBlockTimeoutMsLabelValue->addListener(this);
+
+    yPos += 60;
+    decimationFactorLabel = newStaticLabel("Decimation Factor", xPos, yPos, 150, C_TEXT_HT, optionsPanel);
+    decimationFactorLabelValue = newInputLabel("decimationFactorLabelValue",
+                                               "Continuous data is low-pass filtered and downsampled by this "
+                                               "factor before being sent to River. 1 sends every sample.",
+                                               xPos,
+                                               yPos + LABEL_VALUE_GAP,
+                                               100,
+                                               C_TEXT_HT,
+                                               optionsPanel);
+    decimationFactorLabelValue->addListener(this);
+
+    spoolDirectoryLabel = newStaticLabel("Spool Directory", xPos + 160, yPos, 150, C_TEXT_HT, optionsPanel);
+    spoolDirectoryLabelValue = newInputLabel("spoolDirectoryLabelValue",
+                                             "Directory to spool data to while River is unreachable, replayed once "
+                                             "it's back. Leave empty to drop that data instead.",
+                                             xPos + 160,
+                                             yPos + LABEL_VALUE_GAP,
+                                             200,
+                                             C_TEXT_HT,
+                                             optionsPanel);
+    spoolDirectoryLabelValue->addListener(this);
+
+    yPos += 60;
+    clockIntervalMsLabel = newStaticLabel("Clock Interval (ms)", xPos, yPos, 150, C_TEXT_HT, optionsPanel);
+    clockIntervalMsLabelValue = newInputLabel("clockIntervalMsLabelValue",
+                                              "How often to publish a (sample number, host clock) pair to the clock "
+                                              "stream. 0 publishes one every block.",
+                                              xPos,
+                                              yPos + LABEL_VALUE_GAP,
+                                              100,
+                                              C_TEXT_HT,
+                                              optionsPanel);
+    clockIntervalMsLabelValue->addListener(this);
+
+    publishClockButton = new ToggleButton("Clock stream");
+    publishClockButton->setBounds(xPos + 110, yPos + LABEL_VALUE_GAP, 150, C_TEXT_HT);
+    publishClockButton->setTooltip("Also publish <stream name>.clock, pairing sample numbers with the host's "
+                                   "steady and system clocks.");
+    publishClockButton->addListener(this);
+    optionsPanel->addAndMakeVisible(publishClockButton);
+
 
     // Update the bounds of the options panel to fit all of the components in it:
     juce::Rectangle<int> opBounds(0, 0, 1, 1);
@@ -200,6 +566,20 @@ RiverOutputEditor::RiverOutputEditor(GenericProcessor *parentNode)
             dynamic_cast<Component *>(inputTypeTitle.get()),
             dynamic_cast<Component *>(inputTypeSpikeButton.get()),
             dynamic_cast<Component *>(inputTypeEventButton.get()),
+            dynamic_cast<Component *>(inputTypeContinuousButton.get()),
+            dynamic_cast<Component *>(continuousAsInt16Button.get()),
+            dynamic_cast<Component *>(continuousCompressedButton.get()),
+            dynamic_cast<Component *>(spikeWaveformButton.get()),
+            dynamic_cast<Component *>(spikeWaveformAsInt16Button.get()),
+            dynamic_cast<Component *>(spikeChannelFilterLabel.get()),
+            dynamic_cast<Component *>(spikeChannelFilterLabelValue.get()),
+            dynamic_cast<Component *>(spikeUnitFilterLabel.get()),
+            dynamic_cast<Component *>(spikeUnitFilterLabelValue.get()),
+            dynamic_cast<Component *>(dropUnsortedSpikesButton.get()),
+            dynamic_cast<Component *>(spikeBinMsLabel.get()),
+            dynamic_cast<Component *>(spikeBinMsLabelValue.get()),
+            dynamic_cast<Component *>(spikeBinUnitsLabel.get()),
+            dynamic_cast<Component *>(spikeBinUnitsLabelValue.get()),
             dynamic_cast<Component *>(fieldNameLabel.get()),
             dynamic_cast<Component *>(fieldNameLabelValue.get()),
             dynamic_cast<Component *>(fieldTypeLabel.get()),
@@ -209,12 +589,57 @@ RiverOutputEditor::RiverOutputEditor(GenericProcessor *parentNode)
             dynamic_cast<Component *>(schemaList.get()),
             dynamic_cast<Component *>(oeStreamNameLabel.get()),
             dynamic_cast<Component *>(oeStreamNameComboBox.get()),
+            dynamic_cast<Component *>(publishAllStreamsButton.get()),
+            dynamic_cast<Component *>(streamNameTemplateLabel.get()),
+            dynamic_cast<Component *>(streamNameTemplateLabelValue.get()),
             dynamic_cast<Component *>(streamNameLabel.get()),
             dynamic_cast<Component *>(streamNameLabelValue.get()),
             dynamic_cast<Component *>(totalSamplesWrittenLabel.get()),
             dynamic_cast<Component *>(totalSamplesWrittenLabelValue.get()),
+            dynamic_cast<Component *>(allocationsPerSecondLabel.get()),
+            dynamic_cast<Component *>(allocationsPerSecondLabelValue.get()),
+            dynamic_cast<Component *>(samplesDroppedLabel.get()),
+            dynamic_cast<Component *>(samplesDroppedLabelValue.get()),
+            dynamic_cast<Component *>(valuesSaturatedLabel.get()),
+            dynamic_cast<Component *>(valuesSaturatedLabelValue.get()),
+            dynamic_cast<Component *>(spooledLabel.get()),
+            dynamic_cast<Component *>(spooledLabelValue.get()),
+            dynamic_cast<Component *>(reconnectsLabel.get()),
+            dynamic_cast<Component *>(reconnectsLabelValue.get()),
+            dynamic_cast<Component *>(queueDepthLabel.get()),
+            dynamic_cast<Component *>(queueDepthLabelValue.get()),
+            dynamic_cast<Component *>(throughputLabel.get()),
+            dynamic_cast<Component *>(throughputLabelValue.get()),
+            dynamic_cast<Component *>(flushLatencyLabel.get()),
+            dynamic_cast<Component *>(flushLatencyLabelValue.get()),
+            dynamic_cast<Component *>(writeDurationLabel.get()),
+            dynamic_cast<Component *>(writeDurationLabelValue.get()),
+            dynamic_cast<Component *>(batchSizeLabel.get()),
+            dynamic_cast<Component *>(batchSizeLabelValue.get()),
+            dynamic_cast<Component *>(metricsFileLabel.get()),
+            dynamic_cast<Component *>(metricsFileLabelValue.get()),
+            dynamic_cast<Component *>(traceFileLabel.get()),
+            dynamic_cast<Component *>(traceFileLabelValue.get()),
+            dynamic_cast<Component *>(compressionLabel.get()),
+            dynamic_cast<Component *>(compressionLabelValue.get()),
+            dynamic_cast<Component *>(queueCapacityLabel.get()),
+            dynamic_cast<Component *>(queueCapacityLabelValue.get()),
+            dynamic_cast<Component *>(queueCapacityUnitComboBox.get()),
+            dynamic_cast<Component *>(overflowPolicyLabel.get()),
+            dynamic_cast<Component *>(overflowPolicyComboBox.get()),
+            dynamic_cast<Component *>(overflowBlockTimeoutMsLabel.get()),
+            dynamic_cast<Component *>(overflowBlockTimeoutMsLabelValue.get()),
+            dynamic_cast<Component *>(decimationFactorLabel.get()),
+            dynamic_cast<Component *>(decimationFactorLabelValue.get()),
+            dynamic_cast<Component *>(spoolDirectoryLabel.get()),
+            dynamic_cast<Component *>(spoolDirectoryLabelValue.get()),
+            dynamic_cast<Component *>(clockIntervalMsLabel.get()),
+            dynamic_cast<Component *>(clockIntervalMsLabelValue.get()),
+            dynamic_cast<Component *>(publishClockButton.get()),
             dynamic_cast<Component *>(asyncLatencyMsLabel.get()),
             dynamic_cast<Component *>(asyncLatencyMsLabelValue.get()),
+            dynamic_cast<Component *>(maxBatchSizeLabel.get()),
+            dynamic_cast<Component *>(maxBatchSizeLabelValue.get()),
     }) {
         opBounds = opBounds.getUnion(component->getBounds());
     }
@@ -242,9 +667,13 @@ void RiverOutputEditor::refreshDatastreams(const Array<const DataStream *> datas
 }
 
 void RiverOutputEditor::comboBoxChanged(ComboBox *box) {
+    auto processor = dynamic_cast<RiverOutput *>(getProcessor());
     if (box == oeStreamNameComboBox) {
-        auto processor = dynamic_cast<RiverOutput *>(getProcessor());
         processor->setDatastreamId(box->getSelectedId());
+    } else if (box == queueCapacityUnitComboBox) {
+        processor->setQueueCapacityInBytes(box->getSelectedId() == 2);
+    } else if (box == overflowPolicyComboBox && box->getSelectedId() > 0) {
+        processor->setOverflowPolicy((OverflowPolicy) (box->getSelectedId() - 1));
     }
 }
 
@@ -291,6 +720,34 @@ void RiverOutputEditor::buttonClicked(Button *button) {
         schemaList->addItem(river::FieldDefinition(fieldName.toStdString(), type, size));
     } else if (button == removeSelectedFieldButton) {
         schemaList->removeSelectedRow();
+    } else if (button == publishAllStreamsButton) {
+        auto processor = dynamic_cast<RiverOutput *>(getProcessor());
+        processor->setPublishAllStreams(button->getToggleState());
+        return;
+    } else if (button == publishClockButton) {
+        auto processor = dynamic_cast<RiverOutput *>(getProcessor());
+        processor->setPublishClock(button->getToggleState());
+        return;
+    } else if (button == continuousAsInt16Button) {
+        auto processor = dynamic_cast<RiverOutput *>(getProcessor());
+        processor->setContinuousAsInt16(button->getToggleState());
+        return;
+    } else if (button == continuousCompressedButton) {
+        auto processor = dynamic_cast<RiverOutput *>(getProcessor());
+        processor->setContinuousCompressed(button->getToggleState());
+        return;
+    } else if (button == spikeWaveformButton) {
+        auto processor = dynamic_cast<RiverOutput *>(getProcessor());
+        processor->setIncludeSpikeWaveform(button->getToggleState());
+        return;
+    } else if (button == dropUnsortedSpikesButton) {
+        auto processor = dynamic_cast<RiverOutput *>(getProcessor());
+        processor->setDropUnsortedSpikes(button->getToggleState());
+        return;
+    } else if (button == spikeWaveformAsInt16Button) {
+        auto processor = dynamic_cast<RiverOutput *>(getProcessor());
+        processor->setSpikeWaveformAsInt16(button->getToggleState());
+        return;
     }
     updateProcessorSchema();
 }
@@ -300,14 +757,24 @@ void RiverOutputEditor::updateProcessorSchema() {
 
     if (inputTypeSpikeButton->getToggleState()) {
         // Clearing event schema forces use of the spike schema / spike input type.
+        processor->setConsumeContinuous(false);
         processor->clearEventSchema();
     } else if (inputTypeEventButton->getToggleState()) {
-        auto field_definitions = schemaList->fieldDefinitions();
-        if (!field_definitions.empty()) {
-            processor->setEventSchema(river::StreamSchema(field_definitions));
+        if (processor->shouldConsumeContinuous()) {
+            // The list is showing the generated continuous schema, so go back to whatever event schema was there.
+            processor->setConsumeContinuous(false);
+            inputTypeSpikeButton->setToggleState(false, dontSendNotification);
+            inputTypeEventButton->setToggleState(true, dontSendNotification);
+        } else {
+            auto field_definitions = schemaList->fieldDefinitions();
+            if (!field_definitions.empty()) {
+                processor->setEventSchema(river::StreamSchema(field_definitions));
+            }
         }
+    } else if (inputTypeContinuousButton->getToggleState()) {
+        processor->setConsumeContinuous(true);
     } else {
-        // Can happen transiently where both are off briefly
+        // Can happen transiently where all are off briefly
     }
     refreshLabelsFromProcessor();
 }
@@ -331,8 +798,73 @@ void RiverOutputEditor::labelTextChanged(Label *label) {
         // Nothing to do.
     } else if (label == asyncLatencyMsLabelValue) {
         river->setMaxLatencyMs(label->getText().getIntValue());
+    } else if (label == maxBatchSizeLabelValue) {
+        int maxBatchSize = label->getText().getIntValue();
+        if (maxBatchSize > 0) {
+            river->setMaxBatchSize(maxBatchSize);
+        } else {
+            label->setText(juce::String(river->maxBatchSize()), dontSendNotification);
+        }
+    } else if (label == queueCapacityLabelValue) {
+        int queueCapacity = label->getText().getIntValue();
+        if (queueCapacity > 0) {
+            river->setQueueCapacity(queueCapacity);
+        } else {
+            label->setText(juce::String(river->queueCapacity()), dontSendNotification);
+        }
+    } else if (label == overflowBlockTimeoutMsLabelValue) {
+        river->setOverflowBlockTimeoutMs(std::max(0, label->getText().getIntValue()));
+    } else if (label == decimationFactorLabelValue) {
+        int decimationFactor = label->getText().getIntValue();
+        if (decimationFactor > 0) {
+            river->setDecimationFactor(decimationFactor);
+        } else {
+            label->setText(juce::String(river->decimationFactor()), dontSendNotification);
+        }
     } else if (label == streamNameLabelValue) {
         river->setStreamName(label->getText().toStdString());
+    } else if (label == streamNameTemplateLabelValue) {
+        river->setStreamNameTemplate(label->getText().toStdString());
+    } else if (label == metricsFileLabelValue) {
+        river->setMetricsFile(label->getText().trim().toStdString());
+    } else if (label == traceFileLabelValue) {
+        river->setTraceFile(label->getText().trim().toStdString());
+    } else if (label == spoolDirectoryLabelValue) {
+        String directory = label->getText().trim();
+        if (directory.isEmpty() || File(directory).isDirectory()) {
+            river->setSpoolDirectory(directory.toStdString());
+        } else {
+            CoreServices::sendStatusMessage("Spool directory doesn't exist: " + directory);
+            label->setText(river->spoolDirectory(), dontSendNotification);
+        }
+    } else if (label == clockIntervalMsLabelValue) {
+        int intervalMs = label->getText().getIntValue();
+        if (intervalMs >= 0) {
+            river->setClockIntervalMs(intervalMs);
+        }
+        label->setText(juce::String(river->clockIntervalMs()), dontSendNotification);
+    } else if (label == spikeChannelFilterLabelValue) {
+        if (!river->setSpikeChannelFilter(label->getText().toStdString())) {
+            CoreServices::sendStatusMessage("Invalid spike channel list: " + label->getText());
+        }
+        label->setText(river->spikeFilter().channels(), dontSendNotification);
+    } else if (label == spikeUnitFilterLabelValue) {
+        if (!river->setSpikeUnitFilter(label->getText().toStdString())) {
+            CoreServices::sendStatusMessage("Invalid spike unit list: " + label->getText());
+        }
+        label->setText(river->spikeFilter().units(), dontSendNotification);
+    } else if (label == spikeBinMsLabelValue) {
+        int binMs = label->getText().getIntValue();
+        if (binMs >= 0) {
+            river->setSpikeBinMs(binMs);
+        }
+        label->setText(juce::String(river->spikeBinMs()), dontSendNotification);
+    } else if (label == spikeBinUnitsLabelValue) {
+        int numUnits = label->getText().getIntValue();
+        if (numUnits > 0) {
+            river->setSpikeBinUnits(numUnits);
+        }
+        label->setText(juce::String(river->spikeBinUnits()), dontSendNotification);
     }
 }
 
@@ -345,21 +877,95 @@ void RiverOutputEditor::refreshLabelsFromProcessor()
     portLabelValue->setText(lastPortValue, dontSendNotification);
     passwordLabelValue->setText(river->redisConnectionPassword(), dontSendNotification);
     streamNameLabelValue->setText(river->streamName(), dontSendNotification);
+    streamNameTemplateLabelValue->setText(river->streamNameTemplate(), dontSendNotification);
+    publishAllStreamsButton->setToggleState(river->publishAllStreams(), dontSendNotification);
 
     totalSamplesWrittenLabelValue->setText(juce::String(river->totalSamplesWritten()), dontSendNotification);
+    allocationsPerSecondLabelValue->setText(juce::String(river->processingAllocationsPerSecond(), 1),
+                                            dontSendNotification);
+
+    auto drops = river->dropCounts();
+    samplesDroppedLabelValue->setText(
+            juce::String(drops.newest) + " / " + juce::String(drops.oldest) + " / " + juce::String(drops.timed_out)
+            + " / " + juce::String(drops.failed),
+            dontSendNotification);
+    auto spool = river->spoolStats();
+    spooledLabelValue->setText(
+            juce::String(spool.pending_bytes / 1e6, 1) + " MB, " + juce::String(spool.replayed_samples) + " / "
+            + juce::String(spool.spooled_samples),
+            dontSendNotification);
+    auto connection = river->connectionStats();
+    juce::String reconnects(connection.reconnects);
+    if (!connection.connected) {
+        reconnects += " (down " + juce::String(connection.current_outage_s, 1) + " s)";
+    } else if (connection.reconnects > 0) {
+        reconnects += " (" + juce::String(connection.total_outage_s, 1) + " s down)";
+    }
+    reconnectsLabelValue->setText(reconnects, dontSendNotification);
+
+    auto metrics = river->writerMetrics();
+    queueDepthLabelValue->setText(juce::String(metrics.queue_depth) + " / "
+                                  + juce::String(metrics.queue_depth_high_water) + " / "
+                                  + juce::String(metrics.queue_capacity), dontSendNotification);
+    // Only meaningful between two snapshots of the same acquisition.
+    double bytes_per_second = metrics.bytes_written >= lastMetrics.bytes_written
+                              ? metrics.bytesPerSecondSince(lastMetrics) : 0;
+    lastMetrics = metrics;
+    throughputLabelValue->setText(juce::String(bytes_per_second / 1e6, 2) + " MB/s", dontSendNotification);
+    flushLatencyLabelValue->setText(percentilesInMs(metrics.flush_latency_us), dontSendNotification);
+    writeDurationLabelValue->setText(percentilesInMs(metrics.write_duration_us), dontSendNotification);
+    batchSizeLabelValue->setText(juce::String(metrics.batch_size.percentile(0.5)) + " / "
+                                 + juce::String(metrics.batch_size.percentile(0.99)) + " / "
+                                 + juce::String(metrics.batch_size.max), dontSendNotification);
+    valuesSaturatedLabelValue->setText(juce::String(river->continuousValuesSaturated()), dontSendNotification);
+    auto encoding = river->continuousEncodingStats();
+    if (encoding.encoded_bytes > 0) {
+        compressionLabelValue->setText(juce::String(encoding.ratio(), 2) + "x, "
+                                       + juce::String(encoding.encode_time_ns.percentile(0.5) / 1000.0, 1)
+                                       + " us/block", dontSendNotification);
+    } else {
+        compressionLabelValue->setText("-", dontSendNotification);
+    }
+
+    queueCapacityLabelValue->setText(juce::String(river->queueCapacity()), dontSendNotification);
+    queueCapacityUnitComboBox->setSelectedId(river->queueCapacityInBytes() ? 2 : 1, dontSendNotification);
+    overflowPolicyComboBox->setSelectedId((int) river->overflowPolicy() + 1, dontSendNotification);
+    overflowBlockTimeoutMsLabelValue->setText(juce::String(river->overflowBlockTimeoutMs()), dontSendNotification);
+    decimationFactorLabelValue->setText(juce::String(river->decimationFactor()), dontSendNotification);
+    spoolDirectoryLabelValue->setText(river->spoolDirectory(), dontSendNotification);
+    clockIntervalMsLabelValue->setText(juce::String(river->clockIntervalMs()), dontSendNotification);
+    publishClockButton->setToggleState(river->publishClock(), dontSendNotification);
+    metricsFileLabelValue->setText(river->metricsFile(), dontSendNotification);
+    traceFileLabelValue->setText(river->traceFile(), dontSendNotification);
 
     asyncLatencyMsLabelValue->setText(juce::String(river->maxLatencyMs()), dontSendNotification);
+    maxBatchSizeLabelValue->setText(juce::String(river->maxBatchSize()), dontSendNotification);
 
     oeStreamNameComboBox->setSelectedId(river->datastream_id(), dontSendNotification);
 }
 
 void RiverOutputEditor::refreshSchemaFromProcessor() {
     auto processor = dynamic_cast<RiverOutput *>(getProcessor());
-    if (processor->shouldConsumeSpikes()) {
+    continuousAsInt16Button->setToggleState(processor->continuousAsInt16(), dontSendNotification);
+    continuousCompressedButton->setToggleState(processor->continuousCompressed(), dontSendNotification);
+    spikeWaveformButton->setToggleState(processor->includeSpikeWaveform(), dontSendNotification);
+    spikeWaveformAsInt16Button->setToggleState(processor->spikeWaveformAsInt16(), dontSendNotification);
+    spikeChannelFilterLabelValue->setText(processor->spikeFilter().channels(), dontSendNotification);
+    spikeUnitFilterLabelValue->setText(processor->spikeFilter().units(), dontSendNotification);
+    dropUnsortedSpikesButton->setToggleState(processor->spikeFilter().dropUnsorted(), dontSendNotification);
+    spikeBinMsLabelValue->setText(juce::String(processor->spikeBinMs()), dontSendNotification);
+    spikeBinUnitsLabelValue->setText(juce::String(processor->spikeBinUnits()), dontSendNotification);
+    if (processor->shouldConsumeContinuous()) {
+        inputTypeSpikeButton->setToggleState(false, dontSendNotification);
+        inputTypeEventButton->setToggleState(false, dontSendNotification);
+        inputTypeContinuousButton->setToggleState(true, dontSendNotification);
+    } else if (processor->shouldConsumeSpikes()) {
         inputTypeEventButton->setToggleState(false, dontSendNotification);
+        inputTypeContinuousButton->setToggleState(false, dontSendNotification);
         inputTypeSpikeButton->setToggleState(true, dontSendNotification);
     } else {
         inputTypeSpikeButton->setToggleState(false, dontSendNotification);
+        inputTypeContinuousButton->setToggleState(false, dontSendNotification);
         inputTypeEventButton->setToggleState(true, dontSendNotification);
     }
     schemaList->clearItems();
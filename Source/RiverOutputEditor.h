@@ -74,6 +74,41 @@ public:
 
     void updateProcessorSchema();
 
+    /** Label helpers, also used by RiverInputEditor */
+    static Label *newStaticLabel(
+            const std::string& labelText,
+            int boundsX,
+            int boundsY,
+            int boundsWidth,
+            int boundsHeight,
+            Component *parent) {
+        auto *label = new Label(labelText, labelText);
+        label->setBounds(boundsX, boundsY, boundsWidth, boundsHeight);
+        label->setFont(Font("Small Text", 12, Font::plain));
+        label->setColour(Label::textColourId, Colours::darkgrey);
+        parent->addAndMakeVisible(label);
+        return label;
+    }
+
+    static Label *newInputLabel(
+            const std::string &componentName,
+            const std::string &tooltip,
+            int boundsX,
+            int boundsY,
+            int boundsWidth,
+            int boundsHeight,
+            Component *parent) {
+        auto *label = new Label(componentName, "");
+        label->setBounds(boundsX, boundsY, boundsWidth, boundsHeight);
+        label->setFont(Font("Default", 15, Font::plain));
+        label->setColour(Label::textColourId, Colours::white);
+        label->setColour(Label::backgroundColourId, Colours::grey);
+        label->setEditable(true);
+        label->setTooltip(tooltip);
+        parent->addAndMakeVisible(label);
+        return label;
+    }
+
 private:
     ImageIcon* icon;
 
@@ -101,10 +136,88 @@ private:
     ScopedPointer<Label> totalSamplesWrittenLabel;
     ScopedPointer<Label> totalSamplesWrittenLabelValue;
 
+    ScopedPointer<Label> allocationsPerSecondLabel;
+    ScopedPointer<Label> allocationsPerSecondLabelValue;
+
+    ScopedPointer<Label> samplesDroppedLabel;
+    ScopedPointer<Label> samplesDroppedLabelValue;
+
+    ScopedPointer<Label> valuesSaturatedLabel;
+    ScopedPointer<Label> valuesSaturatedLabelValue;
+
+    ScopedPointer<Label> spooledLabel;
+    ScopedPointer<Label> spooledLabelValue;
+
+    ScopedPointer<Label> reconnectsLabel;
+    ScopedPointer<Label> reconnectsLabelValue;
+
+    ScopedPointer<Label> queueDepthLabel;
+    ScopedPointer<Label> queueDepthLabelValue;
+
+    ScopedPointer<Label> throughputLabel;
+    ScopedPointer<Label> throughputLabelValue;
+
+    ScopedPointer<Label> flushLatencyLabel;
+    ScopedPointer<Label> flushLatencyLabelValue;
+
+    ScopedPointer<Label> writeDurationLabel;
+    ScopedPointer<Label> writeDurationLabelValue;
+
+    ScopedPointer<Label> batchSizeLabel;
+    ScopedPointer<Label> batchSizeLabelValue;
+
+    ScopedPointer<Label> metricsFileLabel;
+    ScopedPointer<Label> metricsFileLabelValue;
+
+    ScopedPointer<Label> traceFileLabel;
+    ScopedPointer<Label> traceFileLabelValue;
+
+    ScopedPointer<Label> compressionLabel;
+    ScopedPointer<Label> compressionLabelValue;
+
+    // Previous refresh's metrics, to work out throughput.
+    WriterMetrics lastMetrics;
+
+    ScopedPointer<Label> queueCapacityLabel;
+    ScopedPointer<Label> queueCapacityLabelValue;
+    ScopedPointer<ComboBox> queueCapacityUnitComboBox;
+
+    ScopedPointer<Label> overflowPolicyLabel;
+    ScopedPointer<ComboBox> overflowPolicyComboBox;
+
+    ScopedPointer<Label> overflowBlockTimeoutMsLabel;
+    ScopedPointer<Label> overflowBlockTimeoutMsLabelValue;
+
+    ScopedPointer<Label> decimationFactorLabel;
+    ScopedPointer<Label> decimationFactorLabelValue;
+
+    ScopedPointer<Label> spoolDirectoryLabel;
+    ScopedPointer<Label> spoolDirectoryLabelValue;
+
+    ScopedPointer<Label> clockIntervalMsLabel;
+    ScopedPointer<Label> clockIntervalMsLabelValue;
+    ScopedPointer<ToggleButton> publishClockButton;
+
     // OPTIONS PANEL: Input Type
     const int inputTypeRadioId = 1;
     ScopedPointer<ToggleButton> inputTypeSpikeButton;
     ScopedPointer<ToggleButton> inputTypeEventButton;
+    ScopedPointer<ToggleButton> inputTypeContinuousButton;
+    ScopedPointer<ToggleButton> continuousAsInt16Button;
+    ScopedPointer<ToggleButton> continuousCompressedButton;
+    ScopedPointer<ToggleButton> spikeWaveformButton;
+    ScopedPointer<ToggleButton> spikeWaveformAsInt16Button;
+
+    ScopedPointer<Label> spikeChannelFilterLabel;
+    ScopedPointer<Label> spikeChannelFilterLabelValue;
+    ScopedPointer<Label> spikeUnitFilterLabel;
+    ScopedPointer<Label> spikeUnitFilterLabelValue;
+    ScopedPointer<ToggleButton> dropUnsortedSpikesButton;
+
+    ScopedPointer<Label> spikeBinMsLabel;
+    ScopedPointer<Label> spikeBinMsLabelValue;
+    ScopedPointer<Label> spikeBinUnitsLabel;
+    ScopedPointer<Label> spikeBinUnitsLabelValue;
 
     ScopedPointer<Label> fieldNameLabel;
     ScopedPointer<Label> fieldNameLabelValue;
@@ -117,12 +230,19 @@ private:
 
     ScopedPointer<Label> oeStreamNameLabel;
     ScopedPointer<ComboBox> oeStreamNameComboBox;
+    ScopedPointer<ToggleButton> publishAllStreamsButton;
+
+    ScopedPointer<Label> streamNameTemplateLabel;
+    ScopedPointer<Label> streamNameTemplateLabelValue;
 
     ScopedPointer<SchemaListBox> schemaList;
 
     ScopedPointer<Label> asyncLatencyMsLabel;
     ScopedPointer<Label> asyncLatencyMsLabelValue;
 
+    ScopedPointer<Label> maxBatchSizeLabel;
+    ScopedPointer<Label> maxBatchSizeLabelValue;
+
     Label *newStaticLabel(
             const std::string& labelText,
             int boundsX,
@@ -132,20 +252,6 @@ private:
         return newStaticLabel(labelText, boundsX, boundsY, boundsWidth, boundsHeight, this);
     }
 
-    static Label *newStaticLabel(
-            const std::string& labelText,
-            int boundsX,
-            int boundsY,
-            int boundsWidth,
-            int boundsHeight,
-            Component *parent) {
-        auto *label = new Label(labelText, labelText);
-        label->setBounds(boundsX, boundsY, boundsWidth, boundsHeight);
-        label->setFont(Font("Small Text", 12, Font::plain));
-        label->setColour(Label::textColourId, Colours::darkgrey);
-        parent->addAndMakeVisible(label);
-        return label;
-    }
 
     Label *newInputLabel(
             const std::string &componentName,
@@ -164,24 +270,6 @@ private:
                 this);
     }
 
-    static Label *newInputLabel(
-            const std::string &componentName,
-            const std::string &tooltip,
-            int boundsX,
-            int boundsY,
-            int boundsWidth,
-            int boundsHeight,
-            Component *parent) {
-        auto *label = new Label(componentName, "");
-        label->setBounds(boundsX, boundsY, boundsWidth, boundsHeight);
-        label->setFont(Font("Default", 15, Font::plain));
-        label->setColour(Label::textColourId, Colours::white);
-        label->setColour(Label::backgroundColourId, Colours::grey);
-        label->setEditable(true);
-        label->setTooltip(tooltip);
-        parent->addAndMakeVisible(label);
-        return label;
-    }
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RiverOutputEditor)
 };